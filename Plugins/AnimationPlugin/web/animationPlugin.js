@@ -58,7 +58,7 @@ AnimationPlugin.adConf = function(nodeId,server){
     decayDiv.append('<span class="AnimationPlugin_numLabel">Decay:</span>');
     decayDiv.append(this.decayBox);
     
-    this.server.customRPC(this.nodeId,{animationMethod:"getAttackDecay"},function(data){
+    this.server.customQuery(this.nodeId,{animationMethod:"getAttackDecay"},function(data){
                           AnimationPlugin.theAdConf.attackBox.val(data.attackVal);
                           AnimationPlugin.theAdConf.decayBox.val(data.decayVal);});
 };
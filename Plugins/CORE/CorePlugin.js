@@ -38,7 +38,7 @@ function CORE_IntGenerator(nodeId,server){
     this.dialog.append('<span class="CORE_numLabel">Value:</span>');
     this.dialog.append(this.numberBox);
     
-    this.server.customRPC(this.nodeId,{coreMethod:"getIntGenVal"},function(data){
+    this.server.customQuery(this.nodeId,{coreMethod:"getIntGenVal"},function(data){
                           CORE_theIntGen.numberBox.val(data.val);});
 }
 
@@ -57,7 +57,7 @@ function CORE_IntViewer(nodeId,server){
     this.dialog.append('<span class="CORE_numLabel">Value:</span>');
     this.dialog.append(this.numberBox);
     
-    this.server.customRPC(this.nodeId,{coreMethod:"getIntViewVal"},function(data){
+    this.server.customQuery(this.nodeId,{coreMethod:"getIntViewVal"},function(data){
                           CORE_theIntViewer.numberBox.val(data.val);});
 }
 
@@ -81,7 +81,7 @@ function CORE_FloatGenerator(nodeId,server){
     this.dialog.append('<span class="CORE_numLabel">Value:</span>');
     this.dialog.append(this.numberBox);
     
-    this.server.customRPC(this.nodeId,{coreMethod:"getFloatGenVal"},function(data){
+    this.server.customQuery(this.nodeId,{coreMethod:"getFloatGenVal"},function(data){
                           CORE_theFloatGen.numberBox.val(data.val);});
 } 
 
@@ -98,13 +98,13 @@ function CORE_FloatViewer(nodeId,server){
     this.numberBox.addClass('CORE_numBox');
     this.numberBox.attr('readonly','readonly');
     this.numberBox.click(this,function(event){
-                         event.data.server.customRPC(event.data.nodeId,{coreMethod:"getFloatViewVal"},function(data){
+                         event.data.server.customQuery(event.data.nodeId,{coreMethod:"getFloatViewVal"},function(data){
                                                      CORE_theFloatViewer.numberBox.val(data.val);});
                          });
     this.dialog.append('<span class="CORE_numLabel">Value:</span>');
     this.dialog.append(this.numberBox);
     
-    this.server.customRPC(this.nodeId,{coreMethod:"getFloatViewVal"},function(data){
+    this.server.customQuery(this.nodeId,{coreMethod:"getFloatViewVal"},function(data){
                           CORE_theFloatViewer.numberBox.val(data.val);});
 } 
 
@@ -126,7 +126,7 @@ function CORE_RGBGenerator(nodeId,server){
                              dia.server.customRPC(dia.nodeId,{coreMethod:"setRgbGenVal",val:{r:picker.rgb[0],
                                                   g:picker.rgb[1],b:picker.rgb[2]}});
                              });
-    this.server.customRPC(this.nodeId,{coreMethod:"getRgbGenVal"},function(data){
+    this.server.customQuery(this.nodeId,{coreMethod:"getRgbGenVal"},function(data){
                           var dia = CORE_theRgbGen;
                           dia.newFT.setRGB([data.val.r,data.val.g,data.val.b]);
                           });
@@ -149,7 +149,7 @@ function CORE_RGBViewer(nodeId,server){
     this.viewbox.css('width','9.3em').css('height','7.5em');
     this.dialog.append(this.viewbox);
     
-    this.server.customRPC(this.nodeId,{coreMethod:"getRgbViewVal"},function(data){
+    this.server.customQuery(this.nodeId,{coreMethod:"getRgbViewVal"},function(data){
                           var dia = CORE_theRgbViewer;
                           dia.viewbox.css('background-color','rgba('+parseInt(data.val.r*255)+
                                           ','+parseInt(data.val.g*255)+
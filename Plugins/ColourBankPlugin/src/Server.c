@@ -185,6 +185,58 @@ colourBankNodeDelete (struct LSD_SceneNodeInst const* inst, void* instData)
 }
 
 
+/* Control port funcs; sub is the picker id */
+
+static struct PickerData*
+findPicker (struct PickerInstData* instData, int pickerId)
+{
+    int i;
+    for (i = 0; i < instData->numPickers; ++i)
+        if (instData->pickerArr[i].dbId == pickerId)
+            return &instData->pickerArr[i];
+    return NULL;
+}
+
+
+int
+colourBankNodeControl (struct LSD_SceneNodeInst const* inst, void* instData,
+                       int sub, const double* vals, int count)
+{
+    struct PickerData* picker = findPicker ((struct PickerInstData*)instData,
+                                            sub);
+    if (!picker || count != 3)
+        return -1;
+
+    picker->pickerVal.r = vals[0];
+    picker->pickerVal.g = vals[1];
+    picker->pickerVal.b = vals[2];
+    return 0;
+}
+
+
+int
+colourBankNodePersist (struct LSD_SceneNodeInst const* inst, void* instData,
+                       int sub)
+{
+    struct PickerData* picker = findPicker ((struct PickerInstData*)instData,
+                                            sub);
+    if (!picker)
+        return -1;
+
+    plugindb_reset (pickerBankPlugin, updatePickerStmt);
+    plugindb_bind_int (pickerBankPlugin, updatePickerStmt, 1, sub);
+    plugindb_bind_double (pickerBankPlugin, updatePickerStmt, 2,
+                          picker->pickerVal.r);
+    plugindb_bind_double (pickerBankPlugin, updatePickerStmt, 3,
+                          picker->pickerVal.g);
+    plugindb_bind_double (pickerBankPlugin, updatePickerStmt, 4,
+                          picker->pickerVal.b);
+    if (plugindb_step (pickerBankPlugin, updatePickerStmt) != SQLITE_DONE)
+        return -1;
+    return 0;
+}
+
+
 void
 colourBankRPCHandler (cJSON* in, cJSON* out)
 {
@@ -444,6 +496,15 @@ colourBankPluginInit (struct LSD_ScenePlugin const* plugin)
         return -1;
     }
 
+    /* Pickers can be driven from the control port */
+    if (plugininit_registerNodeControl (plugin, colourBankClass,
+                                        colourBankNodeControl,
+                                        colourBankNodePersist) < 0)
+    {
+        fprintf (stderr, "Error while registering Colour Bank control\n");
+        return -1;
+    }
+
     /* Register DB tables */
     if (plugininit_createTable (plugin, "picker",
                                 "id INTEGER PRIMARY KEY, nodeId INTEGER NOT NULL, lastR REAL DEFAULT 0, "
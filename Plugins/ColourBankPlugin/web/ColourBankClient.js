@@ -51,7 +51,7 @@ function LSDColourBankDialog(nodeId,server){
 
 LSDColourBankDialog.prototype = {
 	getPickers:function(){
-		this.server.customRPC(this.nodeId,{cbMethod:'getNodePickers'},this.handlePickerResp);
+		this.server.customQuery(this.nodeId,{cbMethod:'getNodePickers'},this.handlePickerResp);
 	},
 	
 	getPickersWrap:function(){
@@ -433,11 +433,11 @@ function PaletteSamplerEditor(nodeId,server){
 PaletteSamplerEditor.prototype = {
     updateFromServer:function(){
         thePaletteSamplerEditor = this;
-        this.server.customRPC(this.nodeId,{paletteMethod:"getSampler"},this.handleServerResp);
+        this.server.customQuery(this.nodeId,{paletteMethod:"getSampler"},this.handleServerResp);
     },
     
     updateFromServerWrap:function(){
-        thePaletteSamplerEditor.server.customRPC(thePaletteSamplerEditor.nodeId,{paletteMethod:"getSampler"},
+        thePaletteSamplerEditor.server.customQuery(thePaletteSamplerEditor.nodeId,{paletteMethod:"getSampler"},
                                        thePaletteSamplerEditor.handleServerResp);
     },
     
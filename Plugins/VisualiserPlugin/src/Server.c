@@ -265,7 +265,7 @@ msemInit ()
     }
 
     mshmAttach = (void*)shmat (mshmid, NULL, 0);
-    if (!mshmAttach)
+    if (mshmAttach == (void*)-1)
     {
         fprintf (stderr, "No shared memory pointer produced\n");
         return -1;
@@ -323,7 +323,7 @@ asemInit ()
     }
     
     ashmAttach = (void*)shmat (ashmid, NULL, 0);
-    if (!ashmAttach)
+    if (ashmAttach == (void*)-1)
     {
         fprintf (stderr, "No shared memory pointer produced\n");
         return -1;
@@ -396,7 +396,11 @@ visPluginMPDInit (struct LSD_ScenePlugin const* plugin)
     mlocalBuffer[1] = 0.0;
     mlocalBuffer[2] = 0.0;
     
-    msemInit ();
+    /* The previous generation's IPC objects are gone by now
+     * (see PluginAPI.h); if they still exist, don't fight over
+     * them */
+    if (msemInit () < 0)
+        return -1;
     mstartPipeProcess ();
 
     plugininit_registerNodeClass (plugin,
@@ -423,7 +427,8 @@ visPluginALSAInit (struct LSD_ScenePlugin const* plugin)
     alocalBuffer[1] = 0.0;
     alocalBuffer[2] = 0.0;
     
-    asemInit ();
+    if (asemInit () < 0)
+        return -1;
     astartPipeProcess ();
     
     
@@ -451,9 +456,11 @@ visPluginInit (struct LSD_ScenePlugin const* plugin)
     
     floatTypeId = core_getFloatTypeID ();
     
-    visPluginMPDInit (plugin);
+    if (visPluginMPDInit (plugin) < 0)
+        return -1;
 #ifdef HAVE_ALSA_ASOUNDLIB_H
-    visPluginALSAInit (plugin);
+    if (visPluginALSAInit (plugin) < 0)
+        return -1;
 #endif
     
     return 0;
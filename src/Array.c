@@ -448,3 +448,155 @@ insertElem (struct LSD_ArrayHead* array,
 }
 
 
+int
+ptrIdx (struct LSD_ArrayHead* array, void const* elemPtr, size_t* idxBind)
+{
+    if (!array || !elemPtr)
+        return -1;
+
+    size_t unitSize = array->elemSize * array->mul;
+    struct LSD_ArrayUnit* unit = array->firstUnit;
+    while (unit)
+    {
+        if (elemPtr >= unit->buffer && elemPtr < unit->buffer + unitSize)
+        {
+            if (idxBind)
+                *idxBind = unit->unitIdx * array->mul +
+                           ( elemPtr - unit->buffer ) / array->elemSize;
+            return 0;
+        }
+        unit = unit->nextUnit;
+    }
+
+    return -1;
+}
+
+
+int
+compactArray (struct LSD_ArrayHead* array, size_t const* newIdxMap)
+{
+    if (!array || !newIdxMap)
+    {
+        doLog (ERROR, LOG_COMP, _("Invalid arguments for compactArray()."));
+        return -1;
+    }
+
+    size_t oldCount = array->maxIdx + 1;
+    size_t newCount = 0;
+    size_t i;
+    for (i = 0; i < oldCount; ++i)
+        if (newIdxMap[i] != (size_t)-1)
+            ++newCount;
+
+    /* Build a fresh unit chain large enough for the live set */
+    size_t newUnits = ( newCount + array->mul - 1 ) / array->mul;
+    if (newUnits < 1)
+        newUnits = 1;
+
+    size_t unitSize = array->elemSize * array->mul;
+    struct LSD_ArrayUnit** units = malloc (sizeof( struct LSD_ArrayUnit* ) *
+                                           newUnits);
+    if (!units)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to allocate unit table in compactArray()."));
+        return -1;
+    }
+
+    for (i = 0; i < newUnits; ++i)
+    {
+        units[i] = malloc (sizeof( struct LSD_ArrayUnit ));
+        if (units[i])
+            units[i]->buffer = malloc (unitSize);
+        if (!units[i] || !units[i]->buffer)
+        {
+            doLog (ERROR, LOG_COMP, _("Unable to allocate ArrayUnit in compactArray()."));
+            if (units[i])
+                free (units[i]);
+            while (i-- > 0)
+            {
+                free (units[i]->buffer);
+                free (units[i]);
+            }
+            free (units);
+            return -1;
+        }
+        memset (units[i]->buffer, 0, unitSize);
+        units[i]->parent = array;
+        units[i]->unitIdx = i;
+        units[i]->nextUnit = NULL;
+        if (i > 0)
+            units[i - 1]->nextUnit = units[i];
+    }
+
+    /* Copy live elements into place (units are walked in
+     * order, avoiding a resolve per element) */
+    struct LSD_ArrayUnit* oldUnit = array->firstUnit;
+    for (i = 0; i < oldCount && oldUnit; ++i)
+    {
+        size_t elemIdx = i % array->mul;
+        size_t newIdx = newIdxMap[i];
+        if (newIdx != (size_t)-1 && newIdx < newCount)
+            memcpy (units[newIdx / array->mul]->buffer +
+                    array->elemSize * ( newIdx % array->mul ),
+                    oldUnit->buffer + array->elemSize * elemIdx,
+                    array->elemSize);
+
+        if (elemIdx == array->mul - 1)
+            oldUnit = oldUnit->nextUnit;
+    }
+
+    /* Release old chain without destructing (elements moved) */
+    oldUnit = array->firstUnit;
+    while (oldUnit)
+    {
+        struct LSD_ArrayUnit* nextUnit = oldUnit->nextUnit;
+        free (oldUnit->buffer);
+        free (oldUnit);
+        oldUnit = nextUnit;
+    }
+
+    array->firstUnit = units[0];
+    array->lastUnit = units[newUnits - 1];
+    array->numUnits = newUnits;
+    array->capacity = newUnits * array->mul;
+    array->numElems = newCount;
+    array->maxIdx = newCount - 1;
+    free (units);
+
+    /* No holes remain; forget recorded marks */
+    if (array->delStat == DEL_ID_ASSIGN)
+    {
+        lsdgc_removeArrIdMarks (array->dbId);
+        array->delStat = DEL_ALLOWED;
+    }
+
+    return 0;
+}
+
+
+int
+moveArray (struct LSD_ArrayHead* dest, struct LSD_ArrayHead* src)
+{
+    if (!dest || !src)
+    {
+        doLog (ERROR, LOG_COMP, _("NULL arrayHead provided for moveArray()."));
+        return -1;
+    }
+
+    *dest = *src;
+
+    struct LSD_ArrayUnit* unit;
+    for (unit = dest->firstUnit; unit; unit = unit->nextUnit)
+        unit->parent = dest;
+
+    /* Free slot marks are keyed by array id and would outlive
+     * the source head; the moved array never inserts again */
+    if (dest->delStat == DEL_ID_ASSIGN)
+        lsdgc_removeArrIdMarks (dest->dbId);
+    dest->delStat = NO_DEL_ALLOWED;
+
+    memset (src, 0, sizeof( struct LSD_ArrayHead ));
+    src->maxIdx = -1;
+
+    return 0;
+}
@@ -80,5 +80,25 @@ insertElem (struct LSD_ArrayHead* array,
             void** targetPtrBind);
 
 
+/* Resolves the index of an element from its pointer */
+int
+ptrIdx (struct LSD_ArrayHead* array, void const* elemPtr, size_t* idxBind);
+
+
+/* Relocates live elements according to newIdxMap (indexed by
+ * current idx, (size_t)-1 for holes). Mapped indices must be
+ * dense from 0. No destructors are ran; pointers to elements
+ * become invalid and must be patched by the caller. */
+int
+compactArray (struct LSD_ArrayHead* array, size_t const* newIdxMap);
+
+
+/* Moves an array's elements under another head, leaving src
+ * empty (as if cleared). The moved array no longer tracks
+ * deleted slots and should only be read and then cleared. */
+int
+moveArray (struct LSD_ArrayHead* dest, struct LSD_ArrayHead* src);
+
+
 
 #endif /* ARRAY_H */
@@ -0,0 +1,460 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+/* Standalone microbenchmarks for the core containers and
+ * lookup paths. Built and ran with `make bench`.
+ *
+ * Each result is printed as one JSON object per line:
+ * {"bench":NAME,"n":SIZE,"iterations":OPS,"nsPerOp":NS}
+ * An optional argument restricts the run to benchmarks
+ * whose name contains it. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Array.h"
+#include "DBArrOps.h"
+#include "DBOps.h"
+#include "cJSON.h"
+#include "DMX.h"
+#include "GarbageCollector.h"
+#include "CorePlugin.h"
+#include "SceneCore.h"
+#include "Node.h"
+#include "Logging.h"
+
+static const char* benchFilter;
+
+static double
+nowNs ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+
+static int
+wantBench (const char* name)
+{
+    return !benchFilter || strstr (name, benchFilter);
+}
+
+
+static void
+report (const char* name, long n, long iters, double ns)
+{
+    printf ("{\"bench\":\"%s\",\"n\":%ld,\"iterations\":%ld,\"nsPerOp\":%.2f}\n",
+            name, n, iters, iters ? ns / iters : 0.0);
+    fflush (stdout);
+}
+
+
+/* Cheap deterministic index stream for random access
+ * patterns */
+static unsigned int lcgState;
+
+static unsigned int
+lcgNext ()
+{
+    lcgState = lcgState * 1103515245 + 12345;
+    return ( lcgState >> 8 );
+}
+
+
+/* ****** Array.c ****** */
+
+static void
+benchArray (long n)
+{
+    struct LSD_ArrayHead arr;
+    size_t idx;
+    void* elem;
+    long i;
+    double t;
+    long reps = 2000000 / n + 1;
+
+    memset (&arr, 0, sizeof( struct LSD_ArrayHead ));
+    makeArray (&arr, 50, sizeof( struct LSD_SceneNodeOutput ), 0, NULL);
+
+    if (wantBench ("array.insert"))
+    {
+        t = nowNs ();
+        for (i = 0; i < n; ++i)
+            insertElem (&arr, &idx, &elem);
+        report ("array.insert", n, n, nowNs () - t);
+    }
+    else
+        for (i = 0; i < n; ++i)
+            insertElem (&arr, &idx, &elem);
+
+    if (wantBench ("array.pickSeq"))
+    {
+        t = nowNs ();
+        long r;
+        for (r = 0; r < reps; ++r)
+            for (i = 0; i < n; ++i)
+                pickIdx (&arr, &elem, i);
+        report ("array.pickSeq", n, reps * n, nowNs () - t);
+    }
+
+    if (wantBench ("array.pickRand"))
+    {
+        lcgState = 1;
+        t = nowNs ();
+        long total = reps * n;
+        for (i = 0; i < total; ++i)
+            pickIdx (&arr, &elem, lcgNext () % n);
+        report ("array.pickRand", n, total, nowNs () - t);
+    }
+
+    clearArray (&arr);
+
+    /* Delete every other element, then reinsert as many
+     * through the GC mark table; each half is timed on its
+     * own */
+    if (wantBench ("array.delete") || wantBench ("array.reinsert"))
+    {
+        memset (&arr, 0, sizeof( struct LSD_ArrayHead ));
+        makeArray (&arr, 50, sizeof( struct LSD_SceneNodeOutput ), 1, NULL);
+        for (i = 0; i < n; ++i)
+            insertElem (&arr, &idx, &elem);
+
+        long cycled = ( n + 1 ) / 2;
+        t = nowNs ();
+        for (i = 0; i < n; i += 2)
+            delIdx (&arr, i);
+        if (wantBench ("array.delete"))
+            report ("array.delete", n, cycled, nowNs () - t);
+
+        t = nowNs ();
+        for (i = 0; i < n; i += 2)
+            insertElem (&arr, &idx, &elem);
+        if (wantBench ("array.reinsert"))
+            report ("array.reinsert", n, cycled, nowNs () - t);
+
+        clearArray (&arr);
+    }
+}
+
+
+/* ****** GarbageCollector.c ****** */
+
+static void
+benchGCMarks (long n)
+{
+    if (!wantBench ("gc.markCycle"))
+        return;
+
+    int arrId;
+    int idxBind;
+    long i;
+    lsdgc_getNewArrayId (&arrId);
+
+    double t = nowNs ();
+    for (i = 0; i < n; ++i)
+        lsdgc_setArrMark (arrId, i);
+    while (lsdgc_discoverArrMark (arrId, &idxBind) == 0)
+        lsdgc_unsetArrMark (arrId, idxBind);
+    report ("gc.markCycle", n, n, nowNs () - t);
+
+    lsdgc_removeArrIdMarks (arrId);
+}
+
+
+/* ****** Facade tracing ****** */
+
+/* Builds `depth` nested patch spaces with an RGB generator
+ * and an RGB viewer in the innermost one. The generator's
+ * output is aliased outwards through a facade output at
+ * every level and the viewer's input through a facade input
+ * at every level. */
+static int
+buildFacadeChain (int depth, int* outerOutBind, int* outerInBind)
+{
+    struct LSD_SceneNodeClass* genClass = core_getRGBGenClass ();
+    struct LSD_SceneNodeClass* viewClass = core_getRGBViewClass ();
+    if (!genClass || !viewClass)
+        return -1;
+
+    int* psIds = malloc (sizeof( int ) * ( depth + 1 ));
+    if (!psIds)
+        return -1;
+
+    int i;
+    lsddb_createPatchSpace ("Bench Root", &psIds[0], -1);
+    for (i = 1; i <= depth; ++i)
+        lsddb_createPatchSpace ("Bench Level", &psIds[i], psIds[i - 1]);
+
+    int genId, viewId;
+    struct LSD_SceneNodeInst* gen;
+    struct LSD_SceneNodeInst* view;
+    lsddb_addNodeInst (psIds[depth], genClass, &genId, &gen);
+    lsddb_addNodeInst (psIds[depth], viewClass, &viewId, &view);
+
+    int srcOut, destIn;
+    if (lsddb_getInstPlugs (genId, NULL, &srcOut) < 0 ||
+        lsddb_getInstPlugs (viewId, &destIn, NULL) < 0)
+    {
+        free (psIds);
+        return -1;
+    }
+
+    for (i = depth; i >= 1; --i)
+    {
+        int facOut, facIn;
+        lsddb_createPatchSpaceOut (psIds[i], "Bench Out", &facOut);
+        lsddb_createPatchSpaceIn (psIds[i], "Bench In", &facIn);
+        if (lsddb_wireNodes (0, srcOut, 1, facOut, NULL) < 0 ||
+            lsddb_wireNodes (1, facIn, 0, destIn, NULL) < 0)
+        {
+            free (psIds);
+            return -1;
+        }
+        srcOut = facOut;
+        destIn = facIn;
+    }
+
+    *outerOutBind = srcOut;
+    *outerInBind = destIn;
+    free (psIds);
+    return 0;
+}
+
+
+static void
+benchTrace (int depth)
+{
+    if (!wantBench ("trace.output") && !wantBench ("trace.input"))
+        return;
+
+    int outerOut, outerIn;
+    if (buildFacadeChain (depth, &outerOut, &outerIn) < 0)
+    {
+        fprintf (stderr, "Unable to build facade chain of depth %d\n", depth);
+        return;
+    }
+
+    long iters = 20000;
+    long i;
+    double t;
+
+    if (wantBench ("trace.output"))
+    {
+        struct LSD_SceneNodeOutput* out;
+        t = nowNs ();
+        for (i = 0; i < iters; ++i)
+            lsddb_traceOutput (&out, outerOut, NULL, NULL);
+        report ("trace.output", depth, iters, nowNs () - t);
+    }
+
+    if (wantBench ("trace.input"))
+    {
+        struct LSD_SceneNodeInput* in;
+        t = nowNs ();
+        for (i = 0; i < iters; ++i)
+            lsddb_traceInput (&in, outerIn, NULL, NULL);
+        report ("trace.input", depth, iters, nowNs () - t);
+    }
+}
+
+
+/* ****** DMX.c ****** */
+
+/* Grows the patch to `n` RGB channels (16 bit, 3 addresses
+ * each) across as many universes as needed, all fed by RGB
+ * generators */
+static void
+benchBufferUnivs (long n)
+{
+    if (!wantBench ("dmx.bufferUnivs"))
+        return;
+
+    struct LSD_SceneNodeClass* genClass = core_getRGBGenClass ();
+    if (!genClass)
+        return;
+
+    static int partId = -1;
+    static int psId;
+    static long patched;
+    if (partId < 0 &&
+        ( lsddb_createPartition ("Bench DMX", &partId) < 0 ||
+          lsddb_getPartitionPatchSpace (partId, &psId) < 0 ))
+    {
+        partId = -1;
+        fprintf (stderr, "Unable to create DMX partition\n");
+        return;
+    }
+
+    long chansPerUniv = 512 / 6;
+    for (; patched < n; ++patched)
+    {
+        int nodeId;
+        struct LSD_SceneNodeInst* gen;
+        lsddb_addNodeInst (psId, genClass, &nodeId, &gen);
+        ( (struct RGB_TYPE*)gen->data )->r = 0.25;
+        ( (struct RGB_TYPE*)gen->data )->g = 0.5;
+        ( (struct RGB_TYPE*)gen->data )->b = 0.75;
+
+        int univId = patched / chansPerUniv + 1;
+        int base = ( patched % chansPerUniv ) * 6;
+        cJSON* opts = cJSON_CreateObject ();
+        cJSON_AddStringToObject (opts, "name", "Bench Chan");
+        cJSON_AddNumberToObject (opts, "single", 0);
+        cJSON_AddNumberToObject (opts, "sixteenBit", 1);
+        static const char* addrNames[] = {"redAddr", "greenAddr", "blueAddr"};
+        int c;
+        for (c = 0; c < 3; ++c)
+        {
+            cJSON* addr = cJSON_CreateObject ();
+            cJSON_AddNumberToObject (addr, "univId", univId);
+            cJSON_AddNumberToObject (addr, "lightAddr", base + c * 2);
+            cJSON_AddItemToObject (opts, addrNames[c], addr);
+        }
+
+        int genOut, facadeOut;
+        int failed = lsddb_addPatchChannel (partId, opts, &facadeOut) < 0 ||
+                     lsddb_getInstPlugs (nodeId, NULL, &genOut) < 0 ||
+                     lsddb_wireNodes (0, genOut, 1, facadeOut, NULL) < 0;
+        cJSON_Delete (opts);
+        if (failed)
+        {
+            fprintf (stderr, "Unable to patch DMX channel %ld\n", patched);
+            return;
+        }
+    }
+
+    long frames = 2000000 / n + 1;
+    long i;
+    double t = nowNs ();
+    for (i = 0; i < frames; ++i)
+    {
+        node_incFrameCount ();
+        bufferUnivs ();
+    }
+    report ("dmx.bufferUnivs", n, frames * n, nowNs () - t);
+}
+
+
+/* ****** Id resolution ****** */
+
+/* Resolves `n` RGB viewer instances and their inputs by id */
+static void
+benchResolve (long n)
+{
+    if (!wantBench ("resolve.inst") && !wantBench ("resolve.input"))
+        return;
+
+    struct LSD_SceneNodeClass* viewClass = core_getRGBViewClass ();
+    if (!viewClass)
+        return;
+
+    int psId;
+    lsddb_createPatchSpace ("Bench Resolve", &psId, -1);
+
+    int* instIds = malloc (sizeof( int ) * n);
+    int* inIds = malloc (sizeof( int ) * n);
+    if (!instIds || !inIds)
+    {
+        free (instIds);
+        free (inIds);
+        return;
+    }
+
+    long i;
+    for (i = 0; i < n; ++i)
+    {
+        struct LSD_SceneNodeInst* view;
+        lsddb_addNodeInst (psId, viewClass, &instIds[i], &view);
+        lsddb_getInstPlugs (instIds[i], &inIds[i], NULL);
+    }
+
+    long iters = 200000;
+    double t;
+
+    if (wantBench ("resolve.inst"))
+    {
+        struct LSD_SceneNodeInst const* inst;
+        t = nowNs ();
+        for (i = 0; i < iters; ++i)
+            lsddb_resolveInstFromId (&inst, instIds[i % n], NULL);
+        report ("resolve.inst", n, iters, nowNs () - t);
+    }
+
+    if (wantBench ("resolve.input"))
+    {
+        struct LSD_SceneNodeInput* in;
+        t = nowNs ();
+        for (i = 0; i < iters; ++i)
+            lsddb_resolveInputFromId (&in, inIds[i % n]);
+        report ("resolve.input", n, iters, nowNs () - t);
+    }
+
+    free (instIds);
+    free (inIds);
+}
+
+
+int
+main (int argc, const char** argv)
+{
+    if (argc > 1)
+        benchFilter = argv[1];
+
+    /* delIdx() marks, tracing and DMX need the GC and a
+     * scene DB */
+    if (lsdgc_prepGCOps () < 0 || lsddb_emptyDB () < 0 ||
+        initLsdArrays () < 0 ||
+        lsddb_pluginHeadLoader (getCoreHead, 1, "CORE", "0", NULL) < 0)
+    {
+        fprintf (stderr, "Unable to establish scene for benchmarks\n");
+        return 1;
+    }
+
+    long i;
+    static const long sizes[] = {50, 1000, 20000};
+    for (i = 0; i < 3; ++i)
+        benchArray (sizes[i]);
+
+    for (i = 0; i < 3; ++i)
+        benchGCMarks (sizes[i]);
+
+    static const int depths[] = {1, 4, 16, 64};
+    for (i = 0; i < 4; ++i)
+        benchTrace (depths[i]);
+
+    static const long chans[] = {64, 512, 4096};
+    for (i = 0; i < 3; ++i)
+        benchBufferUnivs (chans[i]);
+
+    benchResolve (1000);
+
+    clearLsdArrays ();
+    lsddb_closeDB ();
+    lsdgc_finalGCOps ();
+
+    return 0;
+}
+
+
@@ -0,0 +1,339 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifndef HW_RVL
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#include "ControlPort.h"
+#include "DBOps.h"
+#include "DBArr.h"
+#include "SceneCore.h"
+#include "Logging.h"
+
+/* Gettext stuff */
+#ifndef HW_RVL
+#include <libintl.h>
+#define _(String) gettext (String)
+#else
+#define _(String) String
+#endif
+
+/* Name of this component for logging */
+static const char LOG_COMP[] = "ControlPort.c";
+
+static const char CONTROL_MAGIC[4] = {'L', 'S', 'C', '1'};
+
+#define RECORD_HEAD_LEN 8
+#define MAX_RECORD_VALS 4
+
+/* Datagrams handled per wakeup, so a flood can't starve the
+ * RPC; the rest are read on the next pass of the loop */
+#define MAX_DATAGRAMS 64
+
+/* Values written to the DB at most this long after their first
+ * unsaved change */
+static const struct timeval PERSIST_DELAY = {1, 0};
+
+#define MAX_PENDING 256
+
+struct PendingValue
+{
+    int instId;
+    int sub;
+};
+
+static struct PendingValue pending[MAX_PENDING];
+static int numPending = 0;
+
+static int ctlFd = -1;
+static struct event* ctlEv = NULL;
+static struct event* persistEv = NULL;
+
+/* Rejected datagrams are only logged once a second */
+static time_t lastRejectLog = 0;
+static int rejected = 0;
+
+
+static uint32_t
+readU32 (const unsigned char* p)
+{
+    return ( (uint32_t)p[0] << 24 ) | ( (uint32_t)p[1] << 16 ) |
+           ( (uint32_t)p[2] << 8 ) | p[3];
+}
+
+
+static double
+readF32 (const unsigned char* p)
+{
+    uint32_t bits = readU32 (p);
+    float f;
+    memcpy (&f, &bits, sizeof( f ));
+    return f;
+}
+
+
+static void
+markPending (int instId, int sub)
+{
+    int i;
+    for (i = 0; i < numPending; ++i)
+        if (pending[i].instId == instId && pending[i].sub == sub)
+            return;
+
+    if (numPending == MAX_PENDING)
+        lsdctl_flush ();
+
+    pending[numPending].instId = instId;
+    pending[numPending].sub = sub;
+    if (numPending++ == 0 && persistEv)
+        evtimer_add (persistEv, &PERSIST_DELAY);
+}
+
+
+static int
+applyRecord (int instId, int sub, const double* vals, int count)
+{
+    struct LSD_SceneNodeInst* inst =
+        lsdmap_get (getMap_lsdNodeInstMap (), instId);
+    if (!inst || !inst->nodeClass->nodeControlFunc)
+        return -1;
+
+    if (inst->nodeClass->nodeControlFunc (inst, inst->data, sub, vals,
+                                          count) < 0)
+        return -1;
+
+    markPending (instId, sub);
+    return 0;
+}
+
+
+/* Returns the number of records rejected, or -1 if the datagram
+ * is malformed (records before the fault are still applied) */
+static int
+applyDatagram (const unsigned char* buf, size_t len)
+{
+    if (len < sizeof( CONTROL_MAGIC ) ||
+        memcmp (buf, CONTROL_MAGIC, sizeof( CONTROL_MAGIC )) != 0)
+        return -1;
+
+    int bad = 0;
+    size_t pos = sizeof( CONTROL_MAGIC );
+    while (pos < len)
+    {
+        if (len - pos < RECORD_HEAD_LEN)
+            return -1;
+
+        const unsigned char* rec = buf + pos;
+        int instId = (int)readU32 (rec);
+        int sub = ( rec[4] << 8 ) | rec[5];
+        int count = rec[6];
+        if (count < 1 || count > MAX_RECORD_VALS ||
+            len - pos - RECORD_HEAD_LEN < (size_t)count * 4)
+            return -1;
+
+        /* NaN and infinities never reach a node */
+        double vals[MAX_RECORD_VALS];
+        int finite = 1;
+        int i;
+        for (i = 0; i < count; ++i)
+        {
+            vals[i] = readF32 (rec + RECORD_HEAD_LEN + i * 4);
+            if (!isfinite (vals[i]))
+                finite = 0;
+        }
+
+        if (!finite || applyRecord (instId, sub, vals, count) < 0)
+            ++bad;
+
+        pos += RECORD_HEAD_LEN + count * 4;
+    }
+
+    return bad;
+}
+
+
+#ifndef HW_RVL
+static void
+readControl (evutil_socket_t fd, short what, void* arg)
+{
+    unsigned char buf[1500];
+    int locked = 0;
+
+    int i;
+    for (i = 0; i < MAX_DATAGRAMS; ++i)
+    {
+        ssize_t len = recv (fd, buf, sizeof( buf ), 0);
+        if (len < 0)
+            break;
+
+        /* Land the whole burst between two frames */
+        if (!locked)
+        {
+            lockScene ();
+            locked = 1;
+        }
+        if (applyDatagram (buf, len) != 0)
+            ++rejected;
+    }
+
+    if (locked)
+        unlockScene ();
+
+    time_t now = time (NULL);
+    if (rejected && now != lastRejectLog)
+    {
+        doLog (WARNING, LOG_COMP, _("Rejected %d control datagrams (bad format or unknown nodes)."),
+               rejected);
+        rejected = 0;
+        lastRejectLog = now;
+    }
+}
+#endif
+
+
+static void
+persistPending (evutil_socket_t fd, short what, void* arg)
+{
+    lsdctl_flush ();
+}
+
+
+int
+lsdctl_open (struct event_base* eb, int port, const char* bindAddr)
+{
+#ifndef HW_RVL
+    /* Datagrams are not authenticated; only local controllers
+     * reach the port unless another address is asked for */
+    struct sockaddr_in addr;
+    memset (&addr, 0, sizeof( addr ));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons (port);
+    if (!bindAddr)
+        addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    else if (inet_pton (AF_INET, bindAddr, &addr.sin_addr) != 1)
+    {
+        doLog (ERROR, LOG_COMP, _("Invalid control port address %s."), bindAddr);
+        return -1;
+    }
+
+    ctlFd = socket (AF_INET, SOCK_DGRAM, 0);
+    if (ctlFd < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to create control socket."));
+        return -1;
+    }
+
+    if (bind (ctlFd, (struct sockaddr*)&addr, sizeof( addr )) < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to bind control port %d."), port);
+        close (ctlFd);
+        ctlFd = -1;
+        return -1;
+    }
+    evutil_make_socket_nonblocking (ctlFd);
+
+    ctlEv = event_new (eb, ctlFd, EV_READ | EV_PERSIST, readControl, NULL);
+    persistEv = evtimer_new (eb, persistPending, NULL);
+    if (!ctlEv || !persistEv)
+    {
+        lsdctl_close ();
+        return -1;
+    }
+    event_add (ctlEv, NULL);
+
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+
+void
+lsdctl_close ()
+{
+    lsdctl_flush ();
+
+    if (ctlEv)
+    {
+        event_del (ctlEv);
+        event_free (ctlEv);
+        ctlEv = NULL;
+    }
+    if (persistEv)
+    {
+        evtimer_del (persistEv);
+        event_free (persistEv);
+        persistEv = NULL;
+    }
+    if (ctlFd >= 0)
+    {
+        close (ctlFd);
+        ctlFd = -1;
+    }
+}
+
+
+void
+lsdctl_flush ()
+{
+    if (!numPending)
+        return;
+
+    if (persistEv)
+        evtimer_del (persistEv);
+
+    /* Node data is shared with the render thread */
+    lockScene ();
+    int inTxn = ( lsddb_beginRPC () == 0 );
+
+    int i;
+    for (i = 0; i < numPending; ++i)
+    {
+        /* The node may have been deleted since */
+        struct LSD_SceneNodeInst* inst =
+            lsdmap_get (getMap_lsdNodeInstMap (), pending[i].instId);
+        if (!inst || !inst->nodeClass->nodePersistFunc)
+            continue;
+
+        if (inst->nodeClass->nodePersistFunc (inst, inst->data,
+                                              pending[i].sub) < 0)
+            doLog (WARNING, LOG_COMP, _("Unable to save control value of node %d."),
+                   pending[i].instId);
+    }
+    numPending = 0;
+
+    if (inTxn)
+        lsddb_endRPC (0);
+    unlockScene ();
+}
+
+
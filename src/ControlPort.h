@@ -0,0 +1,68 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+
+#ifndef CONTROLPORT_H
+#define CONTROLPORT_H
+
+#include <event.h>
+
+/**
+  * Binary UDP endpoint for high-rate value updates from
+  *external controllers (faders, OSC bridges), bypassing HTTP
+  *and JSON. Values are applied to instance data between frames
+  *as they arrive; the DB is written later, with all changes
+  *since the last write coalesced into one transaction.
+  *
+  * Each datagram is the 4 bytes "LSC1" followed by records,
+  *all fields big-endian:
+  *
+  *   uint32  nodeId   node instance id
+  *   uint16  sub      value within the node (Colour Bank:
+  *                    picker id; otherwise 0)
+  *   uint8   count    number of values (1 to 4)
+  *   uint8   flags    reserved, 0
+  *   float32 vals[count]
+  *
+  * An Integer, Float or RGB Generator takes 1, 1 or 3 values.
+  *Records for nodes whose class takes no control values are
+  *skipped. Nothing is sent back.
+  *
+  * Datagrams are not authenticated. The port binds to loopback
+  *unless bindAddr (dotted IPv4) says otherwise.
+  */
+
+int
+lsdctl_open (struct event_base* eb, int port, const char* bindAddr);
+
+
+void
+lsdctl_close ();
+
+
+/* Writes values still waiting to be saved to the DB. Run before
+ * anything that rebuilds instance data from the DB */
+void
+lsdctl_flush ();
+
+
+#endif /* CONTROLPORT_H */
@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <sqlite3.h> /* For constants */
 
 #include "PluginAPI.h"
@@ -166,6 +167,38 @@ intGenDelete (struct LSD_SceneNodeInst const* inst, void* instData)
 }
 
 
+/* Control port funcs */
+int
+intGenControl (struct LSD_SceneNodeInst const* inst, void* instData,
+               int sub, const double* vals, int count)
+{
+    if (sub != 0 || count != 1)
+        return -1;
+
+    /* Clamped so the conversion is always defined */
+    double val = vals[0];
+    if (val >= INT_MAX)
+        *(int*)instData = INT_MAX;
+    else if (val <= INT_MIN)
+        *(int*)instData = INT_MIN;
+    else
+        *(int*)instData = (int)( val < 0 ? val - 0.5 : val + 0.5 );
+    return 0;
+}
+
+
+int
+intGenPersist (struct LSD_SceneNodeInst const* inst, void* instData, int sub)
+{
+    plugindb_reset (corePlugin, intGenUpdateStmt);
+    plugindb_bind_int (corePlugin, intGenUpdateStmt, 1, inst->dbId);
+    plugindb_bind_int (corePlugin, intGenUpdateStmt, 2, *(int*)instData);
+    if (plugindb_step (corePlugin, intGenUpdateStmt) != SQLITE_DONE)
+        return -1;
+    return 0;
+}
+
+
 /****** INT VIEW STUFF ******/
 
 static struct LSD_SceneNodeClass* intViewClass;
@@ -291,6 +324,32 @@ floatGenDelete (struct LSD_SceneNodeInst const* inst, void* instData)
 }
 
 
+/* Control port funcs */
+int
+floatGenControl (struct LSD_SceneNodeInst const* inst, void* instData,
+                 int sub, const double* vals, int count)
+{
+    if (sub != 0 || count != 1)
+        return -1;
+
+    *(double*)instData = vals[0];
+    return 0;
+}
+
+
+int
+floatGenPersist (struct LSD_SceneNodeInst const* inst, void* instData, int sub)
+{
+    plugindb_reset (corePlugin, floatGenUpdateStmt);
+    plugindb_bind_int (corePlugin, floatGenUpdateStmt, 1, inst->dbId);
+    plugindb_bind_double (corePlugin, floatGenUpdateStmt, 2,
+                          *(double*)instData);
+    if (plugindb_step (corePlugin, floatGenUpdateStmt) != SQLITE_DONE)
+        return -1;
+    return 0;
+}
+
+
 /****** FLOAT VIEW STUFF ******/
 
 static struct LSD_SceneNodeClass* floatViewClass;
@@ -418,6 +477,37 @@ rgbGenDelete (struct LSD_SceneNodeInst const* inst, void* instData)
 }
 
 
+/* Control port funcs */
+int
+rgbGenControl (struct LSD_SceneNodeInst const* inst, void* instData,
+               int sub, const double* vals, int count)
+{
+    if (sub != 0 || count != 3)
+        return -1;
+
+    struct RGB_TYPE* castData = (struct RGB_TYPE*)instData;
+    castData->r = vals[0];
+    castData->g = vals[1];
+    castData->b = vals[2];
+    return 0;
+}
+
+
+int
+rgbGenPersist (struct LSD_SceneNodeInst const* inst, void* instData, int sub)
+{
+    struct RGB_TYPE* castData = (struct RGB_TYPE*)instData;
+    plugindb_reset (corePlugin, rgbGenUpdateStmt);
+    plugindb_bind_int (corePlugin, rgbGenUpdateStmt, 1, inst->dbId);
+    plugindb_bind_double (corePlugin, rgbGenUpdateStmt, 2, castData->r);
+    plugindb_bind_double (corePlugin, rgbGenUpdateStmt, 3, castData->g);
+    plugindb_bind_double (corePlugin, rgbGenUpdateStmt, 4, castData->b);
+    if (plugindb_step (corePlugin, rgbGenUpdateStmt) != SQLITE_DONE)
+        return -1;
+    return 0;
+}
+
+
 /****** RGB VIEW STUFF ******/
 
 static struct LSD_SceneNodeClass* rgbViewClass;
@@ -531,6 +621,7 @@ struct TriggerCounter
     struct RGB_TYPE out;
     int triggerKnown;
     int inId;
+    struct LSD_InputBinding trigIn;
 };
 
 static struct LSD_SceneNodeClass* rgbTriggerClass;
@@ -545,22 +636,16 @@ rgbTriggerBufferOut (struct LSD_SceneNodeOutput const* output)
 {
     struct TriggerCounter* trigCount = output->parentNode->data;
 
-    struct LSD_SceneNodeInput const* trigIn;
-    plugininst_getInputStruct (output->parentNode, &trigIn, trigCount->inId);
-
-    if (trigIn && trigIn->connection)
+    int* curTrig = plugininst_bufferBoundInput (&trigCount->trigIn);
+    if (curTrig)
     {
-        int* curTrig = node_bufferOutput (trigIn->connection);
-        if (curTrig)
+        if (( *curTrig - trigCount->triggerKnown ) == 1)
         {
-            if (( *curTrig - trigCount->triggerKnown ) == 1)
-            {
-                ++trigCount->phase;
-                if (trigCount->phase > 2)
-                    trigCount->phase = 0;
-            }
-            trigCount->triggerKnown = *curTrig;
+            ++trigCount->phase;
+            if (trigCount->phase > 2)
+                trigCount->phase = 0;
         }
+        trigCount->triggerKnown = *curTrig;
     }
 
     if (trigCount->phase == 0)
@@ -637,8 +722,9 @@ rgbTriggerRestore (struct LSD_SceneNodeInst const* inst, void* instData)
         castData->inId = plugindb_column_int (corePlugin,
                                               rgbTriggerSelectStmt,
                                               0);
-        return 0;
+        return plugininst_bindInput (inst, &castData->trigIn, castData->inId);
     }
+    castData->trigIn.input = NULL;
     return -1;
 }
 
@@ -659,6 +745,21 @@ rgbTriggerDelete (struct LSD_SceneNodeInst const* inst, void* instData)
 }
 
 
+/* Class accessors */
+struct LSD_SceneNodeClass*
+core_getRGBGenClass ()
+{
+    return rgbGenClass;
+}
+
+
+struct LSD_SceneNodeClass*
+core_getRGBViewClass ()
+{
+    return rgbViewClass;
+}
+
+
 /* ******  Plugin members ****** */
 
 int
@@ -692,6 +793,8 @@ coreInit (struct LSD_ScenePlugin const* plugin)
                                   1,
                                   intGenBfFuncs,
                                   intGenBpFuncs);
+    plugininit_registerNodeControl (plugin, intGenClass, intGenControl,
+                                    intGenPersist);
 
     /* Register int viewer */
     plugininit_registerNodeClass (plugin,
@@ -720,6 +823,8 @@ coreInit (struct LSD_ScenePlugin const* plugin)
                                   3,
                                   floatGenBfFuncs,
                                   floatGenBpFuncs);
+    plugininit_registerNodeControl (plugin, floatGenClass, floatGenControl,
+                                    floatGenPersist);
 
     /* Register float viewer */
     plugininit_registerNodeClass (plugin,
@@ -748,6 +853,8 @@ coreInit (struct LSD_ScenePlugin const* plugin)
                                   5,
                                   rgbGenBfFuncs,
                                   rgbGenBpFuncs);
+    plugininit_registerNodeControl (plugin, rgbGenClass, rgbGenControl,
+                                    rgbGenPersist);
 
     /* Register rgb viewer */
     plugininit_registerNodeClass (plugin,
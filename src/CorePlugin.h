@@ -23,6 +23,8 @@
 #ifndef COREPLUGIN_H
 #define COREPLUGIN_H
 
+struct LSD_SceneNodeClass;
+
 struct RGB_TYPE
 {
     double r;
@@ -46,6 +48,14 @@ int
 core_getTriggerTypeID ();
 
 
+struct LSD_SceneNodeClass*
+core_getRGBGenClass ();
+
+
+struct LSD_SceneNodeClass*
+core_getRGBViewClass ();
+
+
 const struct LSD_ScenePluginHEAD*
 getCoreHead ();
 
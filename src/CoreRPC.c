@@ -29,11 +29,21 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "DBOps.h"
 #include "SceneCore.h"
 #include "PluginAPI.h"
 #include "Logging.h"
+#include "RPCMethods.h"
+#include "LiveStream.h"
+#include "ResponseCache.h"
+#include "ReloadStats.h"
+#include "ControlPort.h"
+#include "Metrics.h"
 
 /* Gettext stuff */
 #ifndef HW_RVL
@@ -47,6 +57,9 @@
 static const char LOG_COMP[] = "CoreRPC.c";
 
 
+/* Passes the request to the plugin owning nodeId. Registered
+ * twice: as lsdCustomQuery it runs read-only, for plugin calls
+ * that only read */
 void
 lsdCustomRPC (cJSON* req, cJSON* resp)
 {
@@ -60,8 +73,13 @@ lsdCustomRPC (cJSON* req, cJSON* resp)
             return;
         }
 
+        /* Plugin handlers work on their nodes' running state */
         if (plugin->handleRPC)
+        {
+            lockScene ();
             plugin->handleRPC (req, resp);
+            unlockScene ();
+        }
     }
     else
     {
@@ -73,30 +91,31 @@ lsdCustomRPC (cJSON* req, cJSON* resp)
 }
 
 
-void
-lsdJsonLibrary (cJSON* req, cJSON* resp)
+int
+lsdJsonLibrary (cJSON* req, struct LSD_JsonWriter* resp)
 {
     lsddb_jsonClassLibrary (resp);
+    return 0;
 }
 
 
-void
-lsdJsonPartitions (cJSON* req, cJSON* resp)
+int
+lsdJsonPartitions (cJSON* req, struct LSD_JsonWriter* resp)
 {
     lsddb_jsonParts (resp);
+    return 0;
 }
 
 
-void
-lsdJsonPatchSpace (cJSON* req, cJSON* resp)
+int
+lsdJsonPatchSpace (cJSON* req, struct LSD_JsonWriter* resp)
 {
     cJSON* psId = cJSON_GetObjectItem (req, "psId");
     if (psId && psId->type == cJSON_Number)
-        lsddb_jsonPatchSpace (psId->valueint, resp);
-    else
-        cJSON_AddStringToObject (resp,
-                                 "error",
-                                 _("psId key not present or not a number"));
+        return lsddb_jsonPatchSpace (psId->valueint, resp);
+
+    lsdjson_string (resp, "error", _("psId key not present or not a number"));
+    return -1;
 }
 
 
@@ -354,19 +373,23 @@ lsdSetFacadeColour (cJSON* req, cJSON* resp)
 }
 
 
-void
-lsdGetFacade (cJSON* req, cJSON* resp)
+int
+lsdGetFacade (cJSON* req, struct LSD_JsonWriter* resp)
 {
     cJSON* facNodeId = cJSON_GetObjectItem (req, "facNodeId");
-    if (facNodeId && facNodeId->type == cJSON_Number)
+    if (!facNodeId || facNodeId->type != cJSON_Number)
     {
-        if (lsddb_jsonFacade (facNodeId->valueint, resp) < 0)
-            cJSON_AddStringToObject (resp, "error", "error");
+        lsdjson_string (resp, "error", _("facNodeId not present or not a number"));
+        return -1;
     }
-    else
-        cJSON_AddStringToObject (resp,
-                                 "error",
-                                 _("facNodeId not present or not a number"));
+
+    if (lsddb_jsonFacade (facNodeId->valueint, resp) < 0)
+    {
+        lsdjson_string (resp, "error", "error");
+        return -1;
+    }
+
+    return 0;
 }
 
 
@@ -706,11 +729,16 @@ lsdPanPatchSpace (cJSON* req, cJSON* resp)
 }
 
 
-void
-lsdGetChannelPatch (cJSON* req, cJSON* resp)
+int
+lsdGetChannelPatch (cJSON* req, struct LSD_JsonWriter* resp)
 {
     if (lsddb_getPatchChannels (resp) < 0)
-        cJSON_AddStringToObject (resp, "error", _("Unable to get patch"));
+    {
+        lsdjson_string (resp, "error", _("Unable to get patch"));
+        return -1;
+    }
+
+    return 0;
 }
 
 
@@ -840,18 +868,23 @@ lsdCreateChannel (cJSON* req, cJSON* resp)
         return;
     }
 
-    if (lsddb_addPatchChannel (partId->valueint, req) < 0)
+    if (lsddb_addPatchChannel (partId->valueint, req, NULL) < 0)
         cJSON_AddStringToObject (resp, "error", "error");
     else
         cJSON_AddStringToObject (resp, "success", "success");
 }
 
 
-void
-lsdJsonPlugins (cJSON* req, cJSON* resp)
+int
+lsdJsonPlugins (cJSON* req, struct LSD_JsonWriter* resp)
 {
     if (lsddb_jsonPlugins (resp) < 0)
-        cJSON_AddStringToObject (resp, "error", _("unable to get plugins"));
+    {
+        lsdjson_string (resp, "error", _("unable to get plugins"));
+        return -1;
+    }
+
+    return 0;
 }
 
 
@@ -865,7 +898,8 @@ lsdDisablePlugin (cJSON* req, cJSON* resp)
         return;
     }
 
-    if (lsddb_disablePlugin (pId->valueint) < 0)
+    if (lsddb_unstructPlugin (pId->valueint) < 0 ||
+        lsddb_disablePlugin (pId->valueint) < 0)
         cJSON_AddStringToObject (resp, "error", _("Unable to disable plugin"));
     else
         cJSON_AddStringToObject (resp, "success", "success");
@@ -882,130 +916,308 @@ lsdEnablePlugin (cJSON* req, cJSON* resp)
         return;
     }
 
-    if (lsddb_enablePlugin (pId->valueint) < 0)
+    if (lsddb_enablePlugin (pId->valueint) < 0 ||
+        lsddb_structPlugin (pId->valueint) < 0)
         cJSON_AddStringToObject (resp, "error", _("Unable to enable plugin"));
     else
         cJSON_AddStringToObject (resp, "success", "success");
 }
 
 
-/* Main request brancher */
+void
+lsdCompactArrays (cJSON* req, cJSON* resp)
+{
+    if (lsddb_compactNodeArrays () < 0)
+        cJSON_AddStringToObject (resp, "error", _("Unable to compact arrays"));
+    else
+        cJSON_AddStringToObject (resp, "success", "success");
+}
+
+
+void
+lsdReloadStats (cJSON* req, cJSON* resp)
+{
+    int count = 0;
+    cJSON* countItem = cJSON_GetObjectItem (req, "count");
+    if (countItem && countItem->type == cJSON_Number)
+        count = countItem->valueint;
+
+    if (lsdstats_json (resp, count) < 0)
+        cJSON_AddStringToObject (resp, "error", _("Unable to get reload stats"));
+}
+
+
+/* Methods provided by the core; plugins add theirs at init.
+ * Those with large responses stream them (streamFunc) */
+struct CoreMethod
+{
+    const char* name;
+    rpcMethodFunc func;
+    rpcStreamFunc streamFunc;
+    int flags;
+};
+
+static const struct CoreMethod coreMethods[] =
+{
+    {"lsdJsonLibrary", NULL, lsdJsonLibrary, LSD_RPC_CACHED},
+    {"lsdJsonPartitions", NULL, lsdJsonPartitions, LSD_RPC_CACHED},
+    {"lsdJsonPatchSpace", NULL, lsdJsonPatchSpace, LSD_RPC_CACHED},
+    {"lsdAddNode", lsdAddNode, NULL, 0},
+    {"lsdDeleteNode", lsdDeleteNode, NULL, 0},
+    {"lsdUpdateNodeName", lsdUpdateNodeName, NULL, 0},
+    {"lsdSetNodeColour", lsdSetNodeColour, NULL, 0},
+    {"lsdAddFacade", lsdAddFacade, NULL, 0},
+    {"lsdDeleteFacade", lsdDeleteFacade, NULL, 0},
+    {"lsdUpdateFacadeName", lsdUpdateFacadeName, NULL, 0},
+    {"lsdSetFacadeColour", lsdSetFacadeColour, NULL, 0},
+    {"lsdGetFacade", NULL, lsdGetFacade, LSD_RPC_CACHED},
+    {"lsdCreateFacadeIn", lsdCreateFacadeIn, NULL, 0},
+    {"lsdDeleteFacadeIn", lsdDeleteFacadeIn, NULL, 0},
+    {"lsdUpdateFacadeIn", lsdUpdateFacadeIn, NULL, 0},
+    {"lsdCreateFacadeOut", lsdCreateFacadeOut, NULL, 0},
+    {"lsdDeleteFacadeOut", lsdDeleteFacadeOut, NULL, 0},
+    {"lsdUpdateFacadeOut", lsdUpdateFacadeOut, NULL, 0},
+    {"lsdWireNodes", lsdWireNodes, NULL, 0},
+    {"lsdUnwire", lsdUnwire, NULL, 0},
+    {"lsdPositionNode", lsdPositionNode, NULL, 0},
+    {"lsdPositionFacade", lsdPositionFacade, NULL, 0},
+    {"lsdPanPatchSpace", lsdPanPatchSpace, NULL, 0},
+    {"lsdGetChannelPatch", NULL, lsdGetChannelPatch, LSD_RPC_CACHED},
+    {"lsdCreatePartition", lsdCreatePartition, NULL, 0},
+    {"lsdDeletePartition", lsdDeletePartition, NULL, 0},
+    {"lsdUpdatePartition", lsdUpdatePartition, NULL, 0},
+    {"lsdUpdateChannel", lsdUpdateChannel, NULL, 0},
+    {"lsdDeleteChannel", lsdDeleteChannel, NULL, 0},
+    {"lsdCreateChannel", lsdCreateChannel, NULL, 0},
+    {"lsdJsonPlugins", NULL, lsdJsonPlugins, LSD_RPC_CACHED},
+    {"lsdDisablePlugin", lsdDisablePlugin, NULL, 0},
+    {"lsdEnablePlugin", lsdEnablePlugin, NULL, 0},
+    {"lsdCustomRPC", lsdCustomRPC, NULL, 0},
+    {"lsdCustomQuery", lsdCustomRPC, NULL, LSD_RPC_READONLY},
+    {"lsdCompactArrays", lsdCompactArrays, NULL, 0},
+    {"lsdReloadStats", lsdReloadStats, NULL, LSD_RPC_READONLY}
+};
+static const int coreMethodsLen = sizeof( coreMethods ) / sizeof( coreMethods[0] );
+
+
+/* Reloads run by methods; with the DB's change count this
+ * versions the state cached responses were built from */
+static unsigned int rpcMutations = 0;
+
+static unsigned long long
+stateVersion ()
+{
+    return ( (unsigned long long)rpcMutations << 32 ) |
+           (unsigned int)lsddb_changeCount ();
+}
+
+
+/* FNV-1a; tells apart the ETags of different requests made at
+ * the same state version */
+static unsigned long long
+hashKey (const char* key)
+{
+    unsigned long long h = 0xcbf29ce484222325ULL;
+    for (; *key; ++key)
+    {
+        h ^= (unsigned char)*key;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+
+/* Writes a response object holding only an error */
+static void
+writeError (struct LSD_JsonWriter* resp, const char* msg)
+{
+    lsdjson_beginObject (resp, NULL);
+    lsdjson_string (resp, "error", msg);
+    lsdjson_endObject (resp);
+}
+
+
+/* Main request brancher; writes the method's response object.
+ * Returns 0 on success, 1 if the method failed, or 2 if it
+ * failed and its changes were rolled back (in-memory state is
+ * stale until the reload) */
 int
-handleJSONRequest (cJSON* req, cJSON* resp, int* reloadAfter)
+handleJSONRequest (cJSON* req, struct LSD_JsonWriter* resp, int* reloadAfter)
 {
     cJSON* method = cJSON_GetObjectItem (req, "method");
-    if (method && method->type == cJSON_String)
-    {
-
-        /* Conditionally choose correct code path for method
-         * in question */
-        if (strcasecmp (method->valuestring, "lsdJsonLibrary") == 0)
-            lsdJsonLibrary (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdJsonPartitions") == 0)
-            lsdJsonPartitions (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdJsonPatchSpace") == 0)
-            lsdJsonPatchSpace (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdAddNode") == 0)
-            lsdAddNode (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdDeleteNode") == 0)
-            lsdDeleteNode (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdUpdateNodeName") == 0)
-            lsdUpdateNodeName (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdSetNodeColour") == 0)
-            lsdSetNodeColour (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdAddFacade") == 0)
-            lsdAddFacade (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdDeleteFacade") == 0)
-            lsdDeleteFacade (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdUpdateFacadeName") == 0)
-            lsdUpdateFacadeName (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdSetFacadeColour") == 0)
-            lsdSetFacadeColour (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdGetFacade") == 0)
-            lsdGetFacade (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdCreateFacadeIn") == 0)
-            lsdCreateFacadeIn (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdDeleteFacadeIn") == 0)
-            lsdDeleteFacadeIn (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdUpdateFacadeIn") == 0)
-            lsdUpdateFacadeIn (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdCreateFacadeOut") == 0)
-            lsdCreateFacadeOut (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdDeleteFacadeOut") == 0)
-            lsdDeleteFacadeOut (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdUpdateFacadeOut") == 0)
-            lsdUpdateFacadeOut (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdWireNodes") == 0)
-            lsdWireNodes (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdUnwire") == 0)
-            lsdUnwire (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdPositionNode") == 0)
-            lsdPositionNode (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdPositionFacade") == 0)
-            lsdPositionFacade (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdPanPatchSpace") == 0)
-            lsdPanPatchSpace (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdGetChannelPatch") == 0)
-            lsdGetChannelPatch (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdCreatePartition") == 0)
-        {
-            lsdCreatePartition (req, resp);
-            *reloadAfter = 1;
-        }
-        else if (strcasecmp (method->valuestring, "lsdDeletePartition") == 0)
-        {
-            lsdDeletePartition (req, resp);
-            *reloadAfter = 1;
-        }
-        else if (strcasecmp (method->valuestring, "lsdUpdatePartition") == 0)
-            lsdUpdatePartition (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdUpdateChannel") == 0)
-        {
-            lsdUpdateChannel (req, resp);
-            *reloadAfter = 1;
-        }
-        else if (strcasecmp (method->valuestring, "lsdDeleteChannel") == 0)
-        {
-            lsdDeleteChannel (req, resp);
-            *reloadAfter = 1;
-        }
-        else if (strcasecmp (method->valuestring, "lsdCreateChannel") == 0)
-        {
-            lsdCreateChannel (req, resp);
-            *reloadAfter = 1;
-        }
-        else if (strcasecmp (method->valuestring, "lsdJsonPlugins") == 0)
-            lsdJsonPlugins (req, resp);
-        else if (strcasecmp (method->valuestring, "lsdDisablePlugin") == 0)
-        {
-            lsdDisablePlugin (req, resp);
-            *reloadAfter = 1;
-        }
-        else if (strcasecmp (method->valuestring, "lsdEnablePlugin") == 0)
-        {
-            lsdEnablePlugin (req, resp);
-            *reloadAfter = 1;
-        }
-        else if (strcasecmp (method->valuestring, "lsdCustomRPC") == 0)
-            lsdCustomRPC (req, resp);
+    if (!method || method->type != cJSON_String)
+    {
+        writeError (resp, _("Method key is not present or not a string"));
+        return 1;
+    }
 
-        else
-            cJSON_AddStringToObject (
-                resp,
-                "error",
-                _("Specified method is not handled by this version of LSD"));
+    struct LSD_RPCMethod const* entry =
+        lsdrpc_lookupMethod (method->valuestring);
+    if (!entry)
+    {
+        writeError (resp,
+                    _("Specified method is not handled by this version of LSD"));
+        return 1;
+    }
 
+    struct timeval start;
+    gettimeofday (&start, NULL);
+
+    /* The method may (un)register others, moving entry. Metrics
+     * are labelled with the registered name, not the caller's
+     * casing, so clients can't mint new series */
+    char name[64];
+    snprintf (name, sizeof( name ), "%s", entry->name);
+    int flags = entry->flags;
+    rpcMethodFunc func = entry->func;
+    rpcStreamFunc streamFunc = entry->streamFunc;
+
+    /* Instance data may be rebuilt from the DB; save control
+     * port values first so they aren't reverted */
+    if (!( flags & LSD_RPC_READONLY ))
+        lsdctl_flush ();
+
+    /* Core methods run alongside the render thread and take the
+     * scene lock only around their in-memory edits (see DBOps.c).
+     * A plugin's method may touch its nodes anywhere, so it waits
+     * for a frame boundary and holds the lock throughout */
+    int sceneLocked = ( entry->plugin != NULL );
+    if (sceneLocked)
+        lockScene ();
+
+    /* Run the whole method as one transaction */
+    int inTxn = !( flags & LSD_RPC_READONLY ) &&
+                ( lsddb_beginRPC () == 0 );
+
+    int failed;
+    if (streamFunc)
+    {
+        int depth = resp->depth;
+        lsdjson_beginObject (resp, NULL);
+        failed = ( streamFunc (req, resp) < 0 );
+        lsdjson_closeTo (resp, depth);
     }
     else
-        cJSON_AddStringToObject (resp,
-                                 "error",
-                                 _("Method key is not present or not a string"));
-        /* return -1; */
+    {
+        /* Plugin methods build a tree; splice it in printed */
+        cJSON* respObj = cJSON_CreateObject ();
+        func (req, respObj);
+        failed = ( cJSON_GetObjectItem (respObj, "error") != NULL );
+
+        char* respStr = cJSON_PrintUnformatted (respObj);
+        lsdjson_raw (resp, NULL, respStr, strlen (respStr));
+        free (respStr);
+        cJSON_Delete (respObj);
+    }
+
+    if (sceneLocked)
+        unlockScene ();
+
+    /* Commit, or undo a failed method and rebuild state from
+     * the restored DB */
+    int rolledBack = ( inTxn && lsddb_endRPC (failed) > 0 );
+    lsdmetrics_rpc (name, lsdstats_since (&start));
+    if (rolledBack)
+    {
+        *reloadAfter = 1;
+        return 2;
+    }
+    else if (!failed && ( flags & LSD_RPC_RELOAD ))
+    {
+        /* Writes move the DB's change count; a reload may also
+         * change what is built from the DB */
+        ++rpcMutations;
+        *reloadAfter = 1;
+    }
+
+    return failed;
+}
+
+
+/* Runs an array of method objects in one transaction, writing
+ * an array of their responses. Reloads any of them request are
+ * left to the caller to run once, after the whole batch. A
+ * method whose changes had to be rolled back leaves the scene
+ * stale, so the methods after it are not run */
+static void
+handleJSONBatch (cJSON* batch, struct LSD_JsonWriter* resp, int* reloadAfter)
+{
+    lsdjson_beginArray (resp, NULL);
+
+    int count = cJSON_GetArraySize (batch);
+    if (count == 0)
+    {
+        writeError (resp, _("Batch contains no methods"));
+        lsdjson_endArray (resp);
+        return;
+    }
+
+    int inBatch = ( lsddb_beginBatch () == 0 );
+    int stale = 0;
+
+    int i;
+    for (i = 0; i < count; ++i)
+    {
+        cJSON* req = cJSON_GetArrayItem (batch, i);
+
+        if (stale)
+            writeError (resp,
+                        _("Not run: an earlier method in the batch was rolled back"));
+        else if (req->type != cJSON_Object)
+            writeError (resp, _("Batch entry is not a method object"));
+        else if (handleJSONRequest (req, resp, reloadAfter) == 2)
+            stale = 1;
+    }
+
+    if (inBatch)
+        lsddb_endBatch ();
+
+    lsdjson_endArray (resp);
+}
+
+
+/* Request log for lsdreplay; NULL when not recording */
+static FILE* recordFile = NULL;
+static struct timeval recordStart;
+
+int
+openRPCRecord (const char* path)
+{
+    recordFile = fopen (path, "w");
+    if (!recordFile)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to open RPC record file %s."), path);
+        return -1;
+    }
+    gettimeofday (&recordStart, NULL);
+    doLog (NOTICE, LOG_COMP, _("Recording RPC requests to %s."), path);
 
     return 0;
 }
 
 
+void
+closeRPCRecord ()
+{
+    if (recordFile)
+        fclose (recordFile);
+    recordFile = NULL;
+}
+
+
+static void
+recordRequest (const unsigned char* body, size_t len)
+{
+    fprintf (recordFile, "%ld\t", lsdstats_since (&recordStart));
+
+    /* JSON only has raw newlines between tokens */
+    size_t i;
+    for (i = 0; i < len; ++i)
+        fputc (body[i] == '\n' || body[i] == '\r' ? ' ' : body[i], recordFile);
+    fputc ('\n', recordFile);
+}
+
+
 /* Callback for requests made to RPC */
 void
 rpcReqCB (struct evhttp_request* req, void* arg)
@@ -1018,36 +1230,82 @@ rpcReqCB (struct evhttp_request* req, void* arg)
      * overflows are bad) */
     evbuffer_add_printf (inputPostBuf, "%c", '\0');
     const unsigned char* inputPost = evbuffer_pullup (inputPostBuf, -1);
+    if (recordFile)
+        recordRequest (inputPost, evbuffer_get_length (inputPostBuf) - 1);
 
     /* Setup json objects for parsing/returning */
     cJSON* input = cJSON_Parse ((const char*)inputPost);
-    cJSON* returnjson = cJSON_CreateObject ();
-
-    if (input)
+    struct evbuffer* repBuf = evbuffer_new ();
+    struct LSD_JsonWriter writer;
+    lsdjson_init (&writer, repBuf);
+    struct evkeyvalq* outHeaders = evhttp_request_get_output_headers (req);
+    evhttp_add_header (outHeaders, "Content-Type", "application/json");
+
+    /* Cacheable method: serve a response built at the current
+     * state version if there is one, else build and keep it */
+    char* cacheKey = NULL;
+    unsigned long long ver = 0;
+    char etag[48];
+    if (input && input->type == cJSON_Object)
     {
-        if (handleJSONRequest (input, returnjson, &reloadAfter) < 0)
-            doLog (ERROR, LOG_COMP, _("There was a problem while running RPC handler."));
+        cJSON* method = cJSON_GetObjectItem (input, "method");
+        struct LSD_RPCMethod const* entry = NULL;
+        if (method && method->type == cJSON_String)
+            entry = lsdrpc_lookupMethod (method->valuestring);
+        if (entry && ( entry->flags & LSD_RPC_CACHED ) == LSD_RPC_CACHED)
+            cacheKey = cJSON_PrintUnformatted (input);
+    }
+    if (cacheKey)
+    {
+        /* Only responses that can be cached are tagged; the tag
+         * names both the request and the state it was built at */
+        ver = stateVersion ();
+        snprintf (etag, sizeof( etag ), "\"%llx-%llx\"", ver,
+                  hashKey (cacheKey));
+
+        const char* inm = evhttp_find_header (
+            evhttp_request_get_input_headers (req), "If-None-Match");
+        size_t cachedLen;
+        const char* cached;
+        if (inm && strcmp (inm, etag) == 0)
+        {
+            evhttp_add_header (outHeaders, "ETag", etag);
+            evhttp_send_reply (req, 304, "Not Modified", NULL);
+            goto done;
+        }
+        else if (( cached = lsdcache_get (cacheKey, ver, &cachedLen) ))
+        {
+            evhttp_add_header (outHeaders, "ETag", etag);
+            evbuffer_add (repBuf, cached, cachedLen);
+            evhttp_send_reply (req, 200, "OK", repBuf);
+            goto done;
+        }
     }
+
+    /* Results are written straight into the HTTP reply buffer */
+    int failed = 0;
+    if (input && input->type == cJSON_Array)
+        /* Batch: one result per method, in order */
+        handleJSONBatch (input, &writer, &reloadAfter);
+    else if (input)
+        failed = handleJSONRequest (input, &writer, &reloadAfter);
     else
-        cJSON_AddStringToObject (returnjson,
-                                 "error",
-                                 _("Unable to parse any JSON from HTTP POST data"));
+        writeError (&writer, _("Unable to parse any JSON from HTTP POST data"));
 
-    struct evbuffer* repBuf = evbuffer_new ();
+    if (cacheKey && !failed)
+    {
+        evhttp_add_header (outHeaders, "ETag", etag);
+        lsdcache_put (cacheKey, ver,
+                      (const char*)evbuffer_pullup (repBuf, -1),
+                      evbuffer_get_length (repBuf));
+    }
 
-    /* Print results into HTTP reply buffer */
-    char* returnjsonStr = cJSON_PrintUnformatted (returnjson);
-    evbuffer_add_printf (repBuf, "%s", returnjsonStr);
-    free (returnjsonStr);
+    evhttp_send_reply (req, 200, "OK", repBuf);
 
+done:
     /* Memory leaks are bad... very bad */
-    cJSON_Delete (returnjson);
+    free (cacheKey);
     cJSON_Delete (input);
-
-    evhttp_add_header (evhttp_request_get_output_headers (req), 
-                       "Content-Type", "application/json");
-    evhttp_send_reply (req, 200, "OK", repBuf);
-
     evbuffer_free (repBuf);
 
     if (reloadAfter)
@@ -1094,27 +1352,78 @@ static const int mTableLen = 7;
 
 static const char miscMime[] = "application/octet-stream";
 
+/* Core web files only change with an install; plugin files may
+ * be replaced while running, so those always revalidate */
+static const int CORE_MAX_AGE = 3600;
+
+/* Opens a regular file for serving; -1 if missing or not one */
+static int
+_openServed (const char* path, struct stat* st)
+{
+    int fd = open (path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    if (fstat (fd, st) < 0 || !S_ISREG (st->st_mode))
+    {
+        close (fd);
+        return -1;
+    }
+    return fd;
+}
+
+
+/* Serves path with validators so unchanged files cost a 304,
+ * preferring a pre-compressed path.gz when the client takes
+ * gzip. Files are handed to evbuffer_add_file () (sendfile
+ * where available) rather than copied. maxAge is the
+ * Cache-Control max-age in seconds; 0 revalidates every time */
 void
-_serveFile (struct evhttp_request* req, const char* path)
+_serveFile (struct evhttp_request* req, const char* uriPath, int maxAge)
 {
-    /* No directories allowed */
+    /* Drop any query string */
+    char path[256];
+    snprintf (path, 256, "%s", uriPath);
+    char* query = strchr (path, '?');
+    if (query)
+        *query = '\0';
+
+    /* No directories allowed, nor climbing out of one */
     int last = strlen (path);
-    if (path[last-1] == '/')
+    if (last == 0 || path[last-1] == '/')
     {
         _serveFileErr (req, "Unable to list directories.");
         return;
     }
-    
-    /* Open file and check its presence */
-    FILE* toServe;
-    toServe = fopen (path, "rb");
-    if (!toServe)
+    if (strstr (path, "/.."))
+    {
+        _serveFileErr (req, "Unable to open file requested.");
+        return;
+    }
+
+    struct evkeyvalq* inHeaders = evhttp_request_get_input_headers (req);
+    struct evkeyvalq* outHeaders = evhttp_request_get_output_headers (req);
+
+    /* Open file (or its compressed twin) and check its presence */
+    struct stat st;
+    int fd = -1;
+    int gzipped = 0;
+    const char* accept = evhttp_find_header (inHeaders, "Accept-Encoding");
+    if (accept && strstr (accept, "gzip"))
+    {
+        char gzPath[260];
+        snprintf (gzPath, 260, "%s.gz", path);
+        fd = _openServed (gzPath, &st);
+        gzipped = ( fd >= 0 );
+    }
+    if (fd < 0)
+        fd = _openServed (path, &st);
+    if (fd < 0)
     {
         _serveFileErr (req, "Unable to open file requested.");
         return;
     }
-            
-    /* Find mime type of opened file */
+
+    /* Find mime type of requested file */
     const char* fileExt;
     const char* mimeType;
     fileExt = strrchr (path, '.');
@@ -1136,35 +1445,56 @@ _serveFile (struct evhttp_request* req, const char* path)
     mimeType = miscMime;
     
 mimeDone:
-        
-    /* Attach mime to request */
-    evhttp_add_header (evhttp_request_get_output_headers (req),
-                       "Content-Type", mimeType);
-    
-    /* get file length */
-    size_t fileLen;
-    fseek (toServe, 0, SEEK_END);
-    fileLen = ftell (toServe);
-    fseek (toServe, 0, SEEK_SET);
+
+    /* Validators from size and mtime */
+    char etag[64];
+    snprintf (etag, 64, "\"%llx-%llx%s\"", (unsigned long long)st.st_size,
+              (unsigned long long)st.st_mtime, gzipped ? "-gz" : "");
+    char lastMod[64];
+    strftime (lastMod, 64, "%a, %d %b %Y %H:%M:%S GMT", gmtime (&st.st_mtime));
+    char cacheCtl[64];
+    if (maxAge > 0)
+        snprintf (cacheCtl, 64, "public, max-age=%d", maxAge);
+    else
+        snprintf (cacheCtl, 64, "no-cache");
+
+    evhttp_add_header (outHeaders, "ETag", etag);
+    evhttp_add_header (outHeaders, "Last-Modified", lastMod);
+    evhttp_add_header (outHeaders, "Cache-Control", cacheCtl);
+    evhttp_add_header (outHeaders, "Vary", "Accept-Encoding");
+
+    /* Client's copy still good? If-None-Match wins when sent */
+    const char* inm = evhttp_find_header (inHeaders, "If-None-Match");
+    const char* ims = evhttp_find_header (inHeaders, "If-Modified-Since");
+    if (( inm && ( strstr (inm, etag) || strcmp (inm, "*") == 0 ) ) ||
+        ( !inm && ims && strcmp (ims, lastMod) == 0 ))
+    {
+        close (fd);
+        evhttp_send_reply (req, 304, "Not Modified", NULL);
+        return;
+    }
+
+    /* Attach mime and length to request */
+    evhttp_add_header (outHeaders, "Content-Type", mimeType);
+    if (gzipped)
+        evhttp_add_header (outHeaders, "Content-Encoding", "gzip");
+
     char sfileLen[32];
-    snprintf (sfileLen, 32, "%d", (int)fileLen);
-    
-    /* Attach length to request */
-    evhttp_add_header (evhttp_request_get_output_headers (req),
-                       "Content-Length", sfileLen);
-        
-    /* Create and fill buffer with file content */
-#define BUFFERCHUNK 2048
-    struct evbuffer* fileBuf = evbuffer_new();
-    char chunkBuf[BUFFERCHUNK];
-    int readSize = BUFFERCHUNK;
-    
-    while (readSize == BUFFERCHUNK)
+    snprintf (sfileLen, 32, "%lld", (long long)st.st_size);
+    evhttp_add_header (outHeaders, "Content-Length", sfileLen);
+
+    /* The buffer takes ownership of fd, but only once the
+     * file is added */
+    struct evbuffer* fileBuf = evbuffer_new ();
+    if (!fileBuf || evbuffer_add_file (fileBuf, fd, 0, st.st_size) < 0)
     {
-        readSize = fread (chunkBuf, 1, BUFFERCHUNK, toServe);
-        evbuffer_add (fileBuf, chunkBuf, readSize);
+        close (fd);
+        if (fileBuf)
+            evbuffer_free (fileBuf);
+        _serveFileErr (req, "Unable to read file requested.");
+        return;
     }
-    
+
     evhttp_send_reply (req, 200, "OK", fileBuf);
     evbuffer_free (fileBuf);
 }
@@ -1179,7 +1509,7 @@ serveFileCore (struct evhttp_request* req)
     char comppath[256];
     const char* subpath = req->uri + urlPrefixLen;
     snprintf (comppath, 256, "%s%s", WEB_DIR, subpath);
-    _serveFile (req, comppath);
+    _serveFile (req, comppath, CORE_MAX_AGE);
 #endif
 }
 
@@ -1194,7 +1524,7 @@ serveFilePlugin (struct evhttp_request* req)
     /* Length of prefix + "/plugins" */
     const char* subpath = req->uri + urlPrefixLen + 8;
     snprintf (comppath, 256, "%s%s", WEB_PLUGIN_DIR, subpath);
-    _serveFile (req, comppath);
+    _serveFile (req, comppath, 0);
 #endif
 }
 
@@ -1273,6 +1603,21 @@ openRPC (struct event_base* ebin, int port, const char* prefix)
     urlPrefix = prefix;
     urlPrefixLen = strlen (prefix);
     char compPrefix[256];
+
+    /* Build the method table */
+    if (lsdrpc_initMethods (coreMethodsLen) < 0)
+        return -1;
+    int i;
+    for (i = 0; i < coreMethodsLen; ++i)
+    {
+        struct CoreMethod const* cm = &coreMethods[i];
+        int rc = cm->streamFunc ?
+                 lsdrpc_registerStreamMethod (cm->name, cm->streamFunc,
+                                              cm->flags) :
+                 lsdrpc_registerMethod (cm->name, cm->func, NULL, cm->flags);
+        if (rc < 0)
+            return -1;
+    }
     
     eb = ebin;
     eh = evhttp_new (eb);
@@ -1283,6 +1628,9 @@ openRPC (struct event_base* ebin, int port, const char* prefix)
     
     snprintf (compPrefix, 256, "%s/main/rpc", prefix);
     evhttp_set_cb (eh, compPrefix, rpcReqCB, NULL);
+
+    snprintf (compPrefix, 256, "%s/main/stream", prefix);
+    evhttp_set_cb (eh, compPrefix, lsdstream_requestCB, NULL);
     
     snprintf (compPrefix, 256, "%s/main/", prefix);
     evhttp_set_cb (eh, compPrefix, srvIndexCB, NULL);
@@ -1290,6 +1638,9 @@ openRPC (struct event_base* ebin, int port, const char* prefix)
     snprintf (compPrefix, 256, "%s/main", prefix);
     evhttp_set_cb (eh, compPrefix, mainRedirect, NULL);
     
+    /* Prometheus scrapes, outside the prefix like other exporters */
+    evhttp_set_cb (eh, "/metrics", lsdmetrics_requestCB, NULL);
+
     evhttp_set_cb (eh, "/", mainRedirect, NULL);
     evhttp_set_cb (eh, "", mainRedirect, NULL);
     
@@ -1301,7 +1652,10 @@ openRPC (struct event_base* ebin, int port, const char* prefix)
 int
 closeRPC ()
 {
+    lsdstream_closeAll ();
     evhttp_free (eh);
+    lsdrpc_finishMethods ();
+    lsdcache_clear ();
 
     return 0;
 }
@@ -36,4 +36,15 @@ int
 closeRPC ();
 
 
+/* Writes every RPC request body to path for later replay by
+ * lsdreplay, one per line as "<usec>\t<body>"; usec counts from
+ * when recording began. Newlines in bodies become spaces */
+int
+openRPCRecord (const char* path);
+
+
+void
+closeRPCRecord ();
+
+
 #endif /* CORERPC_H */
@@ -34,3 +34,12 @@ ARRAY (lsdPluginArr);
 ARRAY (lsdPartitionArr);
 ARRAY (lsdUnivArr);
 ARRAY (lsdChannelArr);
+
+#define MAP(map) static struct LSD_IdMap map; \
+    struct LSD_IdMap* getMap_ ## map (){return &map; }
+
+MAP (lsdNodeInstMap);
+MAP (lsdNodeInputMap);
+MAP (lsdNodeOutputMap);
+MAP (lsdFacadeInMap);
+MAP (lsdFacadeOutMap);
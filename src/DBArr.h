@@ -24,6 +24,7 @@
 #define DBARR_H
 
 #include "Array.h"
+#include "IdMap.h"
 
 /* Global ArrayHead Variables */
 /* ONLY INCLUDE THIS FILE IN DBOps.c! */
@@ -40,6 +41,19 @@ ARRAYH (lsdPartitionArr);
 ARRAYH (lsdUnivArr);
 ARRAYH (lsdChannelArr);
 
+/* Global id -> element pointer maps (kept in step with the
+ * node arrays above) */
+
+#define MAPH(map) struct LSD_IdMap* getMap_ ## map ()
+
+MAPH (lsdNodeInstMap);
+MAPH (lsdNodeInputMap);
+MAPH (lsdNodeOutputMap);
+
+/* Facade plug id -> terminal node plug id (alias closure) */
+MAPH (lsdFacadeInMap);
+MAPH (lsdFacadeOutMap);
+
 /* Note: LSD_Addr objects are composited into triples within
  * LSD_Channel objects. */
 
@@ -51,18 +51,27 @@ static const int STDMUL = 50;
                                  destructor) < 0) \
     {doLog (ERROR, LOG_COMP, _("Error while establishing array: %d."), num); return -1; }
 
+#define MAKEMAP(map, num) if (lsdmap_init (getMap_ ## map (), STDMUL) < 0) \
+    {doLog (ERROR, LOG_COMP, _("Error while establishing map: %d."), num); return -1; }
+
 int
 initLsdArrays ()
 {
-    MAKE (lsdDBStmtArr, LSD_SceneDBStmt, 0, destruct_SceneDBStmt, 1);
+    MAKE (lsdDBStmtArr, LSD_SceneDBStmt, 1, destruct_SceneDBStmt, 1);
     MAKE (lsdNodeInstArr, LSD_SceneNodeInst, 1, destruct_SceneNodeInst, 2);
-    MAKE (lsdNodeClassArr, LSD_SceneNodeClass, 0, NULL, 3);
+    MAKE (lsdNodeClassArr, LSD_SceneNodeClass, 1, NULL, 3);
     MAKE (lsdNodeInputArr, LSD_SceneNodeInput, 1, NULL, 4);
     MAKE (lsdNodeOutputArr, LSD_SceneNodeOutput, 1, destruct_SceneNodeOutput, 5);
-    MAKE (lsdPluginArr, LSD_ScenePlugin, 0, destruct_ScenePlugin, 7);
-    MAKE (lsdPartitionArr, LSD_Partition, 0, NULL, 8);
+    MAKE (lsdPluginArr, LSD_ScenePlugin, 1, destruct_ScenePlugin, 7);
+    MAKE (lsdPartitionArr, LSD_Partition, 1, NULL, 8);
     MAKE (lsdUnivArr, LSD_Univ, 0, destruct_Univ, 9);
-    MAKE (lsdChannelArr, LSD_Channel, 0, NULL, 10);
+    MAKE (lsdChannelArr, LSD_Channel, 1, NULL, 10);
+
+    MAKEMAP (lsdNodeInstMap, 11);
+    MAKEMAP (lsdNodeInputMap, 12);
+    MAKEMAP (lsdNodeOutputMap, 13);
+    MAKEMAP (lsdFacadeInMap, 14);
+    MAKEMAP (lsdFacadeOutMap, 15);
 
     return 0;
 }
@@ -86,6 +95,12 @@ clearLsdArrays ()
     CLEAR (lsdUnivArr);
     CLEAR (lsdChannelArr);
 
+    lsdmap_clear (getMap_lsdNodeInstMap ());
+    lsdmap_clear (getMap_lsdNodeInputMap ());
+    lsdmap_clear (getMap_lsdNodeOutputMap ());
+    lsdmap_clear (getMap_lsdFacadeInMap ());
+    lsdmap_clear (getMap_lsdFacadeOutMap ());
+
     return problem;
 }
 
@@ -26,12 +26,19 @@
 #include "DBArr.h"
 #include "SceneCore.h"
 #include "PluginAPI.h"
+#include "PluginAPICore.h"
 #include "PluginLoader.h"
 #include "Logging.h"
+#include "ReloadStats.h"
+#include "Metrics.h"
 
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include <ltdl.h>
+#ifndef HW_RVL
+#include <pthread.h>
+#endif
 
 /* Gettext stuff */
 #ifndef HW_RVL
@@ -75,8 +82,56 @@ int
 lsddb_rewireNodes ();
 
 
+static void
+lsddb_forgetInputAlias (int facadeInId);
+
+
+static void
+lsddb_forgetOutputAlias (int facadeOutId);
+
+
+static int
+lsddb_restoreSnapshot ();
+
+
+static int
+lsddb_structChannelId (int chanId);
+
+
+static int
+lsddb_unstructChannel (int chanId);
+
+
+static int
+lsddb_structPartition (int partId);
+
+
+static int
+lsddb_unstructPartition (int partId);
+
+
+static int
+lsddb_rewireDangling ();
+
+
+static int
+lsddb_retraceChannels ();
+
+
+/* The scene DB. Normally an in-memory copy of the show file;
+ * when opened with lsddb_openDirectDB() it is the file itself */
 static sqlite3* memdb;
 
+/* Set when memdb is the show file (WAL mode) rather than a copy */
+static int directDB = 0;
+
+/* Current reload generation, mirrored from SceneGeneration */
+static int arrGen = 0;
+
+/* Reads a structure index column as -1 unless it was written
+ * during the current generation */
+#define CUR_IDX(col) "CASE WHEN arrGen=lsdgen() THEN " col " ELSE -1 END"
+
 void
 destruct_SceneDBStmt (void* dbStmt)
 {
@@ -98,6 +153,7 @@ lsddb_emptyDB ()
     if (rc == SQLITE_OK)
     {
         memdb = memory;
+        lsdmetrics_watchDB (memdb);
         if (lsddb_initDB () < 0)
         {
             doLog (ERROR, LOG_COMP, _("There was a problem initing DB."));
@@ -141,6 +197,7 @@ lsddb_openDB (const char* path)
                 /* Done with file */
                 sqlite3_close (file);
                 memdb = memory;
+                lsdmetrics_watchDB (memdb);
                 if (lsddb_initDB () < 0)
                 {
                     doLog (ERROR, LOG_COMP, _("There was a problem initing DB at open."));
@@ -182,12 +239,72 @@ lsddb_openDB (const char* path)
 }
 
 
+/* Runs directly on the show file instead of copying it into
+ * memory first. Startup cost is then independent of show size;
+ * WAL journaling, a large page cache and mmap I/O keep edits and
+ * lookups close to in-memory speed. */
+static const char DIRECT_PRAGMAS[] =
+    "PRAGMA journal_mode=WAL;\n"
+    "PRAGMA synchronous=NORMAL;\n"
+    "PRAGMA cache_size=-65536;\n"
+    "PRAGMA mmap_size=268435456;\n";
+
+int
+lsddb_openDirectDB (const char* path)
+{
+    if (!path)
+    {
+        doLog (ERROR, LOG_COMP, _("Error while opening DB: Path not specified."));
+        return -1;
+    }
+
+    sqlite3* file;
+    if (sqlite3_open (path, &file) != SQLITE_OK)
+    {
+        doLog (ERROR, LOG_COMP, _("Error while opening file DB: %s"),
+               sqlite3_errmsg (file));
+        sqlite3_close (file);
+        return -1;
+    }
+
+    char* errMsg = NULL;
+    sqlite3_exec (file, DIRECT_PRAGMAS, NULL, NULL, &errMsg);
+    if (errMsg)
+    {
+        doLog (WARNING, LOG_COMP, _("Unable to tune file DB: %s"), errMsg);
+        sqlite3_free (errMsg);
+    }
+
+    memdb = file;
+    directDB = 1;
+    lsdmetrics_watchDB (memdb);
+    if (lsddb_initDB () < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("There was a problem initing DB at open."));
+        return -1;
+    }
+    if (lsddb_prepStmts () < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("There was a problem preparing DB statements while opening DB."));
+        return -1;
+    }
+    return 0;
+}
+
+
 int
 lsddb_saveDB (const char* origPath)
 {
     int rc;
     sqlite3* file;
 
+    /* Already on file; just fold the WAL back in */
+    if (directDB && memdb)
+    {
+        sqlite3_wal_checkpoint (memdb, NULL);
+        return 0;
+    }
+
     if (origPath && memdb)
     {
         rc = sqlite3_open (origPath, &file);
@@ -227,14 +344,19 @@ lsddb_autoSaveDB (const char* origPath)
     sqlite3* file;
     char newpath[256];
 
+    if (!origPath)
+    {
+        doLog (ERROR, LOG_COMP, _("Error while saving DB: path AND memdb must not be NULL."));
+        return -1;
+    }
+
     int pathlen = strlen (origPath);
     if (pathlen > 250)
     {
         doLog (ERROR, LOG_COMP, _("Error while autosaving DB: pathname too long."));
         return -1;
     }
-    strcat (newpath, origPath);
-    strcat (newpath, ".auto");
+    snprintf (newpath, sizeof( newpath ), "%s.auto", origPath);
 
     if (origPath && memdb)
     {
@@ -268,14 +390,303 @@ lsddb_autoSaveDB (const char* origPath)
 }
 
 
+/* Incremental persistence.
+ * The memory DB is first copied into an in-memory staging DB a
+ * few pages at a time from the main thread (no I/O, so each
+ * step is cheap and bounded). Once the snapshot is complete it is
+ * written to the file by a write-behind thread, so the journal
+ * and fsync cost never lands on the event loop. SQLite's rollback
+ * journal on the file keeps the previous save intact if the
+ * process dies mid-write. */
+static sqlite3* persistStage = NULL;
+static sqlite3_backup* persistBackup = NULL;
+static int persistedChanges = -1;
+static int persistSnapChanges;
+
+#ifndef HW_RVL
+static pthread_t persistThread;
+static pthread_mutex_t persistLock = PTHREAD_MUTEX_INITIALIZER;
+static int persistWriting = 0;
+static int persistWriteDone;
+static int persistWriteRc;
+#endif
+
+static const char* persistPath;
+
+
+/* Copies the completed staging DB into the file; returns an
+ * sqlite result code */
+static int
+lsddb_persistWriteStage ()
+{
+    sqlite3* file;
+    int rc = sqlite3_open (persistPath, &file);
+    if (rc == SQLITE_OK)
+    {
+        sqlite3_backup* writer = sqlite3_backup_init (file, "main",
+                                                      persistStage, "main");
+        if (writer)
+        {
+            rc = sqlite3_backup_step (writer, -1);
+            sqlite3_backup_finish (writer);
+        }
+        else
+            rc = sqlite3_errcode (file);
+    }
+    sqlite3_close (file);
+    return rc;
+}
+
+
+#ifndef HW_RVL
+static void*
+lsddb_persistWriter (void* unused)
+{
+    int rc = lsddb_persistWriteStage ();
+
+    pthread_mutex_lock (&persistLock);
+    persistWriteRc = rc;
+    persistWriteDone = 1;
+    pthread_mutex_unlock (&persistLock);
+
+    return NULL;
+}
+#endif
+
+
+/* Records the outcome of a finished file write */
+static int
+lsddb_persistWritten (int rc)
+{
+    if (rc != SQLITE_DONE)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to persist DB to %s (SQLite error %d)."),
+               persistPath, rc);
+        return -1;
+    }
+    persistedChanges = persistSnapChanges;
+    return 0;
+}
+
+
+int
+lsddb_persistStep (const char* path, int pages)
+{
+    int rc;
+
+    if (!path || !memdb)
+        return -1;
+
+    /* Nothing to copy when running on the file */
+    if (directDB)
+        return 0;
+
+#ifndef HW_RVL
+    /* Collect the write-behind thread once it has finished */
+    if (persistWriting)
+    {
+        pthread_mutex_lock (&persistLock);
+        int done = persistWriteDone;
+        rc = persistWriteRc;
+        pthread_mutex_unlock (&persistLock);
+
+        if (!done)
+            return 1;
+
+        pthread_join (persistThread, NULL);
+        persistWriting = 0;
+        return lsddb_persistWritten (rc);
+    }
+#endif
+
+    if (!persistBackup)
+    {
+        int changes = sqlite3_total_changes (memdb);
+        if (changes == persistedChanges)
+            return 0;
+
+        if (!persistStage && sqlite3_open (":memory:", &persistStage) != SQLITE_OK)
+        {
+            doLog (ERROR, LOG_COMP, _("Unable to open persistence staging DB."));
+            sqlite3_close (persistStage);
+            persistStage = NULL;
+            return -1;
+        }
+
+        persistBackup = sqlite3_backup_init (persistStage, "main", memdb, "main");
+        if (!persistBackup)
+        {
+            doLog (ERROR, LOG_COMP, _("Unable to begin DB snapshot: %s"),
+                   sqlite3_errmsg (persistStage));
+            return -1;
+        }
+        persistSnapChanges = changes;
+    }
+
+    rc = sqlite3_backup_step (persistBackup, pages);
+    if (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED)
+        return 1;
+
+    sqlite3_backup_finish (persistBackup);
+    persistBackup = NULL;
+
+    if (rc != SQLITE_DONE)
+    {
+        doLog (ERROR, LOG_COMP, _("Error while taking DB snapshot (SQLite error %d)."),
+               rc);
+        return -1;
+    }
+
+    /* Snapshot complete; hand it to the writer */
+    persistPath = path;
+#ifndef HW_RVL
+    persistWriteDone = 0;
+    if (pthread_create (&persistThread, NULL, lsddb_persistWriter, NULL) == 0)
+    {
+        persistWriting = 1;
+        return 1;
+    }
+    doLog (WARNING, LOG_COMP, _("Unable to start DB writer thread. Writing inline."));
+#endif
+    return lsddb_persistWritten (lsddb_persistWriteStage ());
+}
+
+
+void
+lsddb_persistFinish ()
+{
+#ifndef HW_RVL
+    if (persistWriting)
+    {
+        pthread_join (persistThread, NULL);
+        persistWriting = 0;
+        lsddb_persistWritten (persistWriteRc);
+    }
+#endif
+
+    if (persistBackup)
+    {
+        sqlite3_backup_finish (persistBackup);
+        persistBackup = NULL;
+    }
+
+    if (persistStage)
+    {
+        sqlite3_close (persistStage);
+        persistStage = NULL;
+    }
+}
+
+
 int
 lsddb_closeDB ()
 {
+    lsddb_dropSnapshot ();
     lsddb_finishStmts ();
     return sqlite3_close (memdb);
 }
 
 
+/* RPC transactions.
+ * Each RPC runs inside one savepoint so its statements commit
+ * together instead of one autocommit per statement. A failed RPC
+ * is rolled back; since the in-memory structures may already
+ * reflect part of it, the caller reloads them from the restored
+ * DB when anything was actually undone. */
+static int rpcChanges;
+
+int
+lsddb_beginRPC ()
+{
+    char* errMsg = NULL;
+    rpcChanges = sqlite3_total_changes (memdb);
+    sqlite3_exec (memdb, "SAVEPOINT lsdrpc", NULL, NULL, &errMsg);
+    if (errMsg)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to open RPC savepoint: %s"), errMsg);
+        sqlite3_free (errMsg);
+        return -1;
+    }
+    return 0;
+}
+
+
+int
+lsddb_endRPC (int failed)
+{
+    char* errMsg = NULL;
+    int undone = 0;
+
+    if (failed && sqlite3_total_changes (memdb) != rpcChanges)
+    {
+        sqlite3_exec (memdb, "ROLLBACK TO lsdrpc", NULL, NULL, &errMsg);
+        if (errMsg)
+        {
+            doLog (ERROR, LOG_COMP, _("Unable to roll back RPC: %s"), errMsg);
+            sqlite3_free (errMsg);
+            errMsg = NULL;
+        }
+        else
+            undone = 1;
+    }
+
+    sqlite3_exec (memdb, "RELEASE lsdrpc", NULL, NULL, &errMsg);
+    if (errMsg)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to release RPC savepoint: %s"), errMsg);
+        sqlite3_free (errMsg);
+        return -1;
+    }
+    return undone;
+}
+
+
+/* Rows changed in the DB since it was opened; any write moves
+ * it, so it versions everything derived from the DB */
+int
+lsddb_changeCount ()
+{
+    return sqlite3_total_changes (memdb);
+}
+
+
+/* A batch of RPCs nests each method's savepoint inside one
+ * outer savepoint, committing the whole batch at once */
+int
+lsddb_beginBatch ()
+{
+    char* errMsg = NULL;
+    sqlite3_exec (memdb, "SAVEPOINT lsdbatch", NULL, NULL, &errMsg);
+    if (errMsg)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to open batch savepoint: %s"), errMsg);
+        sqlite3_free (errMsg);
+        return -1;
+    }
+    return 0;
+}
+
+
+int
+lsddb_endBatch ()
+{
+    char* errMsg = NULL;
+    sqlite3_exec (memdb, "RELEASE lsdbatch", NULL, NULL, &errMsg);
+    if (errMsg)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to release batch savepoint: %s"), errMsg);
+        sqlite3_free (errMsg);
+        return -1;
+    }
+    return 0;
+}
+
+
+/* Trigger bumping SceneStructVersion after the given event */
+#define STRUCT_TRIGGER(name, event) \
+    "CREATE TRIGGER IF NOT EXISTS StructVer" name " AFTER " event \
+    " BEGIN UPDATE SceneStructVersion SET ver=ver+1; END;\n"
+
 static const char INIT_QUERIES[] =
 
 /* CREATE: ScenePlugin */
@@ -324,10 +735,7 @@ static const char INIT_QUERIES[] =
     "arrIdx INTEGER, classId INTEGER NOT NULL, "
     "patchSpaceId INTEGER NOT NULL,  name TEXT NULL,"
     "colourR REAL DEFAULT 1, colourG REAL DEFAULT 0, colourB REAL DEFAULT 0,"
-    "posX INTEGER DEFAULT 0, posY INTEGER DEFAULT 0);\n"
-
-/* reset data structure indicies */
-    "UPDATE SceneNodeInst SET arrIdx=-1;\n"
+    "posX INTEGER DEFAULT 0, posY INTEGER DEFAULT 0, arrGen INTEGER DEFAULT 0);\n"
 
 /* CREATE: ScenePluginTable */
     "CREATE TABLE IF NOT EXISTS ScenePluginTable (pluginId INTEGER NOT NULL, "
@@ -356,14 +764,11 @@ static const char INIT_QUERIES[] =
 /* typeId is set for facade plugs upon internal connection */
     "CREATE TABLE IF NOT EXISTS SceneNodeInstInput (id INTEGER PRIMARY KEY, instId INTEGER NOT NULL, "
     "instInputIdx INTEGER, typeId INTEGER NOT NULL, facadeBool INTEGER NOT NULL, aliasedIn INTEGER, "
-    "name TEXT NOT NULL, desc TEXT NULL, arrIdx INTEGER NULL "
-    ");\n"
+    "name TEXT NOT NULL, desc TEXT NULL, arrIdx INTEGER NULL, "
+    "arrGen INTEGER DEFAULT 0);\n"
 
     "CREATE INDEX IF NOT EXISTS iInIdx ON SceneNodeInstInput (instId, instInputIdx);\n"
 
-/* reset data structure indicies */
-    "UPDATE SceneNodeInstInput SET arrIdx=-1;\n"
-
 /* CREATE: SceneNodeInstOutput */
 /* instId references SceneNodeInst if facadeBool 0 */
 /* instId references associated ScenePatchSpace if
@@ -375,41 +780,137 @@ static const char INIT_QUERIES[] =
     "CREATE TABLE IF NOT EXISTS SceneNodeInstOutput (id INTEGER PRIMARY KEY, instId INTEGER NOT NULL, "
     "instOutputIdx INTEGER, typeId INTEGER NOT NULL, facadeBool INTEGER NOT NULL, aliasedOut INTEGER, "
     "name TEXT NOT NULL, desc TEXT NULL, arrIdx INTEGER NULL, "
-    "bfFuncIdx INTEGER NOT NULL, bpFuncIdx INTEGER NOT NULL);\n"
+    "bfFuncIdx INTEGER NOT NULL, bpFuncIdx INTEGER NOT NULL, "
+    "arrGen INTEGER DEFAULT 0);\n"
 
     "CREATE INDEX IF NOT EXISTS iOutIdx ON SceneNodeInstOutput (instId, instOutputIdx);\n"
 
-/* reset data structure indicies */
-    "UPDATE SceneNodeInstOutput SET arrIdx=-1;\n"
-
 /* CREATE: SystemPartition */
     "CREATE TABLE IF NOT EXISTS SystemPartition (id INTEGER PRIMARY KEY,"
     "name TEXT, arrayIdx INTEGER,"
-    "patchSpaceId INTEGER NOT NULL, imageUrl TEXT);\n"
-
-/* Reset data structure indicies */
-    "UPDATE SystemPartition SET arrayIdx=-1;\n"
+    "patchSpaceId INTEGER NOT NULL, imageUrl TEXT, arrGen INTEGER DEFAULT 0);\n"
 
 /* CREATE: SystemChannel */
     "CREATE TABLE IF NOT EXISTS SystemChannel (id INTEGER PRIMARY KEY, "
     "name TEXT NOT NULL, partitionId INTEGER NOT NULL, "
     "partitionElem INTEGER, single INTEGER NOT NULL, arrIdx INTEGER,"
     "rAddrId INTEGER NOT NULL, gAddrId INTEGER,"
-    "bAddrId INTEGER, facadeOutId INTEGER, FOREIGN KEY(partitionId) REFERENCES SystemPartition(id));\n"
-
-/* Reset Data structures */
-    "UPDATE SystemChannel SET arrIdx=-1;\n"
+    "bAddrId INTEGER, facadeOutId INTEGER, arrGen INTEGER DEFAULT 0, "
+    "FOREIGN KEY(partitionId) REFERENCES SystemPartition(id));\n"
 
 /* CREATE: OlaAddress */
     "CREATE TABLE IF NOT EXISTS OlaAddress (id INTEGER PRIMARY KEY,"
     "olaUnivId INTEGER NOT NULL, olaLightAddr INTEGER NOT NULL,"
-    "olaUnivArrIdx INTEGER, sixteenBit INTEGER NOT NULL);\n"
+    "olaUnivArrIdx INTEGER, sixteenBit INTEGER NOT NULL, "
+    "arrGen INTEGER DEFAULT 0);\n"
 
     "CREATE INDEX IF NOT EXISTS OlaAddrIdx ON OlaAddress"
     "(olaUnivId ASC);\n"
 
-/* Reset data structure indicies */
-    "UPDATE OlaAddress SET olaUnivArrIdx=-1;\n";
+/* CREATE: SceneGeneration */
+/* Single row counting reloads. Structure indicies (arrIdx and
+ * friends) in the node, partition, channel and address tables are
+ * only valid when the row's arrGen matches; this replaces a
+ * full-table reset of every index at each reload */
+    "CREATE TABLE IF NOT EXISTS SceneGeneration (gen INTEGER NOT NULL);\n"
+    "INSERT INTO SceneGeneration (gen) SELECT 0 WHERE NOT EXISTS "
+    "(SELECT 1 FROM SceneGeneration);\n"
+
+/* CREATE: SceneStructVersion */
+/* Single row bumped by the triggers below whenever anything the
+ * node arrays are built from changes. Keys the runtime snapshot */
+    "CREATE TABLE IF NOT EXISTS SceneStructVersion (ver INTEGER NOT NULL);\n"
+    "INSERT INTO SceneStructVersion (ver) SELECT 0 WHERE NOT EXISTS "
+    "(SELECT 1 FROM SceneStructVersion);\n"
+
+    STRUCT_TRIGGER ("InstIns", "INSERT ON SceneNodeInst")
+    STRUCT_TRIGGER ("InstDel", "DELETE ON SceneNodeInst")
+    STRUCT_TRIGGER ("InstUpd", "UPDATE OF classId,patchSpaceId ON SceneNodeInst")
+    STRUCT_TRIGGER ("InIns", "INSERT ON SceneNodeInstInput")
+    STRUCT_TRIGGER ("InDel", "DELETE ON SceneNodeInstInput")
+    STRUCT_TRIGGER ("InUpd", "UPDATE OF instId,typeId,facadeBool,aliasedIn ON SceneNodeInstInput")
+    STRUCT_TRIGGER ("OutIns", "INSERT ON SceneNodeInstOutput")
+    STRUCT_TRIGGER ("OutDel", "DELETE ON SceneNodeInstOutput")
+    STRUCT_TRIGGER ("OutUpd", "UPDATE OF instId,typeId,facadeBool,aliasedOut,"
+                    "bfFuncIdx,bpFuncIdx ON SceneNodeInstOutput")
+    STRUCT_TRIGGER ("EdgeIns", "INSERT ON SceneNodeEdge")
+    STRUCT_TRIGGER ("EdgeDel", "DELETE ON SceneNodeEdge")
+    STRUCT_TRIGGER ("EdgeUpd", "UPDATE ON SceneNodeEdge")
+    STRUCT_TRIGGER ("PsIns", "INSERT ON ScenePatchSpace")
+    STRUCT_TRIGGER ("PsDel", "DELETE ON ScenePatchSpace")
+    STRUCT_TRIGGER ("PsUpd", "UPDATE OF parentPatchSpace ON ScenePatchSpace")
+    STRUCT_TRIGGER ("PartIns", "INSERT ON SystemPartition")
+    STRUCT_TRIGGER ("PartDel", "DELETE ON SystemPartition")
+    STRUCT_TRIGGER ("PartUpd", "UPDATE OF patchSpaceId ON SystemPartition")
+    STRUCT_TRIGGER ("PlugIns", "INSERT ON ScenePlugin")
+    STRUCT_TRIGGER ("PlugDel", "DELETE ON ScenePlugin")
+    STRUCT_TRIGGER ("PlugUpd", "UPDATE OF enabled ON ScenePlugin");
+
+/* SQL function lsdgen(); returns the current reload generation */
+static void
+lsddb_sqlGen (sqlite3_context* ctx, int argc, sqlite3_value** argv)
+{
+    sqlite3_result_int (ctx, arrGen);
+}
+
+
+/* Tables whose structure indicies are generation tagged */
+static const char* const GEN_TABLES[] =
+{
+    "SceneNodeInst", "SceneNodeInstInput", "SceneNodeInstOutput",
+    "SystemPartition", "SystemChannel", "OlaAddress", NULL
+};
+
+/* Adds arrGen to tables created before it existed */
+static int
+lsddb_upgradeGenColumns ()
+{
+    int i;
+    for (i = 0; GEN_TABLES[i]; ++i)
+    {
+        char query[128];
+        sqlite3_stmt* info;
+        int found = 0;
+
+        snprintf (query, sizeof( query ), "PRAGMA table_info(%s)", GEN_TABLES[i]);
+        if (sqlite3_prepare_v2 (memdb, query, -1, &info, NULL) != SQLITE_OK)
+            return -1;
+        while (sqlite3_step (info) == SQLITE_ROW)
+            if (strcmp ((const char*)sqlite3_column_text (info, 1), "arrGen") == 0)
+                found = 1;
+        sqlite3_finalize (info);
+
+        if (found)
+            continue;
+
+        snprintf (query, sizeof( query ),
+                  "ALTER TABLE %s ADD COLUMN arrGen INTEGER DEFAULT 0",
+                  GEN_TABLES[i]);
+        if (sqlite3_exec (memdb, query, NULL, NULL, NULL) != SQLITE_OK)
+        {
+            doLog (ERROR, LOG_COMP, _("Unable to add arrGen to %s: %s"),
+                   GEN_TABLES[i], sqlite3_errmsg (memdb));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/* Reloads the cached generation from SceneGeneration */
+static int
+lsddb_readGen ()
+{
+    sqlite3_stmt* gen;
+    if (sqlite3_prepare_v2 (memdb, "SELECT gen FROM SceneGeneration LIMIT 1",
+                            -1, &gen, NULL) != SQLITE_OK)
+        return -1;
+    if (sqlite3_step (gen) == SQLITE_ROW)
+        arrGen = sqlite3_column_int (gen, 0);
+    sqlite3_finalize (gen);
+    return 0;
+}
+
 
 int
 lsddb_initDB ()
@@ -418,6 +919,14 @@ lsddb_initDB ()
 
     char* errMsg = NULL;
     int rc;
+
+    if (sqlite3_create_function (memdb, "lsdgen", 0, SQLITE_UTF8, NULL,
+                                 lsddb_sqlGen, NULL, NULL) != SQLITE_OK)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to register lsdgen()."));
+        return -1;
+    }
+
     rc = sqlite3_exec (memdb, INIT_QUERIES, NULL, NULL, &errMsg);
 
     if (errMsg)
@@ -425,6 +934,12 @@ lsddb_initDB ()
         doLog (ERROR, LOG_COMP, _("Error during DB init:\n%s"), errMsg);
         sqlite3_free (errMsg);
     }
+
+    if (lsddb_upgradeGenColumns () < 0 || lsddb_readGen () < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to establish reload generation."));
+        return -1;
+    }
     return rc;
 }
 
@@ -439,23 +954,8 @@ static const char RESET_DB[] =
 /* reset data structure array indicies */
     "UPDATE SceneNodeClass SET arrayIdx=-1;\n"
 
-/* reset data structure indicies */
-    "UPDATE SceneNodeInst SET arrIdx=-1;\n"
-
-/* reset data structure indicies */
-    "UPDATE SceneNodeInstInput SET arrIdx=-1;\n"
-
-/* reset data structure indicies */
-    "UPDATE SceneNodeInstOutput SET arrIdx=-1;\n"
-
-/* Reset data structure indicies */
-    "UPDATE SystemPartition SET arrayIdx=-1;\n"
-
-/* Reset Data structures */
-    "UPDATE SystemChannel SET arrIdx=-1;\n"
-
-/* Reset data structure indicies */
-    "UPDATE OlaAddress SET olaUnivArrIdx=-1;\n";
+/* Advance the generation; every arrGen-tagged index is now stale */
+    "UPDATE SceneGeneration SET gen=gen+1;\n";
 
 int
 lsddb_resetDB ()
@@ -471,6 +971,8 @@ lsddb_resetDB ()
         doLog (ERROR, LOG_COMP, _("Error during DB reset:\n%s"), errMsg);
         sqlite3_free (errMsg);
     }
+    if (rc == SQLITE_OK)
+        lsddb_readGen ();
     return rc;
 
 }
@@ -693,6 +1195,8 @@ static sqlite3_stmt* REMOVE_PATCH_SPACE_IN_S;
 int
 lsddb_removePatchSpaceOut (int outId)
 {
+    lsddb_forgetOutputAlias (outId);
+
     sqlite3_reset (REMOVE_PATCH_SPACE_OUT_S);
     sqlite3_bind_int (REMOVE_PATCH_SPACE_OUT_S, 1, outId);
     if (sqlite3_step (REMOVE_PATCH_SPACE_OUT_S) != SQLITE_DONE)
@@ -707,6 +1211,8 @@ lsddb_removePatchSpaceOut (int outId)
 int
 lsddb_removePatchSpaceIn (int inId)
 {
+    lsddb_forgetInputAlias (inId);
+
     sqlite3_reset (REMOVE_PATCH_SPACE_IN_S);
     sqlite3_bind_int (REMOVE_PATCH_SPACE_IN_S, 1, inId);
     if (sqlite3_step (REMOVE_PATCH_SPACE_IN_S) != SQLITE_DONE)
@@ -786,19 +1292,6 @@ lsddb_createPartition (const char* name, int* idBinding)
     }
 
 
-    /* This no longer happens because the partition state is
-     * only constructed once at startup. It's left here as
-     * reference of what will happen iteratively once for
-     * every partition present in the database at start time
-      *
-      * size_t partArrIdx;
-      * struct LSD_Partition* partArrPtr;
-      * if(insertElem(getArr_lsdPartitionArr(),&partArrIdx,(void**)&partArrPtr)<0){
-      *  fprintf(stderr,"Unable to insert Partition into
-      * array in createPartition()\n");
-      *  return -1;
-      * }*/
-
     /* Create Partition's PatchSpace */
     /* char psName[256]; */
     /* memset(psName,0,256); */
@@ -825,6 +1318,11 @@ lsddb_createPartition (const char* name, int* idBinding)
     int partId;
     partId = sqlite3_last_insert_rowid (memdb);
 
+    /* The new patch space is empty, so the partition goes
+     * live without a reload */
+    if (lsddb_structPartition (partId) < 0)
+        return -1;
+
     if (idBinding)
         *idBinding = partId;
 
@@ -897,6 +1395,9 @@ lsddb_removePartition (int partId)
         lsddb_deletePatchChannel (chanId);
     }
 
+    if (lsddb_unstructPartition (partId) < 0)
+        return -1;
+
     /* remove partition record */
     sqlite3_reset (REMOVE_PARTITON_S);
     sqlite3_bind_int (REMOVE_PARTITON_S, 1, partId);
@@ -912,6 +1413,27 @@ lsddb_removePartition (int partId)
 }
 
 
+int
+lsddb_getPartitionPatchSpace (int partId, int* psIdBind)
+{
+    if (!psIdBind)
+        return -1;
+
+    sqlite3_reset (GET_PARTITON_PATCHSPACE_S);
+    sqlite3_bind_int (GET_PARTITON_PATCHSPACE_S, 1, partId);
+    if (sqlite3_step (GET_PARTITON_PATCHSPACE_S) != SQLITE_ROW)
+    {
+        doLog (ERROR, LOG_COMP, _("Partition %d does not exist in getPartitionPatchSpace()."),
+               partId);
+        return -1;
+    }
+
+    *psIdBind = sqlite3_column_int (GET_PARTITON_PATCHSPACE_S, 0);
+
+    return 0;
+}
+
+
 static const char UPDATE_PARTITON_NAME[] =
     "UPDATE SystemPartition SET name=?2 WHERE id=?1";
 static sqlite3_stmt* UPDATE_PARTITON_NAME_S;
@@ -1145,7 +1667,7 @@ static const char STRUCT_NODE_INST_OUTPUT_ARR[] =
 static sqlite3_stmt* STRUCT_NODE_INST_OUTPUT_ARR_S;
 
 static const char STRUCT_NODE_INST_OUTPUT_ARR_UPDIDX[] =
-    "UPDATE SceneNodeInstOutput SET arrIdx=?1 WHERE id=?2";
+    "UPDATE SceneNodeInstOutput SET arrIdx=?1,arrGen=lsdgen() WHERE id=?2";
 static sqlite3_stmt* STRUCT_NODE_INST_OUTPUT_ARR_UPDIDX_S;
 
 int
@@ -1182,6 +1704,12 @@ lsddb_structNodeInstOutputArr (struct LSD_SceneNodeInst* nodeInst)
         nodeOut->typeId = typeId;
         nodeOut->parentNode = nodeInst;
 
+        if (lsdmap_put (getMap_lsdNodeOutputMap (), outId, nodeOut) < 0)
+        {
+            doLog (ERROR, LOG_COMP, _("Unable to map inst output in structNodeInstOutputArr()."));
+            return -1;
+        }
+
         /* Ensure function pointers are back in place */
         nodeOut->bufferFunc = nodeInst->nodeClass->bfFuncTbl[bfFuncIdx];
         nodeOut->bufferPtr = nodeInst->nodeClass->bpFuncTbl[bpFuncIdx];
@@ -1217,7 +1745,7 @@ static const char STRUCT_NODE_INST_INPUT_ARR[] =
 static sqlite3_stmt* STRUCT_NODE_INST_INPUT_ARR_S;
 
 static const char STRUCT_NODE_INST_INPUT_ARR_UPDIDX[] =
-    "UPDATE SceneNodeInstInput SET arrIdx=?1 WHERE id=?2";
+    "UPDATE SceneNodeInstInput SET arrIdx=?1,arrGen=lsdgen() WHERE id=?2";
 static sqlite3_stmt* STRUCT_NODE_INST_INPUT_ARR_UPDIDX_S;
 
 int
@@ -1252,6 +1780,12 @@ lsddb_structNodeInstInputArr (struct LSD_SceneNodeInst* nodeInst)
         nodeIn->typeId = typeId;
         nodeIn->parentNode = nodeInst;
 
+        if (lsdmap_put (getMap_lsdNodeInputMap (), inId, nodeIn) < 0)
+        {
+            doLog (ERROR, LOG_COMP, _("Unable to map inst input in structNodeInstInputArr()."));
+            return -1;
+        }
+
         /* update Input arrIdx */
         sqlite3_reset (STRUCT_NODE_INST_INPUT_ARR_UPDIDX_S);
         sqlite3_bind_int (STRUCT_NODE_INST_INPUT_ARR_UPDIDX_S, 1, inArrIdx);
@@ -1350,10 +1884,97 @@ lsddb_getOutputClassId (int outId)
 static const char STRUCT_NODE_INST_ARR[] =
     "SELECT id,classId FROM SceneNodeInst WHERE patchSpaceId=?1";
 static const char STRUCT_NODE_INST_ARR_UPDIDX[] =
-    "UPDATE SceneNodeInst SET arrIdx=?1 WHERE id=?2";
+    "UPDATE SceneNodeInst SET arrIdx=?1,arrGen=lsdgen() WHERE id=?2";
 static sqlite3_stmt* STRUCT_NODE_INST_ARR_S;
 static sqlite3_stmt* STRUCT_NODE_INST_ARR_UPDIDX_S;
 
+/* Runs a node's restore func, charging its time to the
+ * node's class in the reload statistics */
+static void
+lsddb_restoreNodeInst (struct LSD_SceneNodeInst* inst)
+{
+    if (!inst->nodeClass->nodeRestoreFunc)
+        return;
+
+    struct timeval start;
+    gettimeofday (&start, NULL);
+    inst->nodeClass->nodeRestoreFunc (inst, inst->data);
+    lsdstats_restore (inst->nodeClass->dbId, lsdstats_since (&start));
+}
+
+
+/* Constructs one node instance along with its inputs and
+ * outputs, then runs its restore func. Wiring is left to the
+ * caller. */
+static int
+lsddb_structNodeInst (int instId, int classId)
+{
+    size_t targetIdx;
+    struct LSD_SceneNodeInst* nodeInst;
+    if (insertElem (getArr_lsdNodeInstArr (), &targetIdx,
+                    (void**)&nodeInst) < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to insert array element in structNodeInstArr()."));
+        return -1;
+    }
+    /* printf("Structed Node Inst from patchSpace
+     * %d\n",patchSpaceId); */
+
+    nodeInst->dbId = instId;
+
+    if (lsdmap_put (getMap_lsdNodeInstMap (), instId, nodeInst) < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to map node inst in structNodeInstArr()."));
+        return -1;
+    }
+
+    /* Reconnect node's class */
+    if (lsddb_resolveClassFromId (&( nodeInst->nodeClass ),
+                                  classId) < 0)
+        doLog (ERROR, LOG_COMP, _("Unable to resolve node's class while restructing."));
+
+
+    sqlite3_reset (STRUCT_NODE_INST_ARR_UPDIDX_S);
+    sqlite3_bind_int (STRUCT_NODE_INST_ARR_UPDIDX_S, 1, targetIdx);
+    sqlite3_bind_int (STRUCT_NODE_INST_ARR_UPDIDX_S, 2, instId);
+
+    if (sqlite3_step (STRUCT_NODE_INST_ARR_UPDIDX_S) != SQLITE_DONE)
+    {
+        doLog (ERROR, LOG_COMP, _("Error while updating node inst arr idx in structNodeInstArr()."));
+        return -1;
+    }
+
+    /* Struct this instance's inputs and outputs */
+    if (lsddb_structNodeInstInputArr (nodeInst) < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to struct node's inputs in structNodeInstArr()."));
+        return -1;
+    }
+    if (lsddb_structNodeInstOutputArr (nodeInst) < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to struct node's outputs in structNodeInstArr()."));
+        return -1;
+    }
+
+    /* Allocate inst's memory */
+    if (nodeInst->nodeClass->instDataSize > 0)
+    {
+        nodeInst->data = malloc (nodeInst->nodeClass->instDataSize);
+
+        if (!nodeInst->data)
+        {
+            doLog (ERROR, LOG_COMP, _("Unable to allocate memory for node inst data in structNodeInstArr()."));
+            return -1;
+        }
+    }
+
+    /* Run restore func */
+    lsddb_restoreNodeInst (nodeInst);
+
+    return 0;
+}
+
+
 int
 lsddb_structNodeInstArr (int patchSpaceId)
 {
@@ -1369,64 +1990,8 @@ lsddb_structNodeInstArr (int patchSpaceId)
         int nodeEnabled = lsddb_checkClassEnabled (classId);
 
         if (instId != 0 && nodeEnabled)
-        {
-            size_t targetIdx;
-            struct LSD_SceneNodeInst* nodeInst;
-            if (insertElem (getArr_lsdNodeInstArr (), &targetIdx,
-                            (void**)&nodeInst) < 0)
-            {
-                doLog (ERROR, LOG_COMP, _("Unable to insert array element in structNodeInstArr()."));
-                return -1;
-            }
-            /* printf("Structed Node Inst from patchSpace
-             * %d\n",patchSpaceId); */
-
-            nodeInst->dbId = instId;
-
-            /* Reconnect node's class */
-            if (lsddb_resolveClassFromId (&( nodeInst->nodeClass ),
-                                          classId) < 0)
-                doLog (ERROR, LOG_COMP, _("Unable to resolve node's class while restructing."));
-
-
-            sqlite3_reset (STRUCT_NODE_INST_ARR_UPDIDX_S);
-            sqlite3_bind_int (STRUCT_NODE_INST_ARR_UPDIDX_S, 1, targetIdx);
-            sqlite3_bind_int (STRUCT_NODE_INST_ARR_UPDIDX_S, 2, instId);
-
-            if (sqlite3_step (STRUCT_NODE_INST_ARR_UPDIDX_S) != SQLITE_DONE)
-            {
-                doLog (ERROR, LOG_COMP, _("Error while updating node inst arr idx in structNodeInstArr()."));
+            if (lsddb_structNodeInst (instId, classId) < 0)
                 return -1;
-            }
-
-            /* Struct this instance's inputs and outputs */
-            if (lsddb_structNodeInstInputArr (nodeInst) < 0)
-            {
-                doLog (ERROR, LOG_COMP, _("Unable to struct node's inputs in structNodeInstArr()."));
-                return -1;
-            }
-            if (lsddb_structNodeInstOutputArr (nodeInst) < 0)
-            {
-                doLog (ERROR, LOG_COMP, _("Unable to struct node's outputs in structNodeInstArr()."));
-                return -1;
-            }
-
-            /* Allocate inst's memory */
-            if (nodeInst->nodeClass->instDataSize > 0)
-            {
-                nodeInst->data = malloc (nodeInst->nodeClass->instDataSize);
-
-                if (!nodeInst->data)
-                {
-                    doLog (ERROR, LOG_COMP, _("Unable to allocate memory for node inst data in structNodeInstArr()."));
-                    return -1;
-                }
-            }
-
-            /* Run restore func */
-            if (nodeInst->nodeClass->nodeRestoreFunc)
-                nodeInst->nodeClass->nodeRestoreFunc (nodeInst, nodeInst->data);
-        }
     }
     if (errcode != SQLITE_DONE)
     {
@@ -1444,7 +2009,7 @@ static const char STRUCT_UNIV_ARR[] =
 static sqlite3_stmt* STRUCT_UNIV_ARR_S;
 
 static const char STRUCT_UNIV_ARR_UPDIDX[] =
-    "UPDATE OlaAddress SET olaUnivArrIdx=?1 WHERE olaUnivId=?2";
+    "UPDATE OlaAddress SET olaUnivArrIdx=?1,arrGen=lsdgen() WHERE olaUnivId=?2";
 static sqlite3_stmt* STRUCT_UNIV_ARR_UPDIDX_S;
 
 static const char STRUCT_UNIV_ARR_MAXIDX[] =
@@ -1516,7 +2081,7 @@ lsddb_structUnivArr ()
 /* Private function for constructing address on behalf of
  * channels constructor */
 static const char STRUCT_CHANNEL_ARR_ADDR[] =
-    "SELECT id,olaUnivArrIdx,olaLightAddr,sixteenBit FROM OlaAddress WHERE id=?1";
+    "SELECT id," CUR_IDX("olaUnivArrIdx") ",olaLightAddr,sixteenBit FROM OlaAddress WHERE id=?1";
 static sqlite3_stmt* STRUCT_CHANNEL_ARR_ADDR_S;
 
 int
@@ -1563,16 +2128,89 @@ lsddb_structChannelArrAddr (struct LSD_Addr* addr, int addrId)
 }
 
 
+/* Private function for constructing one channel (and its
+ * addresses) on behalf of the channel constructors */
+static const char STRUCT_CHANNEL_ARR_UPDIDX[] =
+    "UPDATE SystemChannel SET arrIdx=?2,arrGen=lsdgen() WHERE id=?1";
+static sqlite3_stmt* STRUCT_CHANNEL_ARR_UPDIDX_S;
+
+static int
+lsddb_structChannel (int chanId, int chanSingle, int chanRa, int chanGa,
+                     int chanBa, int facadeOutId)
+{
+    /* Built aside, so frames never see a partial channel */
+    struct LSD_Channel chan;
+    memset (&chan, 0, sizeof( struct LSD_Channel ));
+    chan.dbId = chanId;
+
+    if (chanSingle)
+    {
+        chan.single = 1;
+        if (lsddb_structChannelArrAddr (&( chan.rAddr ), chanRa) < 0)
+        {
+            doLog (ERROR, LOG_COMP, _("Unable to struct single addr in structChannelArr()."));
+            return -1;
+        }
+    }
+    else
+    {
+        chan.single = 0;
+        if (lsddb_structChannelArrAddr (&( chan.rAddr ), chanRa) < 0)
+        {
+            doLog (ERROR, LOG_COMP, _("Unable to struct red addr in structChannelArr()."));
+            return -1;
+        }
+        if (lsddb_structChannelArrAddr (&( chan.gAddr ), chanGa) < 0)
+        {
+            doLog (ERROR, LOG_COMP, _("Unable to struct green addr in structChannelArr()."));
+            return -1;
+        }
+        if (lsddb_structChannelArrAddr (&( chan.bAddr ), chanBa) < 0)
+        {
+            doLog (ERROR, LOG_COMP, _("Unable to struct blue addr in structChannelArr()."));
+            return -1;
+        }
+    }
+
+    /* Resolve and set channel object's aliased output
+     * (if exists) */
+    lsddb_traceOutput (&( chan.output ), facadeOutId, NULL, NULL);
+    if (chan.output)
+        doLog (NOTICE, LOG_COMP, _("structChannelArr() output id %d."), chan.output->dbId);
+
+    size_t channelIdx;
+    struct LSD_Channel* chanBind;
+    lockScene ();
+    if (insertElem (getArr_lsdChannelArr (), &channelIdx,
+                    (void**)&chanBind) < 0)
+    {
+        unlockScene ();
+        doLog (ERROR, LOG_COMP, _("Unable to insert channel into array in structChannelArr()."));
+        return -1;
+    }
+    *chanBind = chan;
+    unlockScene ();
+
+    /* Update Channel's ArrIdx */
+    sqlite3_reset (STRUCT_CHANNEL_ARR_UPDIDX_S);
+    sqlite3_bind_int (STRUCT_CHANNEL_ARR_UPDIDX_S, 1, chanId);
+    sqlite3_bind_int (STRUCT_CHANNEL_ARR_UPDIDX_S, 2, channelIdx);
+    if (sqlite3_step (STRUCT_CHANNEL_ARR_UPDIDX_S) != SQLITE_DONE)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to update channel's arrIdx in structChannelArr()."));
+        return -1;
+    }
+
+    return 0;
+}
+
+
 /* Private function for constructing channels on bahalf of
  * partitions constructor */
 static const char STRUCT_CHANNEL_ARR[] =
     "SELECT id,single,rAddrId,gAddrId,bAddrId,facadeOutId FROM SystemChannel";
 static sqlite3_stmt* STRUCT_CHANNEL_ARR_S;
 
-static const char STRUCT_CHANNEL_ARR_UPDIDX[] =
-    "UPDATE SystemChannel SET arrIdx=?2 WHERE id=?1";
-static sqlite3_stmt* STRUCT_CHANNEL_ARR_UPDIDX_S;
-
 int
 lsddb_structChannelArr ()
 {
@@ -1580,76 +2218,245 @@ lsddb_structChannelArr ()
     int errcode;
     while (( errcode = sqlite3_step (STRUCT_CHANNEL_ARR_S)) == SQLITE_ROW)
     {
-        int chanId = sqlite3_column_int (STRUCT_CHANNEL_ARR_S, 0);
-        int chanSingle = sqlite3_column_int (STRUCT_CHANNEL_ARR_S, 1);
-        int chanRa = sqlite3_column_int (STRUCT_CHANNEL_ARR_S, 2);
-        int chanGa = sqlite3_column_int (STRUCT_CHANNEL_ARR_S, 3);
-        int chanBa = sqlite3_column_int (STRUCT_CHANNEL_ARR_S, 4);
-        int facadeOutId = sqlite3_column_int (STRUCT_CHANNEL_ARR_S, 5);
-
-        size_t channelIdx;
-        struct LSD_Channel* chanBind;
-        if (insertElem (getArr_lsdChannelArr (), &channelIdx,
-                        (void**)&chanBind) < 0)
-        {
-            doLog (ERROR, LOG_COMP, _("Unable to insert channel into array in structChannelArr()."));
+        if (lsddb_structChannel (sqlite3_column_int (STRUCT_CHANNEL_ARR_S, 0),
+                                 sqlite3_column_int (STRUCT_CHANNEL_ARR_S, 1),
+                                 sqlite3_column_int (STRUCT_CHANNEL_ARR_S, 2),
+                                 sqlite3_column_int (STRUCT_CHANNEL_ARR_S, 3),
+                                 sqlite3_column_int (STRUCT_CHANNEL_ARR_S, 4),
+                                 sqlite3_column_int (STRUCT_CHANNEL_ARR_S, 5)) < 0)
             return -1;
-        }
+    }
+    if (errcode != SQLITE_DONE)
+    {
+        doLog (ERROR, LOG_COMP, _("structChannelArr() did not loop cleanly."));
+        return -1;
+    }
+    return 0;
+}
+
+
+/* Places an address added while running into its universe
+ * structure, adding the universe or growing its buffer when
+ * the address lies outside of it */
+static const char PLACE_CHANNEL_ADDR[] =
+    "SELECT olaUnivId,olaLightAddr FROM OlaAddress WHERE id=?1";
+static sqlite3_stmt* PLACE_CHANNEL_ADDR_S;
 
-        chanBind->dbId = chanId;
+static int
+lsddb_placeChannelAddr (int addrId)
+{
+    sqlite3_reset (PLACE_CHANNEL_ADDR_S);
+    sqlite3_bind_int (PLACE_CHANNEL_ADDR_S, 1, addrId);
+    if (sqlite3_step (PLACE_CHANNEL_ADDR_S) != SQLITE_ROW)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to find address %d in placeChannelAddr()."), addrId);
+        return -1;
+    }
+    int univId = sqlite3_column_int (PLACE_CHANNEL_ADDR_S, 0);
+    int lightAddr = sqlite3_column_int (PLACE_CHANNEL_ADDR_S, 1);
+
+    if (lightAddr < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Light address may not be negative."));
+        return -1;
+    }
 
-        if (chanSingle)
+    /* Universes are few; a scan finds the one in question */
+    struct LSD_ArrayHead* univArr = getArr_lsdUnivArr ();
+    struct LSD_Univ* univPtr = NULL;
+    size_t univArrIdx;
+    size_t i;
+    if (univArr->maxIdx != (size_t)-1)
+        for (i = 0; i <= univArr->maxIdx; ++i)
         {
-            chanBind->single = 1;
-            if (lsddb_structChannelArrAddr (&( chanBind->rAddr ), chanRa) < 0)
-            {
-                doLog (ERROR, LOG_COMP, _("Unable to struct single addr in structChannelArr()."));
+            struct LSD_Univ* cand;
+            if (pickIdx (univArr, (void**)&cand, i) < 0)
                 return -1;
+            if (cand->buffer && cand->olaUnivId == univId)
+            {
+                univPtr = cand;
+                univArrIdx = i;
+                break;
             }
         }
-        else
+
+    /* Frames write into these buffers */
+    lockScene ();
+    if (!univPtr)
+    {
+        if (insertElem (univArr, &univArrIdx, (void**)&univPtr) < 0)
         {
-            chanBind->single = 0;
-            if (lsddb_structChannelArrAddr (&( chanBind->rAddr ), chanRa) < 0)
-            {
-                doLog (ERROR, LOG_COMP, _("Unable to struct red addr in structChannelArr()."));
-                return -1;
-            }
-            if (lsddb_structChannelArrAddr (&( chanBind->gAddr ), chanGa) < 0)
-            {
-                doLog (ERROR, LOG_COMP, _("Unable to struct green addr in structChannelArr()."));
-                return -1;
-            }
-            if (lsddb_structChannelArrAddr (&( chanBind->bAddr ), chanBa) < 0)
-            {
-                doLog (ERROR, LOG_COMP, _("Unable to struct blue addr in structChannelArr()."));
-                return -1;
-            }
+            unlockScene ();
+            doLog (ERROR, LOG_COMP, _("Unable to allocate array space in placeChannelAddr()."));
+            return -1;
+        }
+        univPtr->olaUnivId = univId;
+        univPtr->maxIdx = -1;
+        univPtr->buffer = NULL;
+    }
+
+    /* Grow (zero-filled) with room for a sixteen bit low byte */
+    if (lightAddr > univPtr->maxIdx)
+    {
+        size_t oldSize = ( univPtr->buffer ) ? univPtr->maxIdx + 2 : 0;
+        size_t newSize = lightAddr + 2;
+        uint8_t* univBuf = realloc (univPtr->buffer, sizeof( uint8_t ) * newSize);
+        if (!univBuf)
+        {
+            unlockScene ();
+            doLog (ERROR, LOG_COMP, _("Unable to allocate memory for DMX buffer."));
+            return -1;
         }
+        memset (univBuf + oldSize, 0, newSize - oldSize);
+        univPtr->buffer = univBuf;
+        univPtr->maxIdx = lightAddr;
+    }
+    unlockScene ();
+
+    sqlite3_reset (STRUCT_UNIV_ARR_UPDIDX_S);
+    sqlite3_bind_int (STRUCT_UNIV_ARR_UPDIDX_S, 1, univArrIdx);
+    sqlite3_bind_int (STRUCT_UNIV_ARR_UPDIDX_S, 2, univId);
+    if (sqlite3_step (STRUCT_UNIV_ARR_UPDIDX_S) != SQLITE_DONE)
+    {
+        doLog (ERROR, LOG_COMP, _("placeChannelAddr() was unable to update the universe arrayIdx."));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/* Constructs a channel added or changed while running */
+static const char STRUCT_CHANNEL_ID[] =
+    "SELECT single,rAddrId,gAddrId,bAddrId,facadeOutId FROM SystemChannel WHERE id=?1";
+static sqlite3_stmt* STRUCT_CHANNEL_ID_S;
+
+static int
+lsddb_structChannelId (int chanId)
+{
+    sqlite3_reset (STRUCT_CHANNEL_ID_S);
+    sqlite3_bind_int (STRUCT_CHANNEL_ID_S, 1, chanId);
+    if (sqlite3_step (STRUCT_CHANNEL_ID_S) != SQLITE_ROW)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to find channel %d in structChannelId()."), chanId);
+        return -1;
+    }
+
+    int single = sqlite3_column_int (STRUCT_CHANNEL_ID_S, 0);
+    int rAddrId = sqlite3_column_int (STRUCT_CHANNEL_ID_S, 1);
+    int gAddrId = sqlite3_column_int (STRUCT_CHANNEL_ID_S, 2);
+    int bAddrId = sqlite3_column_int (STRUCT_CHANNEL_ID_S, 3);
+    int facadeOutId = sqlite3_column_int (STRUCT_CHANNEL_ID_S, 4);
+
+    if (lsddb_placeChannelAddr (rAddrId) < 0)
+        return -1;
+    if (!single)
+    {
+        if (lsddb_placeChannelAddr (gAddrId) < 0)
+            return -1;
+        if (lsddb_placeChannelAddr (bAddrId) < 0)
+            return -1;
+    }
+
+    return lsddb_structChannel (chanId, single, rAddrId, gAddrId, bAddrId,
+                                facadeOutId);
+}
+
+
+/* Silences a channel's addresses before it is removed */
+static void
+lsddb_zeroChannelAddr (struct LSD_Addr const* addr)
+{
+    if (!addr->univ || !addr->univ->buffer || addr->addr > addr->univ->maxIdx)
+        return;
+    addr->univ->buffer[addr->addr] = 0;
+    if (addr->b16)
+        addr->univ->buffer[addr->addr + 1] = 0;
+}
+
+
+/* Removes a channel's structure while running; its universe
+ * stays until the next reload */
+static const char UNSTRUCT_CHANNEL[] =
+    "SELECT " CUR_IDX("arrIdx") " FROM SystemChannel WHERE id=?1";
+static sqlite3_stmt* UNSTRUCT_CHANNEL_S;
+
+static int
+lsddb_unstructChannel (int chanId)
+{
+    sqlite3_reset (UNSTRUCT_CHANNEL_S);
+    sqlite3_bind_int (UNSTRUCT_CHANNEL_S, 1, chanId);
+    if (sqlite3_step (UNSTRUCT_CHANNEL_S) != SQLITE_ROW)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to find channel %d in unstructChannel()."), chanId);
+        return -1;
+    }
+
+    int arrIdx = sqlite3_column_int (UNSTRUCT_CHANNEL_S, 0);
+    if (arrIdx < 0)
+        return 0;
+
+    struct LSD_Channel* chan;
+    if (pickIdx (getArr_lsdChannelArr (), (void**)&chan, arrIdx) < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to pick channel in unstructChannel()."));
+        return -1;
+    }
+
+    lockScene ();
+    lsddb_zeroChannelAddr (&( chan->rAddr ));
+    if (!chan->single)
+    {
+        lsddb_zeroChannelAddr (&( chan->gAddr ));
+        lsddb_zeroChannelAddr (&( chan->bAddr ));
+    }
+
+    int rc = delIdx (getArr_lsdChannelArr (), arrIdx);
+    unlockScene ();
+    if (rc < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to remove channel from array in unstructChannel()."));
+        return -1;
+    }
+
+    return 0;
+}
+
 
-        /* Resolve and set channel object's aliased output
-         * (if exists) */
-        chanBind->output = NULL;
-        lsddb_traceOutput (&( chanBind->output ), facadeOutId, NULL, NULL);
-        if (chanBind->output)
-            doLog (NOTICE, LOG_COMP, _("structChannelArr() output id %d."), chanBind->output->dbId);
-
-        /* Update Channel's ArrIdx */
-        sqlite3_reset (STRUCT_CHANNEL_ARR_UPDIDX_S);
-        sqlite3_bind_int (STRUCT_CHANNEL_ARR_UPDIDX_S, 1, chanId);
-        sqlite3_bind_int (STRUCT_CHANNEL_ARR_UPDIDX_S, 2, channelIdx);
-        if (sqlite3_step (STRUCT_CHANNEL_ARR_UPDIDX_S) != SQLITE_DONE)
+/* Traces every channel left without an output, e.g. after
+ * the plugin feeding it was structed while running */
+static const char RETRACE_CHANNELS[] =
+    "SELECT " CUR_IDX("arrIdx") ",facadeOutId FROM SystemChannel";
+static sqlite3_stmt* RETRACE_CHANNELS_S;
+
+static int
+lsddb_retraceChannels ()
+{
+    sqlite3_reset (RETRACE_CHANNELS_S);
+    while (sqlite3_step (RETRACE_CHANNELS_S) == SQLITE_ROW)
+    {
+        int arrIdx = sqlite3_column_int (RETRACE_CHANNELS_S, 0);
+        int facadeOutId = sqlite3_column_int (RETRACE_CHANNELS_S, 1);
+        if (arrIdx < 0)
+            continue;
+
+        struct LSD_Channel* chan;
+        if (pickIdx (getArr_lsdChannelArr (), (void**)&chan, arrIdx) < 0)
         {
-            doLog (ERROR, LOG_COMP, _("Unable to update channel's arrIdx in structChannelArr()."));
+            doLog (ERROR, LOG_COMP, _("Unable to pick channel in retraceChannels()."));
             return -1;
         }
 
+        struct LSD_SceneNodeOutput* output = NULL;
+        if (!chan->output &&
+            lsddb_traceOutput (&output, facadeOutId, NULL, NULL) == 0)
+        {
+            lockScene ();
+            chan->output = output;
+            unlockScene ();
+        }
     }
-    if (errcode != SQLITE_DONE)
-    {
-        doLog (ERROR, LOG_COMP, _("structChannelArr() did not loop cleanly."));
-        return -1;
-    }
+
     return 0;
 }
 
@@ -1677,6 +2484,51 @@ lsddb_structChannelArr ()
  * SceneNodeInput of type RGB[Array] (also picked for
  * operation) */
 
+/* Structs the nodes of a patch space, then recurses into
+ * each facade (child patch space) it contains */
+static int
+lsddb_structPatchSpaceTree (int patchSpaceId)
+{
+    if (lsddb_structNodeInstArr (patchSpaceId) < 0)
+        return -1;
+
+    /* Children are collected first; the statement is reused
+     * by the recursion */
+    int* children = NULL;
+    size_t childCount = 0;
+    size_t childCap = 0;
+
+    sqlite3_reset (REMOVE_PATCH_SPACE_FACADES_S);
+    sqlite3_bind_int (REMOVE_PATCH_SPACE_FACADES_S, 1, patchSpaceId);
+    while (sqlite3_step (REMOVE_PATCH_SPACE_FACADES_S) == SQLITE_ROW)
+    {
+        if (childCount == childCap)
+        {
+            childCap = childCap ? childCap * 2 : 8;
+            int* grown = realloc (children, sizeof( int ) * childCap);
+            if (!grown)
+            {
+                doLog (ERROR, LOG_COMP, _("Unable to allocate child list in structPatchSpaceTree()."));
+                free (children);
+                return -1;
+            }
+            children = grown;
+        }
+        children[childCount++] = sqlite3_column_int (
+            REMOVE_PATCH_SPACE_FACADES_S, 0);
+    }
+
+    size_t i;
+    for (i = 0; i < childCount; ++i)
+        if (lsddb_structPatchSpaceTree (children[i]) < 0)
+            doLog (ERROR, LOG_COMP, _("Unable to struct nodes within facade %d."),
+                   children[i]);
+
+    free (children);
+    return 0;
+}
+
+
 /* Should be ran during init after [plugins (nodeClasses and
  * types in turn), universes, and channels] have been
  * structed (in that order) */
@@ -1685,15 +2537,81 @@ static const char STRUCT_PARTITION_ARR[] =
 static sqlite3_stmt* STRUCT_PARTITION_ARR_S;
 
 static const char STRUCT_PARTITION_ARR_UPDIDX[] =
-    "UPDATE SystemPartition SET arrayIdx=?1 WHERE id=?2";
+    "UPDATE SystemPartition SET arrayIdx=?1,arrGen=lsdgen() WHERE id=?2";
 static sqlite3_stmt* STRUCT_PARTITION_ARR_UPDIDX_S;
 
+/* Inserts one partition's structure; also used directly when
+ * a partition is created while running */
+static int
+lsddb_structPartition (int partId)
+{
+    size_t partArrIdx;
+    struct LSD_Partition* partArrPtr;
+    if (insertElem (getArr_lsdPartitionArr (), &partArrIdx,
+                    (void**)&partArrPtr) < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to insert Partition into array in createPartition()."));
+        return -1;
+    }
+
+    /* Update arr idx */
+    sqlite3_reset (STRUCT_PARTITION_ARR_UPDIDX_S);
+    sqlite3_bind_int (STRUCT_PARTITION_ARR_UPDIDX_S, 1, partArrIdx);
+    sqlite3_bind_int (STRUCT_PARTITION_ARR_UPDIDX_S, 2, partId);
+
+    if (sqlite3_step (STRUCT_PARTITION_ARR_UPDIDX_S) != SQLITE_DONE)
+    {
+        doLog (ERROR, LOG_COMP, _("There was a problem updating the partition "
+                 "arr idx in structPartitionArr()."));
+        return -1;
+    }
+
+    /* Make appropriate links */
+    partArrPtr->dbId = partId;
+    /* partArrPtr->facade = partFacade; */
+
+    return 0;
+}
+
+
+static const char UNSTRUCT_PARTITION[] =
+    "SELECT " CUR_IDX("arrayIdx") " FROM SystemPartition WHERE id=?1";
+static sqlite3_stmt* UNSTRUCT_PARTITION_S;
+
+static int
+lsddb_unstructPartition (int partId)
+{
+    sqlite3_reset (UNSTRUCT_PARTITION_S);
+    sqlite3_bind_int (UNSTRUCT_PARTITION_S, 1, partId);
+    if (sqlite3_step (UNSTRUCT_PARTITION_S) != SQLITE_ROW)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to find partition %d in unstructPartition()."), partId);
+        return -1;
+    }
+
+    int arrIdx = sqlite3_column_int (UNSTRUCT_PARTITION_S, 0);
+    if (arrIdx >= 0 && delIdx (getArr_lsdPartitionArr (), arrIdx) < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to remove partition from array in unstructPartition()."));
+        return -1;
+    }
+
+    return 0;
+}
+
+
 int
 lsddb_structPartitionArr ()
 {
+    /* Node arrays come from the snapshot when the structure is
+     * unchanged since it was taken */
+    int snapRc = lsddb_restoreSnapshot ();
+    if (snapRc < -1)
+        return -1;
+    int fromSnapshot = ( snapRc == 0 );
 
     /* First insert partition facade nodes */
-    if (lsddb_structNodeInstArr (0) < 0)
+    if (!fromSnapshot && lsddb_structNodeInstArr (0) < 0)
     {
         doLog (ERROR, LOG_COMP, _("Unable to struct partition facade nodes in structPartitionArr()."));
         return -1;
@@ -1709,48 +2627,16 @@ lsddb_structPartitionArr ()
         int patchSpaceId = sqlite3_column_int (STRUCT_PARTITION_ARR_S, 1);
 
         /* Insert corresponding partition structure */
-        size_t partArrIdx;
-        struct LSD_Partition* partArrPtr;
-        if (insertElem (getArr_lsdPartitionArr (), &partArrIdx,
-                        (void**)&partArrPtr) < 0)
-        {
-            doLog (ERROR, LOG_COMP, _("Unable to insert Partition into array in createPartition()."));
+        if (lsddb_structPartition (partId) < 0)
             return -1;
-        }
 
         /* Construct nodes in the partition's contained
-         * patchSpace */
-        if (lsddb_structNodeInstArr (patchSpaceId) < 0)
+         * patchSpace and in every facade nested within it */
+        if (!fromSnapshot && lsddb_structPatchSpaceTree (patchSpaceId) < 0)
         {
             doLog (ERROR, LOG_COMP, _("Unable to insert nodes contained within partition's patch space in structPartitionArr()."));
             return -1;
         }
-
-        /* Construct nodes within facades in the partition's
-         * patchSpace */
-        sqlite3_reset (REMOVE_PATCH_SPACE_FACADES_S);
-        sqlite3_bind_int (REMOVE_PATCH_SPACE_FACADES_S, 1, patchSpaceId);
-        while (sqlite3_step (REMOVE_PATCH_SPACE_FACADES_S) == SQLITE_ROW)
-        {
-            int cpsId = sqlite3_column_int (REMOVE_PATCH_SPACE_FACADES_S, 0);
-            lsddb_structNodeInstArr (cpsId);
-        }
-
-        /* Update arr idx */
-        sqlite3_reset (STRUCT_PARTITION_ARR_UPDIDX_S);
-        sqlite3_bind_int (STRUCT_PARTITION_ARR_UPDIDX_S, 1, partArrIdx);
-        sqlite3_bind_int (STRUCT_PARTITION_ARR_UPDIDX_S, 2, partId);
-
-        if (sqlite3_step (STRUCT_PARTITION_ARR_UPDIDX_S) != SQLITE_DONE)
-        {
-            doLog (ERROR, LOG_COMP, _("There was a problem updating the partition "
-                     "arr idx in structPartitionArr()."));
-            return -1;
-        }
-
-        /* Make appropriate links */
-        partArrPtr->dbId = partId;
-        /* partArrPtr->facade = partFacade; */
     }
     if (errcode != SQLITE_DONE)
     {
@@ -1759,7 +2645,8 @@ lsddb_structPartitionArr ()
     }
 
     /* Iterate to reestablish wire connections */
-    lsddb_rewireNodes ();
+    if (!fromSnapshot)
+        lsddb_rewireNodes ();
 
     return 0;
 }
@@ -1770,7 +2657,7 @@ static const char ADD_NODE_INST_INPUT_INSERT[] =
 static sqlite3_stmt* ADD_NODE_INST_INPUT_INSERT_S;
 
 static const char ADD_NODE_INST_INPUT_UPDIDX[] =
-    "UPDATE SceneNodeInstInput SET arrIdx=?2 WHERE id=?1";
+    "UPDATE SceneNodeInstInput SET arrIdx=?2,arrGen=lsdgen() WHERE id=?1";
 static sqlite3_stmt* ADD_NODE_INST_INPUT_UPDIDX_S;
 
 int
@@ -1825,6 +2712,12 @@ lsddb_addNodeInstInput (struct LSD_SceneNodeInst const* node,
     input->parentNode = node;
     input->connection = NULL;
 
+    if (lsdmap_put (getMap_lsdNodeInputMap (), inputId, input) < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to map input in addNodeInstInput()."));
+        return -1;
+    }
+
     if (ptrToBind)
         *ptrToBind = input;
     if (idBinding)
@@ -1840,7 +2733,7 @@ static const char ADD_NODE_INST_OUTPUT_INSERT[] =
 static sqlite3_stmt* ADD_NODE_INST_OUTPUT_INSERT_S;
 
 static const char ADD_NODE_INST_OUTPUT_UPDIDX[] =
-    "UPDATE SceneNodeInstOutput SET arrIdx=?2 WHERE id=?1";
+    "UPDATE SceneNodeInstOutput SET arrIdx=?2,arrGen=lsdgen() WHERE id=?1";
 static sqlite3_stmt* ADD_NODE_INST_OUTPUT_UPDIDX_S;
 
 int
@@ -1898,6 +2791,12 @@ lsddb_addNodeInstOutput (struct LSD_SceneNodeInst const* node,
     output->typeId = typeId;
     output->parentNode = node;
 
+    if (lsdmap_put (getMap_lsdNodeOutputMap (), outputId, output) < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to map output in addNodeInstOutput()."));
+        return -1;
+    }
+
     if (ptrToBind)
         *ptrToBind = output;
     if (idBinding)
@@ -1908,7 +2807,7 @@ lsddb_addNodeInstOutput (struct LSD_SceneNodeInst const* node,
 
 
 static const char REMOVE_NODE_INST_INPUT_ARRIDX[] =
-    "SELECT arrIdx FROM SceneNodeInstInput WHERE id=?1";
+    "SELECT " CUR_IDX("arrIdx") " FROM SceneNodeInstInput WHERE id=?1";
 static sqlite3_stmt* REMOVE_NODE_INST_INPUT_ARRIDX_S;
 
 static const char REMOVE_NODE_INST_INPUT[] =
@@ -1945,12 +2844,17 @@ lsddb_removeNodeInstInput (int inputId)
         return -1;
     }
 
+    lockScene ();
+    lsdmap_remove (getMap_lsdNodeInputMap (), inputId);
+
     if (arrIdx >= 0)
         if (delIdx (getArr_lsdNodeInputArr (), arrIdx) < 0)
         {
+            unlockScene ();
             doLog (ERROR, LOG_COMP, _("Unable to remove input from array in removeNodeInstInput()."));
             return -1;
         }
+    unlockScene ();
 
     /* remove record from DB */
     sqlite3_reset (REMOVE_NODE_INST_INPUT_S);
@@ -1967,7 +2871,7 @@ lsddb_removeNodeInstInput (int inputId)
 
 
 static const char REMOVE_NODE_INST_OUTPUT_ARRIDX[] =
-    "SELECT arrIdx FROM SceneNodeInstOutput WHERE id=?1";
+    "SELECT " CUR_IDX("arrIdx") " FROM SceneNodeInstOutput WHERE id=?1";
 static sqlite3_stmt* REMOVE_NODE_INST_OUTPUT_ARRIDX_S;
 
 static const char REMOVE_NODE_INST_OUTPUT[] =
@@ -2004,12 +2908,17 @@ lsddb_removeNodeInstOutput (int outputId)
         return -1;
     }
 
+    lockScene ();
+    lsdmap_remove (getMap_lsdNodeOutputMap (), outputId);
+
     if (arrIdx >= 0)
         if (delIdx (getArr_lsdNodeOutputArr (), arrIdx) < 0)
         {
+            unlockScene ();
             doLog (ERROR, LOG_COMP, _("Unable to remove output from array in removeNodeInstOutput()."));
             return -1;
         }
+    unlockScene ();
 
     /* remove record from DB */
     sqlite3_reset (REMOVE_NODE_INST_OUTPUT_S);
@@ -2030,8 +2939,8 @@ lsddb_removeNodeInstOutput (int outputId)
   *state for dynamic insertion of nodes
   */
 static const char ADD_NODE_INST[] =
-    "INSERT INTO SceneNodeInst (arrIdx,classId,patchSpaceId,name) "
-    "VALUES (?1,?2,?3,?4)";
+    "INSERT INTO SceneNodeInst (arrIdx,arrGen,classId,patchSpaceId,name) "
+    "VALUES (?1,lsdgen(),?2,?3,?4)";
 static sqlite3_stmt* ADD_NODE_INST_S;
 
 static const char GET_NODE_CLASS_NAME[] =
@@ -2093,6 +3002,12 @@ lsddb_addNodeInst (int patchSpaceId, struct LSD_SceneNodeClass* nc,
 
     targetPtr->dbId = rowid;
     targetPtr->nodeClass = nc;
+
+    if (lsdmap_put (getMap_lsdNodeInstMap (), rowid, targetPtr) < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to map node instance in addNodeInst()."));
+        return -1;
+    }
     if (nc->instDataSize > 0)
     {
         targetPtr->data = malloc (nc->instDataSize);
@@ -2107,6 +3022,10 @@ lsddb_addNodeInst (int patchSpaceId, struct LSD_SceneNodeClass* nc,
     if (ptrToBind)
         *ptrToBind = targetPtr;
 
+    /* Nothing renders the new node until it is wired, but its
+     * plugin may share state with nodes that are */
+    lockScene ();
+
     if (nc->nodeMakeFunc)
         if (nc->nodeMakeFunc (targetPtr, targetPtr->data) < 0)
             doLog (ERROR, LOG_COMP, _("Plugin's Make function returned failure."));
@@ -2115,12 +3034,14 @@ lsddb_addNodeInst (int patchSpaceId, struct LSD_SceneNodeClass* nc,
         if (nc->nodeRestoreFunc (targetPtr, targetPtr->data) < 0)
             doLog (ERROR, LOG_COMP, _("Plugin's Restore function returned failure."));
 
+    unlockScene ();
+
     return 0;
 }
 
 
 static const char REMOVE_NODE_INST_CHECK[] =
-    "SELECT arrIdx FROM SceneNodeInst WHERE id=?1";
+    "SELECT " CUR_IDX("arrIdx") " FROM SceneNodeInst WHERE id=?1";
 static sqlite3_stmt* REMOVE_NODE_INST_CHECK_S;
 
 static const char REMOVE_NODE_INST_GET_INS[] =
@@ -2147,13 +3068,27 @@ lsddb_removeNodeInst (int nodeId)
     {
         int arrIdx = sqlite3_column_int (REMOVE_NODE_INST_CHECK_S, 0);
 
+        /* Remove each inst output first; once unwired, the
+         * render thread can no longer reach the node */
+        sqlite3_reset (REMOVE_NODE_INST_GET_OUTS_S);
+        sqlite3_bind_int (REMOVE_NODE_INST_GET_OUTS_S, 1, nodeId);
+
+        while (sqlite3_step (REMOVE_NODE_INST_GET_OUTS_S) == SQLITE_ROW)
+        {
+            int outId = sqlite3_column_int (REMOVE_NODE_INST_GET_OUTS_S, 0);
+            lsddb_removeNodeInstOutput (outId);
+        }
+
         /* Pick node, run delete, remove from array (which
          * runs clean) */
         struct LSD_SceneNodeInst* condemnedNode;
 
+        lockScene ();
+
         if (pickIdx (getArr_lsdNodeInstArr (), (void**)&condemnedNode,
                      arrIdx) < 0)
         {
+            unlockScene ();
             doLog (ERROR, LOG_COMP, _("Unable to pick inst from array in removeNodeInst()."));
             return -1;
         }
@@ -2162,9 +3097,13 @@ lsddb_removeNodeInst (int nodeId)
             condemnedNode->nodeClass->nodeDeleteFunc (condemnedNode,
                                                       condemnedNode->data);
 
+        lsdmap_remove (getMap_lsdNodeInstMap (), nodeId);
+
         if (delIdx (getArr_lsdNodeInstArr (), arrIdx) < 0)
             doLog (ERROR, LOG_COMP, _("Unable to remove node from array in removeNodeInst()."));
 
+        unlockScene ();
+
         /* Remove each inst input */
         sqlite3_reset (REMOVE_NODE_INST_GET_INS_S);
         sqlite3_bind_int (REMOVE_NODE_INST_GET_INS_S, 1, nodeId);
@@ -2175,16 +3114,6 @@ lsddb_removeNodeInst (int nodeId)
             lsddb_removeNodeInstInput (inId);
         }
 
-        /* Remove each inst output */
-        sqlite3_reset (REMOVE_NODE_INST_GET_OUTS_S);
-        sqlite3_bind_int (REMOVE_NODE_INST_GET_OUTS_S, 1, nodeId);
-
-        while (sqlite3_step (REMOVE_NODE_INST_GET_OUTS_S) == SQLITE_ROW)
-        {
-            int outId = sqlite3_column_int (REMOVE_NODE_INST_GET_OUTS_S, 0);
-            lsddb_removeNodeInstOutput (outId);
-        }
-
         /* Remove node */
         sqlite3_reset (REMOVE_NODE_INST_DELETE_S);
         sqlite3_bind_int (REMOVE_NODE_INST_DELETE_S, 1, nodeId);
@@ -2408,71 +3337,393 @@ static const char JSON_PLUGINS[] =
 static sqlite3_stmt* JSON_PLUGINS_S;
 
 int
-lsddb_jsonPlugins (cJSON* target)
+lsddb_jsonPlugins (struct LSD_JsonWriter* target)
 {
     if (!target)
         return -1;
 
-    cJSON* pluginArr = cJSON_CreateArray ();
+    lsdjson_beginArray (target, "plugins");
+
+    sqlite3_reset (JSON_PLUGINS_S);
+
+    while (sqlite3_step (JSON_PLUGINS_S) == SQLITE_ROW)
+    {
+        int pluginId = sqlite3_column_int (JSON_PLUGINS_S, 0);
+        const unsigned char* pluginDirName = sqlite3_column_text (
+            JSON_PLUGINS_S,
+            1);
+        const unsigned char* pluginSha = sqlite3_column_text (JSON_PLUGINS_S, 2);
+        int enabled = sqlite3_column_int (JSON_PLUGINS_S, 3);
+
+        lsdjson_beginObject (target, NULL);
+        lsdjson_int (target, "pluginId", pluginId);
+        lsdjson_string (target, "pluginDir", (const char*)pluginDirName);
+        lsdjson_string (target, "pluginSha", (const char*)pluginSha);
+        lsdjson_int (target, "enabled", enabled);
+        lsdjson_endObject (target);
+    }
+
+    lsdjson_endArray (target);
+
+    return 0;
+}
+
+
+/* Disable Plugin */
+static const char DISABLE_PLUGIN[] =
+    "UPDATE ScenePlugin SET enabled=0 WHERE id=?1";
+static sqlite3_stmt* DISABLE_PLUGIN_S;
+
+int
+lsddb_disablePlugin (int pluginId)
+{
+    sqlite3_reset (DISABLE_PLUGIN_S);
+    sqlite3_bind_int (DISABLE_PLUGIN_S, 1, pluginId);
+    if (sqlite3_step (DISABLE_PLUGIN_S) == SQLITE_DONE)
+        return 0;
+    return -1;
+}
+
+
+/* Enable Plugin */
+static const char ENABLE_PLUGIN[] =
+    "UPDATE ScenePlugin SET enabled=1 WHERE id=?1";
+static sqlite3_stmt* ENABLE_PLUGIN_S;
+
+int
+lsddb_enablePlugin (int pluginId)
+{
+    sqlite3_reset (ENABLE_PLUGIN_S);
+    sqlite3_bind_int (ENABLE_PLUGIN_S, 1, pluginId);
+    if (sqlite3_step (ENABLE_PLUGIN_S) == SQLITE_DONE)
+        return 0;
+    return -1;
+}
+
+
+/* Runtime plugin activation. Only the plugin's own classes,
+ * node instances and DB statements are constructed or torn
+ * down; every other plugin stays loaded and the scene keeps
+ * running. Nothing in the DB besides indices is touched, so
+ * the plugin's nodes and wires come back when re-enabled. */
+static const char STRUCT_PLUGIN_GET[] =
+    "SELECT pluginDomain,loaded,arrayIdx FROM ScenePlugin WHERE id=?1";
+static sqlite3_stmt* STRUCT_PLUGIN_GET_S;
+
+static const char STRUCT_PLUGIN_NODES[] =
+    "SELECT id,classId," CUR_IDX("arrIdx") " FROM SceneNodeInst WHERE "
+    "classId IN (SELECT id FROM SceneNodeClass WHERE pluginId=?1)";
+static sqlite3_stmt* STRUCT_PLUGIN_NODES_S;
+
+static int
+lsddb_structPluginInit (int pluginId)
+{
+    /* Core plugin is never unloaded */
+    if (pluginId == 1)
+        return 0;
+
+    sqlite3_reset (STRUCT_PLUGIN_GET_S);
+    sqlite3_bind_int (STRUCT_PLUGIN_GET_S, 1, pluginId);
+    if (sqlite3_step (STRUCT_PLUGIN_GET_S) != SQLITE_ROW)
+    {
+        doLog (ERROR, LOG_COMP, _("Plugin %d does not exist in structPlugin()."), pluginId);
+        return -1;
+    }
+    if (sqlite3_column_int (STRUCT_PLUGIN_GET_S, 1))
+        return 0;
+
+    char domain[256];
+    snprintf (domain, 256, "%s",
+              (const char*)sqlite3_column_text (STRUCT_PLUGIN_GET_S, 0));
+
+    /* Opening the SO runs the plugin HEAD through
+     * pluginHeadLoader() exactly as at init */
+    if (loadPlugin (domain) < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to load plugin %s in structPlugin()."), domain);
+        return -1;
+    }
+
+    sqlite3_reset (STRUCT_PLUGIN_GET_S);
+    sqlite3_bind_int (STRUCT_PLUGIN_GET_S, 1, pluginId);
+    if (sqlite3_step (STRUCT_PLUGIN_GET_S) != SQLITE_ROW ||
+        !sqlite3_column_int (STRUCT_PLUGIN_GET_S, 1))
+    {
+        doLog (ERROR, LOG_COMP, _("Plugin %s was not loaded in structPlugin()."), domain);
+        return -1;
+    }
+
+    /* The plugin's rows land at new indices; a snapshot of the
+     * old layout would restore stale ones on the next reload */
+    lsddb_dropSnapshot ();
+
+    /* Struct the plugin's nodes wherever they are patched */
+    sqlite3_reset (STRUCT_PLUGIN_NODES_S);
+    sqlite3_bind_int (STRUCT_PLUGIN_NODES_S, 1, pluginId);
+    int errcode;
+    while (( errcode = sqlite3_step (STRUCT_PLUGIN_NODES_S)) == SQLITE_ROW)
+    {
+        int instId = sqlite3_column_int (STRUCT_PLUGIN_NODES_S, 0);
+        int classId = sqlite3_column_int (STRUCT_PLUGIN_NODES_S, 1);
+        if (lsddb_structNodeInst (instId, classId) < 0)
+            return -1;
+    }
+    if (errcode != SQLITE_DONE)
+    {
+        doLog (ERROR, LOG_COMP, _("structPlugin() did not loop cleanly."));
+        return -1;
+    }
+
+    /* Connect the new plugs and anything that was waiting on
+     * them */
+    if (lsddb_rewireDangling () < 0 || lsddb_retraceChannels () < 0)
+        return -1;
+
+    doLog (NOTICE, LOG_COMP, _("Structed plugin %s."), domain);
+    return 0;
+}
+
+
+int
+lsddb_structPlugin (int pluginId)
+{
+    /* Plugin code runs throughout, so it's done between frames.
+     * The plugin's init and restore funcs expect the init phase
+     * of the API, just as during a reload */
+    lockScene ();
+    lsdapi_setState (STATE_PINIT);
+    int rc = lsddb_structPluginInit (pluginId);
+    lsdapi_setState (STATE_PRUN);
+    unlockScene ();
+    return rc;
+}
+
+
+static const char RESTRUCT_PLUGIN_FIND[] =
+    "SELECT id,loaded FROM ScenePlugin WHERE pluginDomain=?1";
+static sqlite3_stmt* RESTRUCT_PLUGIN_FIND_S;
+
+/* Swaps a running plugin for the build now on disk. Plugins
+ * that aren't loaded are left alone; they pick the new build
+ * up when enabled */
+int
+lsddb_restructPlugin (const char* pluginDomain)
+{
+    if (!pluginDomain)
+        return -1;
+
+    sqlite3_reset (RESTRUCT_PLUGIN_FIND_S);
+    sqlite3_bind_text (RESTRUCT_PLUGIN_FIND_S, 1, pluginDomain, -1, NULL);
+    if (sqlite3_step (RESTRUCT_PLUGIN_FIND_S) != SQLITE_ROW ||
+        !sqlite3_column_int (RESTRUCT_PLUGIN_FIND_S, 1))
+        return 0;
+    int pluginId = sqlite3_column_int (RESTRUCT_PLUGIN_FIND_S, 0);
+
+    if (lsddb_unstructPlugin (pluginId) < 0)
+        return -1;
+    return lsddb_structPlugin (pluginId);
+}
+
+
+static const char UNSTRUCT_PLUGIN_INS[] =
+    "SELECT id," CUR_IDX("arrIdx") " FROM SceneNodeInstInput WHERE "
+    "instId=?1 AND facadeBool=0";
+static sqlite3_stmt* UNSTRUCT_PLUGIN_INS_S;
+
+static const char UNSTRUCT_PLUGIN_OUTS[] =
+    "SELECT id," CUR_IDX("arrIdx") " FROM SceneNodeInstOutput WHERE "
+    "instId=?1 AND facadeBool=0";
+static sqlite3_stmt* UNSTRUCT_PLUGIN_OUTS_S;
+
+static const char UNSTRUCT_PLUGIN_CLASSES[] =
+    "SELECT arrayIdx FROM SceneNodeClass WHERE pluginId=?1 AND arrayIdx>=0";
+static sqlite3_stmt* UNSTRUCT_PLUGIN_CLASSES_S;
+
+static const char UNSTRUCT_PLUGIN_RESET_INS[] =
+    "UPDATE SceneNodeInstInput SET arrIdx=-1 WHERE facadeBool=0 AND instId IN "
+    "(SELECT id FROM SceneNodeInst WHERE classId IN "
+    "(SELECT id FROM SceneNodeClass WHERE pluginId=?1))";
+static sqlite3_stmt* UNSTRUCT_PLUGIN_RESET_INS_S;
+
+static const char UNSTRUCT_PLUGIN_RESET_OUTS[] =
+    "UPDATE SceneNodeInstOutput SET arrIdx=-1 WHERE facadeBool=0 AND instId IN "
+    "(SELECT id FROM SceneNodeInst WHERE classId IN "
+    "(SELECT id FROM SceneNodeClass WHERE pluginId=?1))";
+static sqlite3_stmt* UNSTRUCT_PLUGIN_RESET_OUTS_S;
+
+static const char UNSTRUCT_PLUGIN_RESET_NODES[] =
+    "UPDATE SceneNodeInst SET arrIdx=-1 WHERE classId IN "
+    "(SELECT id FROM SceneNodeClass WHERE pluginId=?1)";
+static sqlite3_stmt* UNSTRUCT_PLUGIN_RESET_NODES_S;
+
+static const char UNSTRUCT_PLUGIN_RESET_CLASSES[] =
+    "UPDATE SceneNodeClass SET arrayIdx=-1 WHERE pluginId=?1";
+static sqlite3_stmt* UNSTRUCT_PLUGIN_RESET_CLASSES_S;
+
+static const char UNSTRUCT_PLUGIN_RESET_PLUGIN[] =
+    "UPDATE ScenePlugin SET arrayIdx=-1,loaded=0 WHERE id=?1";
+static sqlite3_stmt* UNSTRUCT_PLUGIN_RESET_PLUGIN_S;
+
+/* Removes each plug listed by stmt from its map and array */
+static int
+lsddb_unstructPlugs (sqlite3_stmt* stmt, int instId,
+                     struct LSD_IdMap* map, struct LSD_ArrayHead* arr)
+{
+    sqlite3_reset (stmt);
+    sqlite3_bind_int (stmt, 1, instId);
+    while (sqlite3_step (stmt) == SQLITE_ROW)
+    {
+        int plugId = sqlite3_column_int (stmt, 0);
+        int arrIdx = sqlite3_column_int (stmt, 1);
+
+        lsdmap_remove (map, plugId);
+        if (arrIdx >= 0 && delIdx (arr, arrIdx) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+
+/* Removes a loaded plugin's structures; returns 1 if there
+ * was nothing to remove */
+static int
+lsddb_unstructPluginInPlace (int pluginId)
+{
+    if (pluginId == 1)
+        return 1;
+
+    sqlite3_reset (STRUCT_PLUGIN_GET_S);
+    sqlite3_bind_int (STRUCT_PLUGIN_GET_S, 1, pluginId);
+    if (sqlite3_step (STRUCT_PLUGIN_GET_S) != SQLITE_ROW)
+    {
+        doLog (ERROR, LOG_COMP, _("Plugin %d does not exist in unstructPlugin()."), pluginId);
+        return -1;
+    }
+    if (!sqlite3_column_int (STRUCT_PLUGIN_GET_S, 1))
+        return 1;
+    int pluginArrIdx = sqlite3_column_int (STRUCT_PLUGIN_GET_S, 2);
+
+    struct LSD_ScenePlugin* plugin;
+    if (pickIdx (getArr_lsdPluginArr (), (void**)&plugin, pluginArrIdx) < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to pick plugin from array in unstructPlugin()."));
+        return -1;
+    }
+
+    /* Indices freed here no longer match the snapshot */
+    lsddb_dropSnapshot ();
+
+    /* Clean and remove each of the plugin's nodes (the inst
+     * destructor runs the clean func) */
+    sqlite3_reset (STRUCT_PLUGIN_NODES_S);
+    sqlite3_bind_int (STRUCT_PLUGIN_NODES_S, 1, pluginId);
+    while (sqlite3_step (STRUCT_PLUGIN_NODES_S) == SQLITE_ROW)
+    {
+        int instId = sqlite3_column_int (STRUCT_PLUGIN_NODES_S, 0);
+        int arrIdx = sqlite3_column_int (STRUCT_PLUGIN_NODES_S, 2);
+        if (arrIdx < 0)
+            continue;
+
+        lsdmap_remove (getMap_lsdNodeInstMap (), instId);
+        if (delIdx (getArr_lsdNodeInstArr (), arrIdx) < 0 ||
+            lsddb_unstructPlugs (UNSTRUCT_PLUGIN_INS_S, instId,
+                                 getMap_lsdNodeInputMap (),
+                                 getArr_lsdNodeInputArr ()) < 0 ||
+            lsddb_unstructPlugs (UNSTRUCT_PLUGIN_OUTS_S, instId,
+                                 getMap_lsdNodeOutputMap (),
+                                 getArr_lsdNodeOutputArr ()) < 0)
+        {
+            doLog (ERROR, LOG_COMP, _("Unable to remove node %d in unstructPlugin()."), instId);
+            return -1;
+        }
+    }
+
+    /* Removed outputs are zeroed; drop any connection still
+     * pointing at one */
+    size_t i;
+    struct LSD_ArrayHead* inArr = getArr_lsdNodeInputArr ();
+    if (inArr->maxIdx != (size_t)-1)
+        for (i = 0; i <= inArr->maxIdx; ++i)
+        {
+            struct LSD_SceneNodeInput* in;
+            if (pickIdx (inArr, (void**)&in, i) < 0)
+                return -1;
+            if (in->connection && !in->connection->dbId)
+                in->connection = NULL;
+        }
+
+    struct LSD_ArrayHead* chanArr = getArr_lsdChannelArr ();
+    if (chanArr->maxIdx != (size_t)-1)
+        for (i = 0; i <= chanArr->maxIdx; ++i)
+        {
+            struct LSD_Channel* chan;
+            if (pickIdx (chanArr, (void**)&chan, i) < 0)
+                return -1;
+            if (chan->output && !chan->output->dbId)
+                chan->output = NULL;
+        }
+
+    /* Finalise the plugin's own statements */
+    struct LSD_ArrayHead* stmtArr = getArr_lsdDBStmtArr ();
+    if (stmtArr->maxIdx != (size_t)-1)
+        for (i = 0; i <= stmtArr->maxIdx; ++i)
+        {
+            struct LSD_SceneDBStmt* stmtObj;
+            if (pickIdx (stmtArr, (void**)&stmtObj, i) < 0)
+                return -1;
+            if (stmtObj->stmt && stmtObj->pluginPtr == plugin)
+                delIdx (stmtArr, i);
+        }
 
-    sqlite3_reset (JSON_PLUGINS_S);
+    /* Classes hold function pointers into the SO */
+    sqlite3_reset (UNSTRUCT_PLUGIN_CLASSES_S);
+    sqlite3_bind_int (UNSTRUCT_PLUGIN_CLASSES_S, 1, pluginId);
+    while (sqlite3_step (UNSTRUCT_PLUGIN_CLASSES_S) == SQLITE_ROW)
+        delIdx (getArr_lsdNodeClassArr (),
+                sqlite3_column_int (UNSTRUCT_PLUGIN_CLASSES_S, 0));
 
-    while (sqlite3_step (JSON_PLUGINS_S) == SQLITE_ROW)
+    /* Runs the plugin's cleanup and closes the SO */
+    if (delIdx (getArr_lsdPluginArr (), pluginArrIdx) < 0)
     {
-        cJSON* pluginObj = cJSON_CreateObject ();
-
-        int pluginId = sqlite3_column_int (JSON_PLUGINS_S, 0);
-        const unsigned char* pluginDirName = sqlite3_column_text (
-            JSON_PLUGINS_S,
-            1);
-        const unsigned char* pluginSha = sqlite3_column_text (JSON_PLUGINS_S, 2);
-        int enabled = sqlite3_column_int (JSON_PLUGINS_S, 3);
-
-        cJSON_AddNumberToObject (pluginObj, "pluginId", pluginId);
-        cJSON_AddStringToObject (pluginObj,
-                                 "pluginDir",
-                                 (const char*)pluginDirName);
-        cJSON_AddStringToObject (pluginObj, "pluginSha", (const char*)pluginSha);
-        cJSON_AddNumberToObject (pluginObj, "enabled", enabled);
-
-        cJSON_AddItemToArray (pluginArr, pluginObj);
+        doLog (ERROR, LOG_COMP, _("Unable to remove plugin from array in unstructPlugin()."));
+        return -1;
     }
 
-    cJSON_AddItemToObject (target, "plugins", pluginArr);
-
     return 0;
 }
 
 
-/* Disable Plugin */
-static const char DISABLE_PLUGIN[] =
-    "UPDATE ScenePlugin SET enabled=0 WHERE id=?1";
-static sqlite3_stmt* DISABLE_PLUGIN_S;
-
 int
-lsddb_disablePlugin (int pluginId)
+lsddb_unstructPlugin (int pluginId)
 {
-    sqlite3_reset (DISABLE_PLUGIN_S);
-    sqlite3_bind_int (DISABLE_PLUGIN_S, 1, pluginId);
-    if (sqlite3_step (DISABLE_PLUGIN_S) == SQLITE_DONE)
-        return 0;
-    return -1;
-}
-
-
-/* Enable Plugin */
-static const char ENABLE_PLUGIN[] =
-    "UPDATE ScenePlugin SET enabled=1 WHERE id=?1";
-static sqlite3_stmt* ENABLE_PLUGIN_S;
+    /* Plugin code runs throughout, so it's done between frames */
+    lockScene ();
+    int rc = lsddb_unstructPluginInPlace (pluginId);
+    unlockScene ();
+    if (rc)
+        return ( rc > 0 ) ? 0 : -1;
+
+    /* Indices of everything removed are now meaningless */
+    size_t i;
+    sqlite3_stmt* const resets[] = {
+        UNSTRUCT_PLUGIN_RESET_INS_S, UNSTRUCT_PLUGIN_RESET_OUTS_S,
+        UNSTRUCT_PLUGIN_RESET_NODES_S, UNSTRUCT_PLUGIN_RESET_CLASSES_S,
+        UNSTRUCT_PLUGIN_RESET_PLUGIN_S
+    };
+    for (i = 0; i < sizeof( resets ) / sizeof( resets[0] ); ++i)
+    {
+        sqlite3_reset (resets[i]);
+        sqlite3_bind_int (resets[i], 1, pluginId);
+        if (sqlite3_step (resets[i]) != SQLITE_DONE)
+        {
+            doLog (ERROR, LOG_COMP, _("Unable to reset plugin indices in unstructPlugin()\nDetails: %s"),
+                   sqlite3_errmsg (memdb));
+            return -1;
+        }
+    }
 
-int
-lsddb_enablePlugin (int pluginId)
-{
-    sqlite3_reset (ENABLE_PLUGIN_S);
-    sqlite3_bind_int (ENABLE_PLUGIN_S, 1, pluginId);
-    if (sqlite3_step (ENABLE_PLUGIN_S) == SQLITE_DONE)
-        return 0;
-    return -1;
+    doLog (NOTICE, LOG_COMP, _("Unstructed plugin %d."), pluginId);
+    return 0;
 }
 
 
@@ -2582,9 +3833,13 @@ lsddb_pluginHeadLoader (ghType phGet,
                                NULL);
             if (sqlite3_step (PLUGIN_HEAD_LOADER_CHECK_SHA_S) != SQLITE_ROW)
             {
-                /* Match not found, disable and update */
-                enabled = 0;
-                lsddb_disablePlugin (pluginId);
+                /* Match not found, disable and update (unless this
+                 * build is being loaded on request) */
+                if (!enable)
+                {
+                    enabled = 0;
+                    lsddb_disablePlugin (pluginId);
+                }
 
                 sqlite3_reset (PLUGIN_HEAD_LOADER_UPDATE_SHA_S);
                 sqlite3_bind_int (PLUGIN_HEAD_LOADER_UPDATE_SHA_S, 1, pluginId);
@@ -2723,8 +3978,49 @@ lsddb_resolvePluginFromNodeId (struct LSD_ScenePlugin** pluginBind, int nodeId)
 }
 
 
+/* Facade alias closure. A facade plug that has been wired or
+ * traced maps straight to the id of the node plug it
+ * terminates at, so nested patch spaces trace in constant
+ * time instead of one DB query per level. Entries are dropped
+ * before any alias they were derived from changes; a miss
+ * always falls back to walking the DB. */
+#define ALIAS_ID(entry) ( (int)(intptr_t)( entry ) )
+#define ID_ALIAS(id) ( (void*)(intptr_t)( id ) )
+
+static void
+lsddb_forgetInputAlias (int facadeInId)
+{
+    struct LSD_IdMap* closure = getMap_lsdFacadeInMap ();
+
+    int terminal;
+    if (lsddb_traceInput (NULL, facadeInId, NULL, &terminal) == 0)
+        /* Facade inputs passed through this one share its
+         * terminal */
+        lsdmap_removeValue (closure, ID_ALIAS (terminal));
+    else
+        lsdmap_remove (closure, facadeInId);
+}
+
+
+static void
+lsddb_forgetOutputAlias (int facadeOutId)
+{
+    struct LSD_IdMap* closure = getMap_lsdFacadeOutMap ();
+
+    int terminal;
+    if (lsddb_traceOutput (NULL, facadeOutId, NULL, &terminal) == 0)
+        /* Every facade traced through this one shares its
+         * terminal (unrelated ones sharing it just re-trace) */
+        lsdmap_removeValue (closure, ID_ALIAS (terminal));
+    else
+        /* Untraceable now, so nothing can have traced through
+         * it since its chain last changed */
+        lsdmap_remove (closure, facadeOutId);
+}
+
+
 static const char TRACE_INPUT[] =
-    "SELECT facadeBool,aliasedIn,arrIdx,typeId,id FROM SceneNodeInstInput WHERE id=?1";
+    "SELECT facadeBool,aliasedIn FROM SceneNodeInstInput WHERE id=?1";
 static sqlite3_stmt* TRACE_INPUT_S;
 
 int
@@ -2733,60 +4029,62 @@ lsddb_traceInput (struct LSD_SceneNodeInput** ptrToBind,
                   int* typeIdBind,
                   int* tracedIn)
 {
-    /* Recursively drill down to find a standard node's
-     * input (i.e. not a facade input) */
-    int facadeBool = 1;
+    struct LSD_IdMap* nodeIns = getMap_lsdNodeInputMap ();
+    struct LSD_IdMap* closure = getMap_lsdFacadeInMap ();
+
+    /* Drill down to a constructed standard node's input
+     * (i.e. not a facade input) */
+    struct LSD_SceneNodeInput* inputObj;
     int aliasedIn = inputId;
 
-    while (facadeBool)
+    while (!( inputObj = lsdmap_get (nodeIns, aliasedIn) ))
     {
+        int terminal = ALIAS_ID (lsdmap_get (closure, aliasedIn));
+        if (terminal && ( inputObj = lsdmap_get (nodeIns, terminal) ))
+            break;
+
         sqlite3_reset (TRACE_INPUT_S);
         sqlite3_bind_int (TRACE_INPUT_S, 1, aliasedIn);
-        if (sqlite3_step (TRACE_INPUT_S) == SQLITE_ROW)
-        {
-            facadeBool = sqlite3_column_int (TRACE_INPUT_S, 0);
-            aliasedIn = sqlite3_column_int (TRACE_INPUT_S, 1);
-        }
-        else
+        if (sqlite3_step (TRACE_INPUT_S) != SQLITE_ROW)
         {
             doLog (ERROR, LOG_COMP, _("Unable to traceInput %d()\nDetails: %s"), 
                    inputId, sqlite3_errmsg (memdb));
             return -1;
         }
+
+        if (!sqlite3_column_int (TRACE_INPUT_S, 0))
+        {
+            doLog (WARNING, LOG_COMP, _("Input is not constructed in memory; its plugin may be disabled."));
+            return -1;
+        }
+
+        aliasedIn = sqlite3_column_int (TRACE_INPUT_S, 1);
+
+        /* Facade input not internally connected */
+        if (aliasedIn <= 0)
+            return -1;
     }
+
     /* Finally done */
-    int arrIdx = sqlite3_column_int (TRACE_INPUT_S, 2);
-    if (arrIdx == -1)
-    {
-        doLog (WARNING, LOG_COMP, _("Input is not constructed in memory; its plugin may be disabled."));
-        return -1;
-    }
+    if (inputObj->dbId != inputId)
+        lsdmap_put (closure, inputId, ID_ALIAS (inputObj->dbId));
 
     if (tracedIn)
-        *tracedIn = sqlite3_column_int (TRACE_INPUT_S, 4);
+        *tracedIn = inputObj->dbId;
 
     if (typeIdBind)
-        *typeIdBind = sqlite3_column_int (TRACE_INPUT_S, 3);
-
-    if (!ptrToBind)
-        return 0;
+        *typeIdBind = inputObj->typeId;
 
     /* Bind input object for caller */
-    struct LSD_SceneNodeInput* inputObj;
-    if (pickIdx (getArr_lsdNodeInputArr (), (void**)&inputObj, arrIdx) < 0)
-    {
-        doLog (ERROR, LOG_COMP, _("Unable to pick Input in traceInput()."));
-        return -1;
-    }
-
-    *ptrToBind = inputObj;
+    if (ptrToBind)
+        *ptrToBind = inputObj;
 
     return 0;
 }
 
 
 static const char TRACE_OUTPUT[] =
-    "SELECT facadeBool,aliasedOut,arrIdx,typeId,id FROM SceneNodeInstOutput WHERE id=?1";
+    "SELECT facadeBool,aliasedOut FROM SceneNodeInstOutput WHERE id=?1";
 static sqlite3_stmt* TRACE_OUTPUT_S;
 
 int
@@ -2795,50 +4093,48 @@ lsddb_traceOutput (struct LSD_SceneNodeOutput** ptrToBind,
                    int* typeIdBind,
                    int* tracedOut)
 {
-    /* Recursively drill down to find a standard node's
-     * output (i.e. not a facade output) */
-    int facadeBool = 1;
+    struct LSD_IdMap* nodeOuts = getMap_lsdNodeOutputMap ();
+    struct LSD_IdMap* closure = getMap_lsdFacadeOutMap ();
+
+    /* Drill down to a constructed standard node's output
+     * (i.e. not a facade output) */
+    struct LSD_SceneNodeOutput* outputObj;
     int aliasedOut = outputId;
 
-    while (facadeBool)
+    while (!( outputObj = lsdmap_get (nodeOuts, aliasedOut) ))
     {
+        int terminal = ALIAS_ID (lsdmap_get (closure, aliasedOut));
+        if (terminal && ( outputObj = lsdmap_get (nodeOuts, terminal) ))
+            break;
+
         sqlite3_reset (TRACE_OUTPUT_S);
         sqlite3_bind_int (TRACE_OUTPUT_S, 1, aliasedOut);
-        if (sqlite3_step (TRACE_OUTPUT_S) == SQLITE_ROW)
-        {
-            facadeBool = sqlite3_column_int (TRACE_OUTPUT_S, 0);
-            aliasedOut = sqlite3_column_int (TRACE_OUTPUT_S, 1);
-        }
-        else
+        if (sqlite3_step (TRACE_OUTPUT_S) != SQLITE_ROW)
             /* fprintf(stderr,"Unable to traceOutput()\n"); */
             return -1;
+
+        if (!sqlite3_column_int (TRACE_OUTPUT_S, 0))
+        {
+            doLog (WARNING, LOG_COMP, _("Output is not constructed in memory; its plugin may be disabled."));
+            return -1;
+        }
+
+        aliasedOut = sqlite3_column_int (TRACE_OUTPUT_S, 1);
     }
+
     /* Finally done */
-    int arrIdx = sqlite3_column_int (TRACE_OUTPUT_S, 2);
-    if (arrIdx == -1)
-    {
-        doLog (WARNING, LOG_COMP, _("Output is not constructed in memory; its plugin may be disabled."));
-        return -1;
-    }
+    if (outputObj->dbId != outputId)
+        lsdmap_put (closure, outputId, ID_ALIAS (outputObj->dbId));
 
     if (tracedOut)
-        *tracedOut = sqlite3_column_int (TRACE_OUTPUT_S, 4);
+        *tracedOut = outputObj->dbId;
 
     if (typeIdBind)
-        *typeIdBind = sqlite3_column_int (TRACE_OUTPUT_S, 3);
-
-    if (!ptrToBind)
-        return 0;
+        *typeIdBind = outputObj->typeId;
 
     /* Bind output object for caller */
-    struct LSD_SceneNodeOutput* outputObj;
-    if (pickIdx (getArr_lsdNodeOutputArr (), (void**)&outputObj, arrIdx) < 0)
-    {
-        doLog (ERROR, LOG_COMP, _("Unable to pick Output in traceOutput()."));
-        return -1;
-    }
-
-    *ptrToBind = outputObj;
+    if (ptrToBind)
+        *ptrToBind = outputObj;
 
     return 0;
 }
@@ -2851,7 +4147,7 @@ static const char CHECK_CHANNEL_WIRING_GET_PS[] =
 static sqlite3_stmt* CHECK_CHANNEL_WIRING_GET_PS_S;
 
 static const char CHECK_CHANNEL_WIRING_GET_CHAN_ARRIDX[] =
-    "SELECT arrIdx FROM SystemChannel WHERE facadeOutId=?1";
+    "SELECT " CUR_IDX("arrIdx") " FROM SystemChannel WHERE facadeOutId=?1";
 static sqlite3_stmt* CHECK_CHANNEL_WIRING_GET_CHAN_ARRIDX_S;
 
 int
@@ -2892,8 +4188,11 @@ lsddb_checkChannelWiring (int facadeOutId, int srcOut)
                 }
 
                 /* Trace the output and connect on channel */
-                chan->output = NULL;
-                lsddb_traceOutput (&( chan->output ), srcOut, NULL, NULL);
+                struct LSD_SceneNodeOutput* output = NULL;
+                lsddb_traceOutput (&output, srcOut, NULL, NULL);
+                lockScene ();
+                chan->output = output;
+                unlockScene ();
 
             }
             else
@@ -2947,7 +4246,9 @@ lsddb_checkChannelUnwiring (int facadeOutId)
                 }
 
                 /* Disconnect on channel */
+                lockScene ();
                 chan->output = NULL;
+                unlockScene ();
 
             }
             else
@@ -3098,10 +4399,20 @@ lsddb_wireNodes (int srcFacadeInt,
             destPS = sqlite3_column_int (WIRE_NODES_GET_IN_PS_S, 0);
             destClass = sqlite3_column_int (WIRE_NODES_GET_IN_PS_S, 2);
         }
-        else
+        else  /* Try passing through a nested facade's input */
         {
-            doLog (ERROR, LOG_COMP, _("Unable to verify node input's patch space."));
-            return -1;
+            sqlite3_reset (WIRE_NODES_GET_FACADE_IN_CPS_S);
+            sqlite3_bind_int (WIRE_NODES_GET_FACADE_IN_CPS_S, 1, destId);
+            if (sqlite3_step (WIRE_NODES_GET_FACADE_IN_CPS_S) == SQLITE_ROW)
+            {
+                destPS = sqlite3_column_int (WIRE_NODES_GET_FACADE_IN_CPS_S, 1);
+                destClass = -1;
+            }
+            else
+            {
+                doLog (ERROR, LOG_COMP, _("Unable to verify node input's patch space."));
+                return -1;
+            }
         }
 
         if (srcPS != destPS)
@@ -3110,7 +4421,9 @@ lsddb_wireNodes (int srcFacadeInt,
             return -1;
         }
 
-        if (!lsddb_checkClassEnabled (destClass))
+        /* A nested facade's input is checked for its own
+         * internal connection below */
+        if (destClass != -1 && !lsddb_checkClassEnabled (destClass))
         {
             doLog (ERROR, LOG_COMP, _("Unable to connect wire's destination; destination class disabled."));
             return -1;
@@ -3160,6 +4473,12 @@ lsddb_wireNodes (int srcFacadeInt,
                 return -1;
             }
 
+            /* Extend the alias closure over this facade level */
+            int tracedIn;
+            if (lsddb_traceInput (NULL, destId, NULL, &tracedIn) == 0)
+                lsdmap_put (getMap_lsdFacadeInMap (), srcId,
+                            ID_ALIAS (tracedIn));
+
         }
         else
         {
@@ -3305,6 +4624,12 @@ lsddb_wireNodes (int srcFacadeInt,
                 return -1;
             }
 
+            /* Extend the alias closure over this facade level */
+            int tracedOut;
+            if (lsddb_traceOutput (NULL, srcId, NULL, &tracedOut) == 0)
+                lsdmap_put (getMap_lsdFacadeOutMap (), destId,
+                            ID_ALIAS (tracedOut));
+
             /* Facade output (srcId) MAY actually be a
              * partition's channel */
             /* This function checks this possibilility and
@@ -3465,7 +4790,9 @@ lsddb_wireNodes (int srcFacadeInt,
     wireId = sqlite3_last_insert_rowid (memdb);
 
     /* Perform pointer wiring */
+    lockScene ();
     dest->connection = src;
+    unlockScene ();
 
     if (idBinding)
         *idBinding = wireId;
@@ -3516,7 +4843,9 @@ lsddb_unwireNodes (int wireId)
         int destIn = sqlite3_column_int (UNWIRE_NODES_GET_EDGE_DETAILS_S, 3);
 
         if (srcFacadeInt)  /* Left side facade in */
-        {   /* Remove wire connected outside facade in */
+        {   lsddb_forgetInputAlias (srcOut);
+
+            /* Remove wire connected outside facade in */
             sqlite3_reset (UNWIRE_NODES_GET_SRC_FACADE_EDGE_S);
             sqlite3_bind_int (UNWIRE_NODES_GET_SRC_FACADE_EDGE_S, 1, srcOut);
             if (sqlite3_step (UNWIRE_NODES_GET_SRC_FACADE_EDGE_S) == SQLITE_ROW)
@@ -3529,7 +4858,9 @@ lsddb_unwireNodes (int wireId)
         }
 
         if (destFacadeInt)  /* Right side facade out */
-        {   /* Facade output (destIn) MAY actually be a
+        {   lsddb_forgetOutputAlias (destIn);
+
+            /* Facade output (destIn) MAY actually be a
              * partition's channel */
             /* This function checks this possibilility and
              * nullifies any channel pointers */
@@ -3568,79 +4899,816 @@ lsddb_unwireNodes (int wireId)
                 return -1;
             }
 
-            /* Disconnect pointer */
-            dest->connection = NULL;
-        }
+            /* Disconnect pointer */
+            lockScene ();
+            dest->connection = NULL;
+            unlockScene ();
+        }
+
+        /* Remove the edge */
+        sqlite3_reset (UNWIRE_NODES_DELETE_EDGE_S);
+        sqlite3_bind_int (UNWIRE_NODES_DELETE_EDGE_S, 1, wireId);
+        if (sqlite3_step (UNWIRE_NODES_DELETE_EDGE_S) != SQLITE_DONE)
+        {
+            doLog (ERROR, LOG_COMP, _("Unable to remove wire in unwireNodes()."));
+            return -1;
+        }
+
+    }
+
+    return 0;
+}
+
+
+/* Interior facade-in edges are skipped; the exterior edge
+ * feeding that facade traces through to the same input */
+static const char REWIRE_NODES[] =
+    "SELECT srcOut,destIn FROM SceneNodeEdge WHERE destFacadeInt=0 AND srcFacadeInt=0";
+static sqlite3_stmt* REWIRE_NODES_S;
+
+int
+lsddb_rewireNodes ()
+{
+    sqlite3_reset (REWIRE_NODES_S);
+    while (sqlite3_step (REWIRE_NODES_S) == SQLITE_ROW)
+    {
+        int srcOut = sqlite3_column_int (REWIRE_NODES_S, 0);
+        int destIn = sqlite3_column_int (REWIRE_NODES_S, 1);
+
+        struct LSD_SceneNodeInput* dest = NULL;
+        lsddb_traceInput (&dest, destIn, NULL, NULL);
+        struct LSD_SceneNodeOutput* src = NULL;
+        lsddb_traceOutput (&src, srcOut, NULL, NULL);
+
+        if (dest && src)
+            dest->connection = src;
+        else if (dest)
+        {
+            dest->connection = NULL;
+            doLog (ERROR, LOG_COMP, _("Problem while rewiring nodes."));
+        }
+    }
+
+    return 0;
+}
+
+
+/* Runtime counterpart of rewireNodes() for when nodes are
+ * structed into a running scene. Only inputs left without a
+ * connection are traced, so existing wiring is not touched */
+static int
+lsddb_rewireDangling ()
+{
+    sqlite3_reset (REWIRE_NODES_S);
+    while (sqlite3_step (REWIRE_NODES_S) == SQLITE_ROW)
+    {
+        int srcOut = sqlite3_column_int (REWIRE_NODES_S, 0);
+        int destIn = sqlite3_column_int (REWIRE_NODES_S, 1);
+
+        struct LSD_SceneNodeInput* dest = NULL;
+        if (lsddb_traceInput (&dest, destIn, NULL, NULL) < 0 || dest->connection)
+            continue;
+
+        struct LSD_SceneNodeOutput* src = NULL;
+        if (lsddb_traceOutput (&src, srcOut, NULL, NULL) == 0)
+        {
+            lockScene ();
+            dest->connection = src;
+            unlockScene ();
+        }
+    }
+
+    return 0;
+}
+
+
+/* Online compaction of node arrays. Holes left by delIdx()
+ * are squeezed out and live elements are laid out in
+ * evaluation order (dependencies first, walking back from
+ * each patched channel) so a frame touches contiguous
+ * memory. Every pointer the core holds into these arrays is
+ * patched and the arrIdx columns are updated. Nodes whose
+ * inputs moved are cleaned and restored so plugins may
+ * re-resolve any cached input pointers. */
+
+struct LSD_CompactState
+{
+    size_t instCount;
+    size_t inCount;
+    size_t outCount;
+
+    /* Old index -> new index ((size_t)-1 for holes) */
+    size_t* instMap;
+    size_t* inMap;
+    size_t* outMap;
+
+    /* Old-index pointer targets, captured before moving */
+    size_t* inParent;
+    size_t* inConn;
+    size_t* outParent;
+
+    /* Per-inst plug lists (old indices) */
+    size_t* instFirstIn;
+    size_t* inNext;
+    size_t* instFirstOut;
+    size_t* outNext;
+
+    /* Depth-first walk: inst, and the next input to follow */
+    size_t* stackInst;
+    size_t* stackIn;
+
+    char* instVisit;
+    size_t nextInst;
+    size_t nextIn;
+    size_t nextOut;
+};
+
+static void
+lsddb_compactVisitInst (struct LSD_CompactState* cs, size_t rootIdx)
+{
+    if (rootIdx >= cs->instCount || cs->instVisit[rootIdx])
+        return;
+
+    /* Walked with an explicit stack so long chains of nodes
+     * can't overflow the call stack; each inst is pushed once */
+    size_t depth = 1;
+    cs->instVisit[rootIdx] = 1;
+    cs->stackInst[0] = rootIdx;
+    cs->stackIn[0] = cs->instFirstIn[rootIdx];
+
+    while (depth)
+    {
+        size_t instIdx = cs->stackInst[depth - 1];
+        size_t* in = &cs->stackIn[depth - 1];
+
+        /* Upstream nodes are buffered first */
+        size_t upIdx = (size_t)-1;
+        while (*in != (size_t)-1 && upIdx == (size_t)-1)
+        {
+            size_t conn = cs->inConn[*in];
+            *in = cs->inNext[*in];
+            if (conn != (size_t)-1 && cs->outParent[conn] < cs->instCount &&
+                !cs->instVisit[cs->outParent[conn]])
+                upIdx = cs->outParent[conn];
+        }
+
+        if (upIdx != (size_t)-1)
+        {
+            cs->instVisit[upIdx] = 1;
+            cs->stackInst[depth] = upIdx;
+            cs->stackIn[depth] = cs->instFirstIn[upIdx];
+            ++depth;
+            continue;
+        }
+        --depth;
+
+        cs->instMap[instIdx] = cs->nextInst++;
+        for (*in = cs->instFirstIn[instIdx]; *in != (size_t)-1;
+             *in = cs->inNext[*in])
+            cs->inMap[*in] = cs->nextIn++;
+
+        size_t out;
+        for (out = cs->instFirstOut[instIdx]; out != (size_t)-1;
+             out = cs->outNext[out])
+            cs->outMap[out] = cs->nextOut++;
+    }
+}
+
+
+static void
+lsddb_compactFreeState (struct LSD_CompactState* cs)
+{
+    free (cs->instMap);
+    free (cs->inMap);
+    free (cs->outMap);
+    free (cs->inParent);
+    free (cs->inConn);
+    free (cs->outParent);
+    free (cs->instFirstIn);
+    free (cs->inNext);
+    free (cs->instFirstOut);
+    free (cs->outNext);
+    free (cs->stackInst);
+    free (cs->stackIn);
+    free (cs->instVisit);
+}
+
+
+/* Set when this reload's node arrays came from the snapshot */
+static int snapRestored = 0;
+
+int
+lsddb_compactNodeArrays ()
+{
+    /* A restored snapshot is already in evaluation order */
+    if (snapRestored)
+    {
+        snapRestored = 0;
+        return 0;
+    }
+
+    struct LSD_ArrayHead* instArr = getArr_lsdNodeInstArr ();
+    struct LSD_ArrayHead* inArr = getArr_lsdNodeInputArr ();
+    struct LSD_ArrayHead* outArr = getArr_lsdNodeOutputArr ();
+    struct LSD_ArrayHead* chanArr = getArr_lsdChannelArr ();
+
+    struct LSD_CompactState cs;
+    memset (&cs, 0, sizeof( struct LSD_CompactState ));
+    cs.instCount = instArr->maxIdx + 1;
+    cs.inCount = inArr->maxIdx + 1;
+    cs.outCount = outArr->maxIdx + 1;
+
+    size_t instAlloc = cs.instCount ? cs.instCount : 1;
+    size_t inAlloc = cs.inCount ? cs.inCount : 1;
+    size_t outAlloc = cs.outCount ? cs.outCount : 1;
+
+    cs.instMap = malloc (sizeof( size_t ) * instAlloc);
+    cs.inMap = malloc (sizeof( size_t ) * inAlloc);
+    cs.outMap = malloc (sizeof( size_t ) * outAlloc);
+    cs.inParent = malloc (sizeof( size_t ) * inAlloc);
+    cs.inConn = malloc (sizeof( size_t ) * inAlloc);
+    cs.outParent = malloc (sizeof( size_t ) * outAlloc);
+    cs.instFirstIn = malloc (sizeof( size_t ) * instAlloc);
+    cs.inNext = malloc (sizeof( size_t ) * inAlloc);
+    cs.instFirstOut = malloc (sizeof( size_t ) * instAlloc);
+    cs.outNext = malloc (sizeof( size_t ) * outAlloc);
+    cs.stackInst = malloc (sizeof( size_t ) * instAlloc);
+    cs.stackIn = malloc (sizeof( size_t ) * instAlloc);
+    cs.instVisit = calloc (instAlloc, 1);
+
+    if (!cs.instMap || !cs.inMap || !cs.outMap || !cs.inParent ||
+        !cs.inConn || !cs.outParent || !cs.instFirstIn || !cs.inNext ||
+        !cs.instFirstOut || !cs.outNext || !cs.stackInst || !cs.stackIn ||
+        !cs.instVisit)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to allocate compaction tables."));
+        lsddb_compactFreeState (&cs);
+        return -1;
+    }
+
+    memset (cs.instMap, 0xff, sizeof( size_t ) * instAlloc);
+    memset (cs.inMap, 0xff, sizeof( size_t ) * inAlloc);
+    memset (cs.outMap, 0xff, sizeof( size_t ) * outAlloc);
+    memset (cs.inParent, 0xff, sizeof( size_t ) * inAlloc);
+    memset (cs.inConn, 0xff, sizeof( size_t ) * inAlloc);
+    memset (cs.outParent, 0xff, sizeof( size_t ) * outAlloc);
+    memset (cs.instFirstIn, 0xff, sizeof( size_t ) * instAlloc);
+    memset (cs.instFirstOut, 0xff, sizeof( size_t ) * instAlloc);
+
+    /* Capture pointer targets as old indices. Walking
+     * backwards keeps each inst's plug list in array order */
+    size_t i;
+    for (i = cs.outCount; i-- > 0; )
+    {
+        struct LSD_SceneNodeOutput* out;
+        if (pickIdx (outArr, (void**)&out, i) < 0)
+            continue;
+        if (!out->dbId)
+            continue;
+        if (ptrIdx (instArr, out->parentNode, &cs.outParent[i]) < 0)
+        {
+            /* Left unmapped, so compaction drops it */
+            doLog (WARNING, LOG_COMP, _("Output %d has no parent node; dropping it during compaction."),
+                   out->dbId);
+            lsdmap_remove (getMap_lsdNodeOutputMap (), out->dbId);
+            continue;
+        }
+        cs.outNext[i] = cs.instFirstOut[cs.outParent[i]];
+        cs.instFirstOut[cs.outParent[i]] = i;
+    }
+
+    for (i = cs.inCount; i-- > 0; )
+    {
+        struct LSD_SceneNodeInput* in;
+        if (pickIdx (inArr, (void**)&in, i) < 0)
+            continue;
+        if (!in->dbId)
+            continue;
+        if (ptrIdx (instArr, in->parentNode, &cs.inParent[i]) < 0)
+        {
+            doLog (WARNING, LOG_COMP, _("Input %d has no parent node; dropping it during compaction."),
+                   in->dbId);
+            lsdmap_remove (getMap_lsdNodeInputMap (), in->dbId);
+            continue;
+        }
+        if (in->connection)
+            ptrIdx (outArr, in->connection, &cs.inConn[i]);
+        cs.inNext[i] = cs.instFirstIn[cs.inParent[i]];
+        cs.instFirstIn[cs.inParent[i]] = i;
+    }
+
+    size_t chanCount = chanArr->maxIdx + 1;
+    size_t* chanOut = malloc (sizeof( size_t ) * ( chanCount ? chanCount : 1 ));
+    if (!chanOut)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to allocate compaction tables."));
+        lsddb_compactFreeState (&cs);
+        return -1;
+    }
+
+    /* Channels root the evaluation order */
+    for (i = 0; i < chanCount; ++i)
+    {
+        struct LSD_Channel* chan;
+        chanOut[i] = (size_t)-1;
+        if (pickIdx (chanArr, (void**)&chan, i) < 0 || !chan->output)
+            continue;
+        if (ptrIdx (outArr, chan->output, &chanOut[i]) == 0 &&
+            cs.outParent[chanOut[i]] != (size_t)-1)
+            lsddb_compactVisitInst (&cs, cs.outParent[chanOut[i]]);
+    }
+
+    /* Unpatched nodes follow in their existing order */
+    for (i = 0; i < cs.instCount; ++i)
+    {
+        struct LSD_SceneNodeInst* inst;
+        if (pickIdx (instArr, (void**)&inst, i) == 0 && inst->dbId)
+            lsddb_compactVisitInst (&cs, i);
+    }
+
+    /* Flag nodes whose inputs move (plugins cache those) */
+    int moved = 0;
+    for (i = 0; i < cs.instCount; ++i)
+    {
+        cs.instVisit[i] = 0;
+        if (cs.instMap[i] != i)
+            moved = 1;
+    }
+    for (i = 0; i < cs.inCount; ++i)
+        if (cs.inMap[i] != i)
+        {
+            moved = 1;
+            if (cs.inParent[i] != (size_t)-1)
+                cs.instVisit[cs.inParent[i]] = 1;
+        }
+    for (i = 0; i < cs.outCount; ++i)
+        if (cs.outMap[i] != i)
+            moved = 1;
+
+    if (!moved)
+    {
+        free (chanOut);
+        lsddb_compactFreeState (&cs);
+        return 0;
+    }
+
+    /* The snapshot no longer matches the layout */
+    lsddb_dropSnapshot ();
+
+    /* Elements move under the render thread's feet; relocate
+     * and patch them between frames */
+    lockScene ();
+
+    if (compactArray (instArr, cs.instMap) < 0 ||
+        compactArray (inArr, cs.inMap) < 0 ||
+        compactArray (outArr, cs.outMap) < 0)
+    {
+        unlockScene ();
+        doLog (ERROR, LOG_COMP, _("Unable to relocate node arrays."));
+        free (chanOut);
+        lsddb_compactFreeState (&cs);
+        return -1;
+    }
+
+    /* Patch pointers */
+    for (i = 0; i < cs.outCount; ++i)
+    {
+        if (cs.outMap[i] == (size_t)-1)
+            continue;
+
+        struct LSD_SceneNodeOutput* out;
+        struct LSD_SceneNodeInst* parent;
+        pickIdx (outArr, (void**)&out, cs.outMap[i]);
+        pickIdx (instArr, (void**)&parent, cs.instMap[cs.outParent[i]]);
+        out->parentNode = parent;
+        lsdmap_put (getMap_lsdNodeOutputMap (), out->dbId, out);
+    }
+
+    for (i = 0; i < cs.inCount; ++i)
+    {
+        if (cs.inMap[i] == (size_t)-1)
+            continue;
+
+        struct LSD_SceneNodeInput* in;
+        struct LSD_SceneNodeInst* parent;
+        pickIdx (inArr, (void**)&in, cs.inMap[i]);
+        pickIdx (instArr, (void**)&parent, cs.instMap[cs.inParent[i]]);
+        in->parentNode = parent;
+        lsdmap_put (getMap_lsdNodeInputMap (), in->dbId, in);
+
+        in->connection = NULL;
+        if (cs.inConn[i] != (size_t)-1 && cs.outMap[cs.inConn[i]] != (size_t)-1)
+            pickIdx (outArr, (void**)&in->connection, cs.outMap[cs.inConn[i]]);
+    }
+
+    for (i = 0; i < chanCount; ++i)
+    {
+        struct LSD_Channel* chan;
+        if (chanOut[i] == (size_t)-1 || pickIdx (chanArr, (void**)&chan, i) < 0)
+            continue;
+        chan->output = NULL;
+        if (cs.outMap[chanOut[i]] != (size_t)-1)
+            pickIdx (outArr, (void**)&chan->output, cs.outMap[chanOut[i]]);
+    }
+
+    for (i = 0; i < cs.instCount; ++i)
+    {
+        if (cs.instMap[i] == (size_t)-1)
+            continue;
 
-        /* Remove the edge */
-        sqlite3_reset (UNWIRE_NODES_DELETE_EDGE_S);
-        sqlite3_bind_int (UNWIRE_NODES_DELETE_EDGE_S, 1, wireId);
-        if (sqlite3_step (UNWIRE_NODES_DELETE_EDGE_S) != SQLITE_DONE)
+        struct LSD_SceneNodeInst* inst;
+        pickIdx (instArr, (void**)&inst, cs.instMap[i]);
+        lsdmap_put (getMap_lsdNodeInstMap (), inst->dbId, inst);
+
+        /* Plugins may hold pointers to the moved plugs */
+        if (cs.instVisit[i] && inst->nodeClass)
         {
-            doLog (ERROR, LOG_COMP, _("Unable to remove wire in unwireNodes()."));
-            return -1;
+            if (inst->nodeClass->nodeCleanFunc)
+                inst->nodeClass->nodeCleanFunc (inst, inst->data);
+            lsddb_restoreNodeInst (inst);
         }
+    }
+
+    unlockScene ();
+
+    /* Record the new array indices */
+    for (i = 0; i < cs.outCount; ++i)
+    {
+        struct LSD_SceneNodeOutput* out;
+        if (cs.outMap[i] == (size_t)-1 || cs.outMap[i] == i ||
+            pickIdx (outArr, (void**)&out, cs.outMap[i]) < 0)
+            continue;
 
+        sqlite3_reset (STRUCT_NODE_INST_OUTPUT_ARR_UPDIDX_S);
+        sqlite3_bind_int (STRUCT_NODE_INST_OUTPUT_ARR_UPDIDX_S, 1,
+                          cs.outMap[i]);
+        sqlite3_bind_int (STRUCT_NODE_INST_OUTPUT_ARR_UPDIDX_S, 2,
+                          out->dbId);
+        if (sqlite3_step (STRUCT_NODE_INST_OUTPUT_ARR_UPDIDX_S) !=
+            SQLITE_DONE)
+            doLog (ERROR, LOG_COMP, _("Unable to update output arrIdx during compaction."));
+    }
+
+    for (i = 0; i < cs.inCount; ++i)
+    {
+        struct LSD_SceneNodeInput* in;
+        if (cs.inMap[i] == (size_t)-1 || cs.inMap[i] == i ||
+            pickIdx (inArr, (void**)&in, cs.inMap[i]) < 0)
+            continue;
+
+        sqlite3_reset (STRUCT_NODE_INST_INPUT_ARR_UPDIDX_S);
+        sqlite3_bind_int (STRUCT_NODE_INST_INPUT_ARR_UPDIDX_S, 1,
+                          cs.inMap[i]);
+        sqlite3_bind_int (STRUCT_NODE_INST_INPUT_ARR_UPDIDX_S, 2, in->dbId);
+        if (sqlite3_step (STRUCT_NODE_INST_INPUT_ARR_UPDIDX_S) !=
+            SQLITE_DONE)
+            doLog (ERROR, LOG_COMP, _("Unable to update input arrIdx during compaction."));
+    }
+
+    for (i = 0; i < cs.instCount; ++i)
+    {
+        struct LSD_SceneNodeInst* inst;
+        if (cs.instMap[i] == (size_t)-1 || cs.instMap[i] == i ||
+            pickIdx (instArr, (void**)&inst, cs.instMap[i]) < 0)
+            continue;
+
+        sqlite3_reset (STRUCT_NODE_INST_ARR_UPDIDX_S);
+        sqlite3_bind_int (STRUCT_NODE_INST_ARR_UPDIDX_S, 1, cs.instMap[i]);
+        sqlite3_bind_int (STRUCT_NODE_INST_ARR_UPDIDX_S, 2, inst->dbId);
+        if (sqlite3_step (STRUCT_NODE_INST_ARR_UPDIDX_S) != SQLITE_DONE)
+            doLog (ERROR, LOG_COMP, _("Unable to update inst arrIdx during compaction."));
     }
 
+    doLog (NOTICE, LOG_COMP, _("Compacted node arrays to %d insts, %d inputs, %d outputs."),
+           (int)cs.nextInst, (int)cs.nextIn, (int)cs.nextOut);
+
+    free (chanOut);
+    lsddb_compactFreeState (&cs);
     return 0;
 }
 
 
-static const char REWIRE_NODES[] =
-    "SELECT srcFacadeInt,srcOut,destIn FROM SceneNodeEdge WHERE destFacadeInt=0";
-static sqlite3_stmt* REWIRE_NODES_S;
+/* Runtime snapshot.
+ * Once a reload has built and compacted the node arrays, their
+ * layout is captured in relocatable form (array indices in place
+ * of pointers) and keyed by SceneStructVersion. A later reload
+ * finding the version unchanged lays the arrays out again from
+ * the snapshot instead of querying every node, input and output;
+ * only class resolution (once per class) and the plugins' restore
+ * functions remain. */
+
+struct LSD_SnapInst
+{
+    int dbId;
+    int classId;
+};
+
+struct LSD_SnapInput
+{
+    int dbId;
+    int typeId;
+    size_t parent;
+    size_t conn; /* (size_t)-1 if unconnected */
+};
+
+struct LSD_SnapOutput
+{
+    int dbId;
+    int typeId;
+    size_t parent;
+    int bfFuncIdx;
+    int bpFuncIdx;
+};
+
+struct LSD_Snapshot
+{
+    int valid;
+    int version;
+    int gen;
+    size_t instCount;
+    size_t inCount;
+    size_t outCount;
+    struct LSD_SnapInst* insts;
+    struct LSD_SnapInput* ins;
+    struct LSD_SnapOutput* outs;
+};
+
+static struct LSD_Snapshot snap;
+
+static const char SNAP_VERSION[] =
+    "SELECT ver FROM SceneStructVersion LIMIT 1";
+static sqlite3_stmt* SNAP_VERSION_S;
+
+static const char SNAP_OUT_FUNCS[] =
+    "SELECT id,bfFuncIdx,bpFuncIdx FROM SceneNodeInstOutput WHERE facadeBool=0";
+static sqlite3_stmt* SNAP_OUT_FUNCS_S;
+
+static const char SNAP_SET_GEN[] =
+    "UPDATE SceneGeneration SET gen=?1";
+static sqlite3_stmt* SNAP_SET_GEN_S;
+
+static int
+lsddb_structVersion ()
+{
+    sqlite3_reset (SNAP_VERSION_S);
+    if (sqlite3_step (SNAP_VERSION_S) == SQLITE_ROW)
+        return sqlite3_column_int (SNAP_VERSION_S, 0);
+    return -1;
+}
+
+
+void
+lsddb_dropSnapshot ()
+{
+    free (snap.insts);
+    free (snap.ins);
+    free (snap.outs);
+    memset (&snap, 0, sizeof( struct LSD_Snapshot ));
+}
 
-static const char REWIRE_NODES_DEST[] =
-    "SELECT srcFacadeInt,srcOut FROM SceneNodeEdge WHERE destIn=?1";
-static sqlite3_stmt* REWIRE_NODES_DEST_S;
 
 int
-lsddb_rewireNodes ()
+lsddb_takeSnapshot ()
 {
-    sqlite3_reset (REWIRE_NODES_S);
-    while (sqlite3_step (REWIRE_NODES_S) == SQLITE_ROW)
+    int version = lsddb_structVersion ();
+    if (snap.valid && snap.version == version && snap.gen == arrGen)
+        return 0;
+
+    lsddb_dropSnapshot ();
+    if (version < 0)
+        return -1;
+
+    struct LSD_ArrayHead* instArr = getArr_lsdNodeInstArr ();
+    struct LSD_ArrayHead* inArr = getArr_lsdNodeInputArr ();
+    struct LSD_ArrayHead* outArr = getArr_lsdNodeOutputArr ();
+
+    size_t instCap = instArr->maxIdx + 1;
+    size_t inCap = inArr->maxIdx + 1;
+    size_t outCap = outArr->maxIdx + 1;
+
+    snap.insts = malloc (sizeof( struct LSD_SnapInst ) * ( instCap ? instCap : 1 ));
+    snap.ins = malloc (sizeof( struct LSD_SnapInput ) * ( inCap ? inCap : 1 ));
+    snap.outs = malloc (sizeof( struct LSD_SnapOutput ) * ( outCap ? outCap : 1 ));
+    if (!snap.insts || !snap.ins || !snap.outs)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to allocate runtime snapshot."));
+        lsddb_dropSnapshot ();
+        return -1;
+    }
+
+    /* Only dense arrays are captured, so a restored element
+     * lands on the index already recorded in the DB */
+    size_t i;
+    for (i = 0; i < instCap; ++i)
+    {
+        struct LSD_SceneNodeInst* inst;
+        if (pickIdx (instArr, (void**)&inst, i) < 0 || !inst->dbId)
+            continue;
+        if (i != snap.instCount || !inst->nodeClass)
+            goto sparse;
+        snap.insts[i].dbId = inst->dbId;
+        snap.insts[i].classId = inst->nodeClass->dbId;
+        ++snap.instCount;
+    }
+
+    struct LSD_IdMap outById;
+    if (lsdmap_init (&outById, outCap) < 0)
     {
-        int destIn = sqlite3_column_int (REWIRE_NODES_S, 2);
-        int srcOut = sqlite3_column_int (REWIRE_NODES_S, 1);
-        int srcFacadeInt = sqlite3_column_int (REWIRE_NODES_S, 0);
+        lsddb_dropSnapshot ();
+        return -1;
+    }
 
-        while (srcFacadeInt)
+    for (i = 0; i < outCap; ++i)
+    {
+        struct LSD_SceneNodeOutput* out;
+        if (pickIdx (outArr, (void**)&out, i) < 0 || !out->dbId)
+            continue;
+        if (i != snap.outCount ||
+            ptrIdx (instArr, out->parentNode, &snap.outs[i].parent) < 0)
         {
-            sqlite3_reset (REWIRE_NODES_DEST_S);
-            sqlite3_bind_int (REWIRE_NODES_DEST_S, 1, srcOut);
-            if (sqlite3_step (REWIRE_NODES_DEST_S) == SQLITE_ROW)
-            {
-                srcOut = sqlite3_column_int (REWIRE_NODES_DEST_S, 1);
-                srcFacadeInt = sqlite3_column_int (REWIRE_NODES_DEST_S, 0);
-            }
-            else  /* No external facade input connection */
-            {
-                srcOut = -2;
-                break;
-            }
+            lsdmap_clear (&outById);
+            goto sparse;
         }
+        snap.outs[i].dbId = out->dbId;
+        snap.outs[i].typeId = out->typeId;
+        snap.outs[i].bfFuncIdx = -1;
+        snap.outs[i].bpFuncIdx = -1;
+        lsdmap_put (&outById, out->dbId, &snap.outs[i]);
+        ++snap.outCount;
+    }
+
+    /* Buffer function indices live only in the DB */
+    sqlite3_reset (SNAP_OUT_FUNCS_S);
+    while (sqlite3_step (SNAP_OUT_FUNCS_S) == SQLITE_ROW)
+    {
+        struct LSD_SnapOutput* so = lsdmap_get (&outById,
+                                                sqlite3_column_int (SNAP_OUT_FUNCS_S, 0));
+        if (!so)
+            continue;
+        so->bfFuncIdx = sqlite3_column_int (SNAP_OUT_FUNCS_S, 1);
+        so->bpFuncIdx = sqlite3_column_int (SNAP_OUT_FUNCS_S, 2);
+    }
+    lsdmap_clear (&outById);
+
+    for (i = 0; i < snap.outCount; ++i)
+        if (snap.outs[i].bfFuncIdx < 0 || snap.outs[i].bpFuncIdx < 0)
+            goto sparse;
+
+    for (i = 0; i < inCap; ++i)
+    {
+        struct LSD_SceneNodeInput* in;
+        if (pickIdx (inArr, (void**)&in, i) < 0 || !in->dbId)
+            continue;
+        if (i != snap.inCount ||
+            ptrIdx (instArr, in->parentNode, &snap.ins[i].parent) < 0)
+            goto sparse;
+        snap.ins[i].dbId = in->dbId;
+        snap.ins[i].typeId = in->typeId;
+        snap.ins[i].conn = (size_t)-1;
+        if (in->connection)
+            ptrIdx (outArr, in->connection, &snap.ins[i].conn);
+        ++snap.inCount;
+    }
+
+    snap.valid = 1;
+    snap.version = version;
+    snap.gen = arrGen;
+    return 0;
 
-        if (srcOut >= 0)
-        {
+sparse:
+    doLog (NOTICE, LOG_COMP, _("Node arrays are not dense; runtime snapshot skipped."));
+    lsddb_dropSnapshot ();
+    return -1;
+}
+
+
+static int
+lsddb_restoreSnapshot ()
+{
+    snapRestored = 0;
+    if (!snap.valid || snap.version != lsddb_structVersion ())
+        return -1;
 
-            struct LSD_SceneNodeInput* dest = NULL;
-            lsddb_traceInput (&dest, destIn, NULL, NULL);
-            struct LSD_SceneNodeOutput* src = NULL;
-            lsddb_traceOutput (&src, srcOut, NULL, NULL);
+    /* Resolve every class before touching the arrays so a missing
+     * or disabled plugin falls back to full construction */
+    struct LSD_SceneNodeClass** instClass =
+        malloc (sizeof( struct LSD_SceneNodeClass* ) * ( snap.instCount ? snap.instCount : 1 ));
+    struct LSD_IdMap classById;
+    if (!instClass || lsdmap_init (&classById, 16) < 0)
+    {
+        free (instClass);
+        return -1;
+    }
 
-            if (dest && src)
-                dest->connection = src;
-            else if (dest)
+    size_t i;
+    for (i = 0; i < snap.instCount; ++i)
+    {
+        int classId = snap.insts[i].classId;
+        struct LSD_SceneNodeClass* nc = lsdmap_get (&classById, classId);
+        if (!nc)
+        {
+            if (!lsddb_checkClassEnabled (classId) ||
+                lsddb_resolveClassFromId (&nc, classId) < 0)
             {
-                dest->connection = NULL;
-                doLog (ERROR, LOG_COMP, _("Problem while rewiring nodes."));
+                doLog (NOTICE, LOG_COMP, _("Class %d unavailable; runtime snapshot not used."),
+                       classId);
+                lsdmap_clear (&classById);
+                free (instClass);
+                return -1;
             }
+            lsdmap_put (&classById, classId, nc);
+        }
+        instClass[i] = nc;
+    }
+    lsdmap_clear (&classById);
+
+    /* The layout matches the indices already in the DB; reinstate
+     * their generation rather than rewriting every row */
+    sqlite3_reset (SNAP_SET_GEN_S);
+    sqlite3_bind_int (SNAP_SET_GEN_S, 1, snap.gen);
+    if (sqlite3_step (SNAP_SET_GEN_S) != SQLITE_DONE)
+    {
+        free (instClass);
+        return -1;
+    }
+    arrGen = snap.gen;
+
+    struct LSD_ArrayHead* instArr = getArr_lsdNodeInstArr ();
+    struct LSD_ArrayHead* inArr = getArr_lsdNodeInputArr ();
+    struct LSD_ArrayHead* outArr = getArr_lsdNodeOutputArr ();
+
+    for (i = 0; i < snap.instCount; ++i)
+    {
+        size_t idx;
+        struct LSD_SceneNodeInst* inst;
+        if (insertElem (instArr, &idx, (void**)&inst) < 0)
+            goto fail;
+        inst->dbId = snap.insts[i].dbId;
+        inst->nodeClass = instClass[i];
+        lsdmap_put (getMap_lsdNodeInstMap (), inst->dbId, inst);
 
+        if (inst->nodeClass->instDataSize > 0)
+        {
+            inst->data = malloc (inst->nodeClass->instDataSize);
+            if (!inst->data)
+                goto fail;
         }
     }
 
+    for (i = 0; i < snap.outCount; ++i)
+    {
+        size_t idx;
+        struct LSD_SceneNodeOutput* out;
+        struct LSD_SceneNodeInst* parent;
+        if (insertElem (outArr, &idx, (void**)&out) < 0 ||
+            pickIdx (instArr, (void**)&parent, snap.outs[i].parent) < 0)
+            goto fail;
+        out->dbId = snap.outs[i].dbId;
+        out->typeId = snap.outs[i].typeId;
+        out->parentNode = parent;
+        out->bufferFunc = parent->nodeClass->bfFuncTbl[snap.outs[i].bfFuncIdx];
+        out->bufferPtr = parent->nodeClass->bpFuncTbl[snap.outs[i].bpFuncIdx];
+        lsdmap_put (getMap_lsdNodeOutputMap (), out->dbId, out);
+    }
+
+    for (i = 0; i < snap.inCount; ++i)
+    {
+        size_t idx;
+        struct LSD_SceneNodeInput* in;
+        struct LSD_SceneNodeInst* parent;
+        if (insertElem (inArr, &idx, (void**)&in) < 0 ||
+            pickIdx (instArr, (void**)&parent, snap.ins[i].parent) < 0)
+            goto fail;
+        in->dbId = snap.ins[i].dbId;
+        in->typeId = snap.ins[i].typeId;
+        in->parentNode = parent;
+        in->connection = NULL;
+        if (snap.ins[i].conn != (size_t)-1)
+            pickIdx (outArr, (void**)&in->connection, snap.ins[i].conn);
+        lsdmap_put (getMap_lsdNodeInputMap (), in->dbId, in);
+    }
+
+    free (instClass);
+
+    /* Plugins rebuild their instance data last, with every plug
+     * and connection in place */
+    for (i = 0; i < snap.instCount; ++i)
+    {
+        struct LSD_SceneNodeInst* inst;
+        pickIdx (instArr, (void**)&inst, i);
+        lsddb_restoreNodeInst (inst);
+    }
+
+    doLog (NOTICE, LOG_COMP, _("Restored %d insts, %d inputs, %d outputs from runtime snapshot."),
+           (int)snap.instCount, (int)snap.inCount, (int)snap.outCount);
+
+    snapRestored = 1;
     return 0;
+
+fail:
+    doLog (ERROR, LOG_COMP, _("Unable to lay out node arrays from runtime snapshot."));
+    free (instClass);
+    return -2;
 }
 
 
@@ -3649,7 +5717,7 @@ static const char JSON_CLASS_LIBRARY[] =
 static sqlite3_stmt* JSON_CLASS_LIBRARY_S;
 
 int
-lsddb_jsonClassLibrary (cJSON* target)
+lsddb_jsonClassLibrary (struct LSD_JsonWriter* target)
 {
     if (!target)
     {
@@ -3657,7 +5725,7 @@ lsddb_jsonClassLibrary (cJSON* target)
         return -1;
     }
 
-    cJSON* classArr = cJSON_CreateArray ();
+    lsdjson_beginArray (target, "classes");
 
     sqlite3_reset (JSON_CLASS_LIBRARY_S);
 
@@ -3670,18 +5738,14 @@ lsddb_jsonClassLibrary (cJSON* target)
 
         if (lsddb_checkClassEnabled (classId))
         {
-
-            cJSON* classObj = cJSON_CreateObject ();
-
-            cJSON_AddNumberToObject (classObj, "classId", classId);
-            cJSON_AddStringToObject (classObj, "className", className);
-
-            cJSON_AddItemToArray (classArr, classObj);
-
+            lsdjson_beginObject (target, NULL);
+            lsdjson_int (target, "classId", classId);
+            lsdjson_string (target, "className", className);
+            lsdjson_endObject (target);
         }
     }
 
-    cJSON_AddItemToObject (target, "classes", classArr);
+    lsdjson_endArray (target);
 
     return 0;
 }
@@ -3692,12 +5756,12 @@ static const char JSON_GET_FACADE_OUTS[] =
 static sqlite3_stmt* JSON_GET_FACADE_OUTS_S;
 
 int
-lsddb_jsonGetFacadeOuts (int psId, cJSON* target)
+lsddb_jsonGetFacadeOuts (int psId, struct LSD_JsonWriter* target)
 {
     if (!target)
         return -1;
 
-    cJSON* outArr = cJSON_CreateArray ();
+    lsdjson_beginArray (target, "facadeOuts");
 
     sqlite3_reset (JSON_GET_FACADE_OUTS_S);
     sqlite3_bind_int (JSON_GET_FACADE_OUTS_S, 1, psId);
@@ -3708,13 +5772,13 @@ lsddb_jsonGetFacadeOuts (int psId, cJSON* target)
             JSON_GET_FACADE_OUTS_S,
             1);
 
-        cJSON* outObj = cJSON_CreateObject ();
-        cJSON_AddNumberToObject (outObj, "outId", outId);
-        cJSON_AddStringToObject (outObj, "outName", (const char*)outName);
-        cJSON_AddItemToArray (outArr, outObj);
+        lsdjson_beginObject (target, NULL);
+        lsdjson_int (target, "outId", outId);
+        lsdjson_string (target, "outName", (const char*)outName);
+        lsdjson_endObject (target);
     }
 
-    cJSON_AddItemToObject (target, "facadeOuts", outArr);
+    lsdjson_endArray (target);
 
     return 0;
 }
@@ -3725,12 +5789,12 @@ static const char JSON_GET_FACADE_INS[] =
 static sqlite3_stmt* JSON_GET_FACADE_INS_S;
 
 int
-lsddb_jsonGetFacadeIns (int psId, cJSON* target)
+lsddb_jsonGetFacadeIns (int psId, struct LSD_JsonWriter* target)
 {
     if (!target)
         return -1;
 
-    cJSON* inArr = cJSON_CreateArray ();
+    lsdjson_beginArray (target, "facadeIns");
 
     sqlite3_reset (JSON_GET_FACADE_INS_S);
     sqlite3_bind_int (JSON_GET_FACADE_INS_S, 1, psId);
@@ -3741,13 +5805,13 @@ lsddb_jsonGetFacadeIns (int psId, cJSON* target)
             JSON_GET_FACADE_INS_S,
             1);
 
-        cJSON* inObj = cJSON_CreateObject ();
-        cJSON_AddNumberToObject (inObj, "inId", inId);
-        cJSON_AddStringToObject (inObj, "inName", (const char*)inName);
-        cJSON_AddItemToArray (inArr, inObj);
+        lsdjson_beginObject (target, NULL);
+        lsdjson_int (target, "inId", inId);
+        lsdjson_string (target, "inName", (const char*)inName);
+        lsdjson_endObject (target);
     }
 
-    cJSON_AddItemToObject (target, "facadeIns", inArr);
+    lsdjson_endArray (target);
 
     return 0;
 }
@@ -3758,7 +5822,7 @@ static const char JSON_PARTS[] =
 static sqlite3_stmt* JSON_PARTS_S;
 
 int
-lsddb_jsonParts (cJSON* target)
+lsddb_jsonParts (struct LSD_JsonWriter* target)
 {
     if (!target)
     {
@@ -3766,14 +5830,12 @@ lsddb_jsonParts (cJSON* target)
         return -1;
     }
 
-    cJSON* partArr = cJSON_CreateArray ();
+    lsdjson_beginArray (target, "partitions");
 
     sqlite3_reset (JSON_PARTS_S);
 
     while (sqlite3_step (JSON_PARTS_S) == SQLITE_ROW)
     {
-        cJSON* partObj = cJSON_CreateObject ();
-
         int partId = sqlite3_column_int (JSON_PARTS_S, 0);
         const char* partName = (const char*)sqlite3_column_text (JSON_PARTS_S,
                                                                  1);
@@ -3781,19 +5843,20 @@ lsddb_jsonParts (cJSON* target)
         const char* imageUrl = (const char*)sqlite3_column_text (JSON_PARTS_S,
                                                                  3);
 
-        cJSON_AddNumberToObject (partObj, "partId", partId);
-        cJSON_AddStringToObject (partObj, "partName", partName);
-        cJSON_AddNumberToObject (partObj, "psId", psId);
+        lsdjson_beginObject (target, NULL);
+        lsdjson_int (target, "partId", partId);
+        lsdjson_string (target, "partName", partName);
+        lsdjson_int (target, "psId", psId);
         if (imageUrl)
-            cJSON_AddStringToObject (partObj, "imageUrl", imageUrl);
+            lsdjson_string (target, "imageUrl", imageUrl);
 
         /* Add partition facade outs */
-        /* lsddb_jsonGetFacadeOuts(psId,partObj); */
+        /* lsddb_jsonGetFacadeOuts(psId,target); */
 
-        cJSON_AddItemToArray (partArr, partObj);
+        lsdjson_endObject (target);
     }
 
-    cJSON_AddItemToObject (target, "partitions", partArr);
+    lsdjson_endArray (target);
 
     return 0;
 }
@@ -3809,9 +5872,9 @@ static sqlite3_stmt* JSON_INSERT_CLASS_OBJECT_S;
  * resolve its */
 /* various class members implemented in static files */
 int
-lsddb_jsonInsertClassObject (cJSON* target, int classId)
+lsddb_jsonInsertClassObject (struct LSD_JsonWriter* target, int classId)
 {
-    if (!target || target->type != cJSON_Object)
+    if (!target)
         return -1;
 
     sqlite3_reset (JSON_INSERT_CLASS_OBJECT_S);
@@ -3822,12 +5885,11 @@ lsddb_jsonInsertClassObject (cJSON* target, int classId)
         int pluginId = sqlite3_column_int (JSON_INSERT_CLASS_OBJECT_S, 0);
         int classIdx = sqlite3_column_int (JSON_INSERT_CLASS_OBJECT_S, 1);
 
-        cJSON* classObj = cJSON_CreateObject ();
-        cJSON_AddNumberToObject (classObj, "classId", classId);
-        cJSON_AddNumberToObject (classObj, "pluginId", pluginId);
-        cJSON_AddNumberToObject (classObj, "classIdx", classIdx);
-
-        cJSON_AddItemToObject (target, "classObj", classObj);
+        lsdjson_beginObject (target, "classObj");
+        lsdjson_int (target, "classId", classId);
+        lsdjson_int (target, "pluginId", pluginId);
+        lsdjson_int (target, "classIdx", classIdx);
+        lsdjson_endObject (target);
 
         return 0;
     }
@@ -3856,93 +5918,77 @@ static const char JSON_NODES_FACADES_OUTS[] =
     "SELECT id,typeId,name FROM SceneNodeInstOutput WHERE instId=?1 AND facadeBool=1";
 static sqlite3_stmt* JSON_NODES_FACADES_OUTS_S;
 
+/* Writes the rows of an ins/outs statement already bound to an
+ * inst as an array of {idKey,typeId,name} */
+static void
+jsonNodePlugs (struct LSD_JsonWriter* resp, const char* arrKey,
+               const char* idKey, sqlite3_stmt* stmt)
+{
+    lsdjson_beginArray (resp, arrKey);
+    while (sqlite3_step (stmt) == SQLITE_ROW)
+    {
+        lsdjson_beginObject (resp, NULL);
+        lsdjson_int (resp, idKey, sqlite3_column_int (stmt, 0));
+        lsdjson_int (resp, "typeId", sqlite3_column_int (stmt, 1));
+        lsdjson_string (resp, "name",
+                        (const char*)sqlite3_column_text (stmt, 2));
+        lsdjson_endObject (resp);
+    }
+    lsdjson_endArray (resp);
+}
+
+
+/* Writes a colour object from three consecutive columns */
+static void
+jsonColour (struct LSD_JsonWriter* resp, sqlite3_stmt* stmt, int firstCol)
+{
+    lsdjson_beginObject (resp, "colour");
+    lsdjson_number (resp, "r", sqlite3_column_double (stmt, firstCol));
+    lsdjson_number (resp, "g", sqlite3_column_double (stmt, firstCol + 1));
+    lsdjson_number (resp, "b", sqlite3_column_double (stmt, firstCol + 2));
+    lsdjson_endObject (resp);
+}
+
+
 int
-lsddb_jsonNodes (int patchSpaceId, cJSON* resp)
+lsddb_jsonNodes (int patchSpaceId, struct LSD_JsonWriter* resp)
 {
     sqlite3_reset (JSON_NODES_S);
     sqlite3_bind_int (JSON_NODES_S, 1, patchSpaceId);
 
-    cJSON* nodeArr = cJSON_CreateArray ();
+    lsdjson_beginArray (resp, "nodes");
 
     while (sqlite3_step (JSON_NODES_S) == SQLITE_ROW)
     {
-        cJSON* nodeObj = cJSON_CreateObject ();
-
         int nodeId = sqlite3_column_int (JSON_NODES_S, 0);
         int posX = sqlite3_column_int (JSON_NODES_S, 1);
         int posY = sqlite3_column_int (JSON_NODES_S, 2);
         const unsigned char* name = sqlite3_column_text (JSON_NODES_S, 4);
         int classId = sqlite3_column_int (JSON_NODES_S, 3);
 
-        cJSON_AddNumberToObject (nodeObj, "nodeId", nodeId);
-        cJSON_AddNumberToObject (nodeObj, "x", posX);
-        cJSON_AddNumberToObject (nodeObj, "y", posY);
-        cJSON_AddStringToObject (nodeObj, "name", (const char*)name);
+        lsdjson_beginObject (resp, NULL);
+        lsdjson_int (resp, "nodeId", nodeId);
+        lsdjson_int (resp, "x", posX);
+        lsdjson_int (resp, "y", posY);
+        lsdjson_string (resp, "name", (const char*)name);
 
         /* Colour Object */
-        cJSON* colourObj = cJSON_CreateObject ();
-        cJSON_AddNumberToObject (colourObj, "r",
-                                 sqlite3_column_double (JSON_NODES_S, 5));
-        cJSON_AddNumberToObject (colourObj, "g",
-                                 sqlite3_column_double (JSON_NODES_S, 6));
-        cJSON_AddNumberToObject (colourObj, "b",
-                                 sqlite3_column_double (JSON_NODES_S, 7));
-        cJSON_AddItemToObject (nodeObj, "colour", colourObj);
+        jsonColour (resp, JSON_NODES_S, 5);
 
-        if (lsddb_checkClassEnabled (classId))
-            cJSON_AddTrueToObject (nodeObj, "enabled");
-        else
-            cJSON_AddFalseToObject (nodeObj, "enabled");
-        lsddb_jsonInsertClassObject (nodeObj, classId);
+        lsdjson_bool (resp, "enabled", lsddb_checkClassEnabled (classId));
+        lsddb_jsonInsertClassObject (resp, classId);
 
         /* Get node's ins */
         sqlite3_reset (JSON_NODES_INS_S);
         sqlite3_bind_int (JSON_NODES_INS_S, 1, nodeId);
-
-        cJSON* nodeInArr = cJSON_CreateArray ();
-        while (sqlite3_step (JSON_NODES_INS_S) == SQLITE_ROW)
-        {
-            cJSON* inObj = cJSON_CreateObject ();
-
-            int inId = sqlite3_column_int (JSON_NODES_INS_S, 0);
-            int typeId = sqlite3_column_int (JSON_NODES_INS_S, 1);
-            const unsigned char* name = sqlite3_column_text (JSON_NODES_INS_S,
-                                                             2);
-
-            cJSON_AddNumberToObject (inObj, "inId", inId);
-            cJSON_AddNumberToObject (inObj, "typeId", typeId);
-            cJSON_AddStringToObject (inObj, "name", (const char*)name);
-
-            cJSON_AddItemToArray (nodeInArr, inObj);
-        }
-
-        cJSON_AddItemToObject (nodeObj, "nodeIns", nodeInArr);
+        jsonNodePlugs (resp, "nodeIns", "inId", JSON_NODES_INS_S);
 
         /* Get node's outs */
         sqlite3_reset (JSON_NODES_OUTS_S);
         sqlite3_bind_int (JSON_NODES_OUTS_S, 1, nodeId);
+        jsonNodePlugs (resp, "nodeOuts", "outId", JSON_NODES_OUTS_S);
 
-        cJSON* nodeOutArr = cJSON_CreateArray ();
-        while (sqlite3_step (JSON_NODES_OUTS_S) == SQLITE_ROW)
-        {
-            cJSON* outObj = cJSON_CreateObject ();
-
-            int outId = sqlite3_column_int (JSON_NODES_OUTS_S, 0);
-            int typeId = sqlite3_column_int (JSON_NODES_OUTS_S, 1);
-            const unsigned char* name = sqlite3_column_text (JSON_NODES_OUTS_S,
-                                                             2);
-
-            cJSON_AddNumberToObject (outObj, "outId", outId);
-            cJSON_AddNumberToObject (outObj, "typeId", typeId);
-            cJSON_AddStringToObject (outObj, "name", (const char*)name);
-
-            cJSON_AddItemToArray (nodeOutArr, outObj);
-        }
-
-        cJSON_AddItemToObject (nodeObj, "nodeOuts", nodeOutArr);
-
-        /* Add node to array */
-        cJSON_AddItemToArray (nodeArr, nodeObj);
+        lsdjson_endObject (resp);
     }
 
     /* Facades */
@@ -3952,83 +5998,35 @@ lsddb_jsonNodes (int patchSpaceId, cJSON* resp)
 
     while (sqlite3_step (JSON_NODES_FACADES_S) == SQLITE_ROW)
     {
-        cJSON* nodeObj = cJSON_CreateObject ();
-
         int nodeId = sqlite3_column_int (JSON_NODES_FACADES_S, 0);
         const unsigned char* psName = sqlite3_column_text (JSON_NODES_FACADES_S,
                                                            3);
         int posX = sqlite3_column_int (JSON_NODES_FACADES_S, 1);
         int posY = sqlite3_column_int (JSON_NODES_FACADES_S, 2);
 
-        cJSON_AddNumberToObject (nodeObj, "facadeId", nodeId);
-        cJSON_AddStringToObject (nodeObj, "name", (const char*)psName);
-        cJSON_AddNumberToObject (nodeObj, "x", posX);
-        cJSON_AddNumberToObject (nodeObj, "y", posY);
+        lsdjson_beginObject (resp, NULL);
+        lsdjson_int (resp, "facadeId", nodeId);
+        lsdjson_string (resp, "name", (const char*)psName);
+        lsdjson_int (resp, "x", posX);
+        lsdjson_int (resp, "y", posY);
 
         /* Colour Object */
-        cJSON* colourObj = cJSON_CreateObject ();
-        cJSON_AddNumberToObject (colourObj, "r",
-                                 sqlite3_column_double (JSON_NODES_FACADES_S, 4));
-        cJSON_AddNumberToObject (colourObj, "g",
-                                 sqlite3_column_double (JSON_NODES_FACADES_S, 5));
-        cJSON_AddNumberToObject (colourObj, "b",
-                                 sqlite3_column_double (JSON_NODES_FACADES_S, 6));
-        cJSON_AddItemToObject (nodeObj, "colour", colourObj);
+        jsonColour (resp, JSON_NODES_FACADES_S, 4);
 
         /* Get facade's ins */
         sqlite3_reset (JSON_NODES_FACADES_INS_S);
         sqlite3_bind_int (JSON_NODES_FACADES_INS_S, 1, nodeId);
-
-        cJSON* nodeInArr = cJSON_CreateArray ();
-        while (sqlite3_step (JSON_NODES_FACADES_INS_S) == SQLITE_ROW)
-        {
-            cJSON* inObj = cJSON_CreateObject ();
-
-            int inId = sqlite3_column_int (JSON_NODES_FACADES_INS_S, 0);
-            int typeId = sqlite3_column_int (JSON_NODES_FACADES_INS_S, 1);
-            const unsigned char* name = sqlite3_column_text (
-                JSON_NODES_FACADES_INS_S,
-                2);
-
-            cJSON_AddNumberToObject (inObj, "inId", inId);
-            cJSON_AddNumberToObject (inObj, "typeId", typeId);
-            cJSON_AddStringToObject (inObj, "name", (const char*)name);
-
-            cJSON_AddItemToArray (nodeInArr, inObj);
-        }
-
-        cJSON_AddItemToObject (nodeObj, "facadeIns", nodeInArr);
+        jsonNodePlugs (resp, "facadeIns", "inId", JSON_NODES_FACADES_INS_S);
 
         /* Get facade's outs */
         sqlite3_reset (JSON_NODES_FACADES_OUTS_S);
         sqlite3_bind_int (JSON_NODES_FACADES_OUTS_S, 1, nodeId);
+        jsonNodePlugs (resp, "facadeOuts", "outId", JSON_NODES_FACADES_OUTS_S);
 
-        cJSON* nodeOutArr = cJSON_CreateArray ();
-        while (sqlite3_step (JSON_NODES_FACADES_OUTS_S) == SQLITE_ROW)
-        {
-            cJSON* outObj = cJSON_CreateObject ();
-
-            int outId = sqlite3_column_int (JSON_NODES_FACADES_OUTS_S, 0);
-            int typeId = sqlite3_column_int (JSON_NODES_FACADES_OUTS_S, 1);
-            const unsigned char* name = sqlite3_column_text (
-                JSON_NODES_FACADES_OUTS_S,
-                2);
-
-            cJSON_AddNumberToObject (outObj, "outId", outId);
-            cJSON_AddNumberToObject (outObj, "typeId", typeId);
-            cJSON_AddStringToObject (outObj, "name", (const char*)name);
-
-            cJSON_AddItemToArray (nodeOutArr, outObj);
-        }
-
-        cJSON_AddItemToObject (nodeObj, "facadeOuts", nodeOutArr);
-
-        /* Add node to array */
-        cJSON_AddItemToArray (nodeArr, nodeObj);
+        lsdjson_endObject (resp);
     }
 
-    /* cJSON_AddNumberToObject(resp,"psId",patchSpaceId); */
-    cJSON_AddItemToObject (resp, "nodes", nodeArr);
+    lsdjson_endArray (resp);
 
     return 0;
 }
@@ -4040,23 +6038,23 @@ static const char JSON_GET_FACADE[] =
 static sqlite3_stmt* JSON_GET_FACADE_S;
 
 int
-lsddb_jsonFacade (int psId, cJSON* resp)
+lsddb_jsonFacade (int psId, struct LSD_JsonWriter* resp)
 {
     sqlite3_reset (JSON_GET_FACADE_S);
     sqlite3_bind_int (JSON_GET_FACADE_S, 1, psId);
     if (sqlite3_step (JSON_GET_FACADE_S) == SQLITE_ROW)
     {
-        cJSON* facObj = cJSON_CreateObject ();
-        cJSON_AddNumberToObject (facObj, "psId", psId);
+        lsdjson_beginObject (resp, "facade");
+        lsdjson_int (resp, "psId", psId);
 
         const unsigned char* name = sqlite3_column_text (JSON_GET_FACADE_S, 0);
-        cJSON_AddStringToObject (facObj, "name", (const char*)name);
+        lsdjson_string (resp, "name", (const char*)name);
 
-        lsddb_jsonGetFacadeIns (psId, facObj);
+        lsddb_jsonGetFacadeIns (psId, resp);
 
-        lsddb_jsonGetFacadeOuts (psId, facObj);
+        lsddb_jsonGetFacadeOuts (psId, resp);
 
-        cJSON_AddItemToObject (resp, "facade", facObj);
+        lsdjson_endObject (resp);
     }
     else
         return -1;
@@ -4070,34 +6068,31 @@ static const char JSON_WIRES[] =
 static sqlite3_stmt* JSON_WIRES_S;
 
 int
-lsddb_jsonWires (int patchSpaceId, cJSON* resp)
+lsddb_jsonWires (int patchSpaceId, struct LSD_JsonWriter* resp)
 {
     sqlite3_reset (JSON_WIRES_S);
     sqlite3_bind_int (JSON_WIRES_S, 1, patchSpaceId);
 
-    cJSON* wireArr = cJSON_CreateArray ();
+    lsdjson_beginArray (resp, "wireArr");
 
     while (sqlite3_step (JSON_WIRES_S) == SQLITE_ROW)
     {
-        cJSON* wireObj = cJSON_CreateObject ();
-
         int wireId = sqlite3_column_int (JSON_WIRES_S, 0);
         int wireLeft = sqlite3_column_int (JSON_WIRES_S, 1);
         int wireRight = sqlite3_column_int (JSON_WIRES_S, 2);
         int wireLeftInt = sqlite3_column_int (JSON_WIRES_S, 3);
         int wireRightInt = sqlite3_column_int (JSON_WIRES_S, 4);
 
-        cJSON_AddNumberToObject (wireObj, "wireId", wireId);
-        cJSON_AddNumberToObject (wireObj, "wireLeftInt", wireLeftInt);
-        cJSON_AddNumberToObject (wireObj, "wireLeft", wireLeft);
-        cJSON_AddNumberToObject (wireObj, "wireRightInt", wireRightInt);
-        cJSON_AddNumberToObject (wireObj, "wireRight", wireRight);
-
-        cJSON_AddItemToArray (wireArr, wireObj);
+        lsdjson_beginObject (resp, NULL);
+        lsdjson_int (resp, "wireId", wireId);
+        lsdjson_int (resp, "wireLeftInt", wireLeftInt);
+        lsdjson_int (resp, "wireLeft", wireLeft);
+        lsdjson_int (resp, "wireRightInt", wireRightInt);
+        lsdjson_int (resp, "wireRight", wireRight);
+        lsdjson_endObject (resp);
     }
 
-    /* cJSON_AddNumberToObject(resp,"psId",patchSpaceId); */
-    cJSON_AddItemToObject (resp, "wireArr", wireArr);
+    lsdjson_endArray (resp);
 
     return 0;
 }
@@ -4108,7 +6103,7 @@ static const char JSON_PATCH_SPACE[] =
 static sqlite3_stmt* JSON_PATCH_SPACE_S;
 
 int
-lsddb_jsonPatchSpace (int patchSpaceId, cJSON* resp)
+lsddb_jsonPatchSpace (int patchSpaceId, struct LSD_JsonWriter* resp)
 {
     sqlite3_reset (JSON_PATCH_SPACE_S);
     sqlite3_bind_int (JSON_PATCH_SPACE_S, 1, patchSpaceId);
@@ -4121,11 +6116,11 @@ lsddb_jsonPatchSpace (int patchSpaceId, cJSON* resp)
         int panY = sqlite3_column_int (JSON_PATCH_SPACE_S, 2);
         double scale = sqlite3_column_double (JSON_PATCH_SPACE_S, 3);
 
-        cJSON_AddNumberToObject (resp, "psId", patchSpaceId);
-        cJSON_AddStringToObject (resp, "name", (const char*)psName);
-        cJSON_AddNumberToObject (resp, "x", panX);
-        cJSON_AddNumberToObject (resp, "y", panY);
-        cJSON_AddNumberToObject (resp, "scale", scale);
+        lsdjson_int (resp, "psId", patchSpaceId);
+        lsdjson_string (resp, "name", (const char*)psName);
+        lsdjson_int (resp, "x", panX);
+        lsdjson_int (resp, "y", panY);
+        lsdjson_number (resp, "scale", scale);
 
         lsddb_jsonNodes (patchSpaceId, resp);
         lsddb_jsonWires (patchSpaceId, resp);
@@ -4134,7 +6129,7 @@ lsddb_jsonPatchSpace (int patchSpaceId, cJSON* resp)
     }
     else
     {
-        cJSON_AddStringToObject (resp, "error", _("Patch Space Non-existent"));
+        lsdjson_string (resp, "error", _("Patch Space Non-existent"));
         return -1;
     }
 
@@ -4178,10 +6173,6 @@ lsddb_resolveClassFromId (struct LSD_SceneNodeClass** ptrToBind, int classId)
 }
 
 
-static const char RESOLVE_INST_FROM_ID[] =
-    "SELECT arrIdx FROM SceneNodeInst WHERE id=?1";
-static sqlite3_stmt* RESOLVE_INST_FROM_ID_S;
-
 int
 lsddb_resolveInstFromId (struct LSD_SceneNodeInst const** target,
                          int nodeId,
@@ -4190,24 +6181,12 @@ lsddb_resolveInstFromId (struct LSD_SceneNodeInst const** target,
     if (!target)
         return -1;
 
-    sqlite3_reset (RESOLVE_INST_FROM_ID_S);
-    sqlite3_bind_int (RESOLVE_INST_FROM_ID_S, 1, nodeId);
-
-    struct LSD_SceneNodeInst* pickedInst;
-
-    if (sqlite3_step (RESOLVE_INST_FROM_ID_S) == SQLITE_ROW)
-    {
-        int arrIdx = sqlite3_column_int (RESOLVE_INST_FROM_ID_S, 0);
+    struct LSD_SceneNodeInst* pickedInst =
+        lsdmap_get (getMap_lsdNodeInstMap (), nodeId);
 
-        if (pickIdx (getArr_lsdNodeInstArr (), (void**)&pickedInst, arrIdx) < 0)
-        {
-            doLog (ERROR, LOG_COMP, _("Unable to pick inst from array in resolveInstFromId()."));
-            return -1;
-        }
-    }
-    else
+    if (!pickedInst)
     {
-        doLog (ERROR, LOG_COMP, _("Inst could not be resolved in DB in resolveInstFromId()."));
+        doLog (ERROR, LOG_COMP, _("Inst could not be resolved in resolveInstFromId()."));
         return -1;
     }
 
@@ -4220,80 +6199,44 @@ lsddb_resolveInstFromId (struct LSD_SceneNodeInst const** target,
 }
 
 
-static const char RESOLVE_INST_FROM_IN_ID[] =
-    "SELECT SceneNodeInst.arrIdx FROM SceneNodeInst,SceneNodeInstInput WHERE "
-    "SceneNodeInstInput.instId=SceneNodeInst.id AND SceneNodeInstInput.facadeBool=0 "
-    "AND SceneNodeInstInput.id=?1";
-static sqlite3_stmt* RESOLVE_INST_FROM_IN_ID_S;
-
 int
 lsddb_resolveInstFromInId (struct LSD_SceneNodeInst const** target, int inId)
 {
     if (!target)
         return -1;
 
-    sqlite3_reset (RESOLVE_INST_FROM_IN_ID_S);
-    sqlite3_bind_int (RESOLVE_INST_FROM_IN_ID_S, 1, inId);
+    struct LSD_SceneNodeInput* pickedIn =
+        lsdmap_get (getMap_lsdNodeInputMap (), inId);
 
-    struct LSD_SceneNodeInst* pickedInst;
-
-    if (sqlite3_step (RESOLVE_INST_FROM_IN_ID_S) == SQLITE_ROW)
-    {
-        int arrIdx = sqlite3_column_int (RESOLVE_INST_FROM_IN_ID_S, 0);
-
-        if (pickIdx (getArr_lsdNodeInstArr (), (void**)&pickedInst, arrIdx) < 0)
-        {
-            doLog (ERROR, LOG_COMP, _("Unable to pick inst from array in resolveInstFromInId()."));
-            return -1;
-        }
-    }
-    else
+    if (!pickedIn || !pickedIn->parentNode)
     {
-        doLog (ERROR, LOG_COMP, _("Inst could not be resolved in DB in resolveInstFromInId()."));
+        doLog (ERROR, LOG_COMP, _("Inst could not be resolved in resolveInstFromInId()."));
         return -1;
     }
 
-    *target = pickedInst;
+    *target = pickedIn->parentNode;
 
     return 0;
 }
 
 
-static const char RESOLVE_INST_FROM_OUT_ID[] =
-    "SELECT SceneNodeInst.arrIdx FROM SceneNodeInst,SceneNodeInstOutput WHERE "
-    "SceneNodeInstOutput.instId=SceneNodeInst.id AND SceneNodeInstOutput.facadeBool=0 "
-    "AND SceneNodeInstOutput.id=?1";
-static sqlite3_stmt* RESOLVE_INST_FROM_OUT_ID_S;
-
 int
 lsddb_resolveInstFromOutId (struct LSD_SceneNodeInst const** target, int outId)
 {
     if (!target)
         return -1;
 
-    sqlite3_reset (RESOLVE_INST_FROM_OUT_ID_S);
-    sqlite3_bind_int (RESOLVE_INST_FROM_OUT_ID_S, 1, outId);
-
-    struct LSD_SceneNodeInst* pickedInst;
+    struct LSD_SceneNodeOutput* pickedOut =
+        lsdmap_get (getMap_lsdNodeOutputMap (), outId);
 
-    if (sqlite3_step (RESOLVE_INST_FROM_OUT_ID_S) == SQLITE_ROW)
+    if (!pickedOut || !pickedOut->parentNode)
     {
-        int arrIdx = sqlite3_column_int (RESOLVE_INST_FROM_OUT_ID_S, 0);
-
-        if (pickIdx (getArr_lsdNodeInstArr (), (void**)&pickedInst, arrIdx) < 0)
-        {
-            doLog (ERROR, LOG_COMP, _("Unable to pick inst from array in resolveInstFromOutId()."));
-            return -1;
-        }
-    }
-    else
-    {
-        doLog (ERROR, LOG_COMP, _("Inst %d could not be resolved in DB in resolveInstFromOutId()\n%s."),
-            outId, sqlite3_errmsg (memdb));
+        doLog (ERROR, LOG_COMP, _("Inst of output %d could not be resolved in resolveInstFromOutId()."),
+            outId);
         return -1;
     }
 
-    *target = pickedInst;
+    *target = pickedOut->parentNode;
 
     return 0;
 }
@@ -4305,23 +6248,53 @@ lsddb_resolveInputFromId (struct LSD_SceneNodeInput** inBind, int inId)
     if (!inBind)
         return -1;
 
-    sqlite3_reset (REMOVE_NODE_INST_INPUT_ARRIDX_S);
-    sqlite3_bind_int (REMOVE_NODE_INST_INPUT_ARRIDX_S, 1, inId);
-    if (sqlite3_step (REMOVE_NODE_INST_INPUT_ARRIDX_S) == SQLITE_ROW)
+    struct LSD_SceneNodeInput* pickedIn =
+        lsdmap_get (getMap_lsdNodeInputMap (), inId);
+
+    if (!pickedIn)
+        return -1;
+
+    *inBind = pickedIn;
+
+    return 0;
+}
+
+
+static const char GET_INST_PLUGS[] =
+    "SELECT (SELECT min(id) FROM SceneNodeInstInput WHERE instId=?1 AND facadeBool=0),"
+    "(SELECT min(id) FROM SceneNodeInstOutput WHERE instId=?1 AND facadeBool=0)";
+static sqlite3_stmt* GET_INST_PLUGS_S;
+
+int
+lsddb_getInstPlugs (int instId, int* inIdBind, int* outIdBind)
+{
+    sqlite3_reset (GET_INST_PLUGS_S);
+    sqlite3_bind_int (GET_INST_PLUGS_S, 1, instId);
+    if (sqlite3_step (GET_INST_PLUGS_S) != SQLITE_ROW)
     {
-        int arrIdx = sqlite3_column_int (REMOVE_NODE_INST_INPUT_ARRIDX_S, 0);
-        if (arrIdx < 0)
-            return -1;
+        doLog (ERROR, LOG_COMP, _("Unable to get plugs of node %d\nDetails: %s"),
+               instId, sqlite3_errmsg (memdb));
+        return -1;
+    }
 
-        if (pickIdx (getArr_lsdNodeInputArr (), (void**)inBind, arrIdx) < 0)
-        {
-            doLog (ERROR, LOG_COMP, _("Unable to pick input from array in resolveInputFromId()."));
-            return -1;
-        }
-        return 0;
+    /* -1 where the node has no plug of that kind */
+    if (inIdBind)
+    {
+        if (sqlite3_column_type (GET_INST_PLUGS_S, 0) == SQLITE_NULL)
+            *inIdBind = -1;
+        else
+            *inIdBind = sqlite3_column_int (GET_INST_PLUGS_S, 0);
     }
 
-    return -1;
+    if (outIdBind)
+    {
+        if (sqlite3_column_type (GET_INST_PLUGS_S, 1) == SQLITE_NULL)
+            *outIdBind = -1;
+        else
+            *outIdBind = sqlite3_column_int (GET_INST_PLUGS_S, 1);
+    }
+
+    return 0;
 }
 
 
@@ -4343,14 +6316,34 @@ static const char GET_PATCH_CHANNELS_ADDITIONAL[] =
     "SELECT olaUnivId,olaLightAddr FROM OlaAddress WHERE id=?1";
 static sqlite3_stmt* GET_PATCH_CHANNELS_ADDITIONAL_S;
 
+/* Writes the address object of an OlaAddress row, if it exists */
+static void
+jsonPatchChannelAddr (struct LSD_JsonWriter* target, const char* key,
+                      int addrId)
+{
+    sqlite3_reset (GET_PATCH_CHANNELS_ADDITIONAL_S);
+    sqlite3_bind_int (GET_PATCH_CHANNELS_ADDITIONAL_S, 1, addrId);
+    if (sqlite3_step (GET_PATCH_CHANNELS_ADDITIONAL_S) == SQLITE_ROW)
+    {
+        int univId = sqlite3_column_int (GET_PATCH_CHANNELS_ADDITIONAL_S, 0);
+        int lightAddr = sqlite3_column_int (GET_PATCH_CHANNELS_ADDITIONAL_S, 1);
+
+        lsdjson_beginObject (target, key);
+        lsdjson_int (target, "univId", univId);
+        lsdjson_int (target, "lightAddr", lightAddr);
+        lsdjson_endObject (target);
+    }
+}
+
+
 int
-lsddb_getPatchChannels (cJSON* target)
+lsddb_getPatchChannels (struct LSD_JsonWriter* target)
 {
     if (!target)
         return -1;
 
     /* Begin partition iteration */
-    cJSON* partArr = cJSON_CreateArray ();
+    lsdjson_beginArray (target, "partitions");
 
     sqlite3_reset (GET_PATCH_CHANNELS_PARTS_S);
 
@@ -4361,12 +6354,12 @@ lsddb_getPatchChannels (cJSON* target)
             GET_PATCH_CHANNELS_PARTS_S,
             1);
 
-        cJSON* partObj = cJSON_CreateObject ();
-        cJSON_AddNumberToObject (partObj, "partId", partId);
-        cJSON_AddStringToObject (partObj, "partName", (const char*)partName);
+        lsdjson_beginObject (target, NULL);
+        lsdjson_int (target, "partId", partId);
+        lsdjson_string (target, "partName", (const char*)partName);
 
         /* Construct channel array for this partition */
-        cJSON* chanArr = cJSON_CreateArray ();
+        lsdjson_beginArray (target, "channels");
 
         sqlite3_reset (GET_PATCH_CHANNELS_CHANS_S);
         sqlite3_bind_int (GET_PATCH_CHANNELS_CHANS_S, 1, partId);
@@ -4382,16 +6375,16 @@ lsddb_getPatchChannels (cJSON* target)
             int rLightAddr = sqlite3_column_int (GET_PATCH_CHANNELS_CHANS_S, 4);
             int sixteenBit = sqlite3_column_int (GET_PATCH_CHANNELS_CHANS_S, 5);
 
-            cJSON* chanObj = cJSON_CreateObject ();
-            cJSON_AddNumberToObject (chanObj, "chanId", chanId);
-            cJSON_AddStringToObject (chanObj, "chanName", (const char*)chanName);
-            cJSON_AddNumberToObject (chanObj, "single", single);
-            cJSON_AddNumberToObject (chanObj, "sixteenBit", sixteenBit);
+            lsdjson_beginObject (target, NULL);
+            lsdjson_int (target, "chanId", chanId);
+            lsdjson_string (target, "chanName", (const char*)chanName);
+            lsdjson_int (target, "single", single);
+            lsdjson_int (target, "sixteenBit", sixteenBit);
 
-            cJSON* rObj = cJSON_CreateObject ();
-            cJSON_AddNumberToObject (rObj, "univId", rUnivId);
-            cJSON_AddNumberToObject (rObj, "lightAddr", rLightAddr);
-            cJSON_AddItemToObject (chanObj, "redAddr", rObj);
+            lsdjson_beginObject (target, "redAddr");
+            lsdjson_int (target, "univId", rUnivId);
+            lsdjson_int (target, "lightAddr", rLightAddr);
+            lsdjson_endObject (target);
 
             /* If RGB channel, get green and blue address
              * data */
@@ -4400,54 +6393,17 @@ lsddb_getPatchChannels (cJSON* target)
                 int gAddrId = sqlite3_column_int (GET_PATCH_CHANNELS_CHANS_S, 6);
                 int bAddrId = sqlite3_column_int (GET_PATCH_CHANNELS_CHANS_S, 7);
 
-                /* Green */
-                sqlite3_reset (GET_PATCH_CHANNELS_ADDITIONAL_S);
-                sqlite3_bind_int (GET_PATCH_CHANNELS_ADDITIONAL_S, 1, gAddrId);
-                if (sqlite3_step (GET_PATCH_CHANNELS_ADDITIONAL_S) ==
-                    SQLITE_ROW)
-                {
-                    int gUnivId = sqlite3_column_int (
-                        GET_PATCH_CHANNELS_ADDITIONAL_S,
-                        0);
-                    int gLightAddr = sqlite3_column_int (
-                        GET_PATCH_CHANNELS_ADDITIONAL_S,
-                        1);
-
-                    cJSON* gObj = cJSON_CreateObject ();
-                    cJSON_AddNumberToObject (gObj, "univId", gUnivId);
-                    cJSON_AddNumberToObject (gObj, "lightAddr", gLightAddr);
-
-                    cJSON_AddItemToObject (chanObj, "greenAddr", gObj);
-                }
-
-                /* Blue */
-                sqlite3_reset (GET_PATCH_CHANNELS_ADDITIONAL_S);
-                sqlite3_bind_int (GET_PATCH_CHANNELS_ADDITIONAL_S, 1, bAddrId);
-                if (sqlite3_step (GET_PATCH_CHANNELS_ADDITIONAL_S) ==
-                    SQLITE_ROW)
-                {
-                    int bUnivId = sqlite3_column_int (
-                        GET_PATCH_CHANNELS_ADDITIONAL_S,
-                        0);
-                    int bLightAddr = sqlite3_column_int (
-                        GET_PATCH_CHANNELS_ADDITIONAL_S,
-                        1);
-
-                    cJSON* bObj = cJSON_CreateObject ();
-                    cJSON_AddNumberToObject (bObj, "univId", bUnivId);
-                    cJSON_AddNumberToObject (bObj, "lightAddr", bLightAddr);
-
-                    cJSON_AddItemToObject (chanObj, "blueAddr", bObj);
-                }
+                jsonPatchChannelAddr (target, "greenAddr", gAddrId);
+                jsonPatchChannelAddr (target, "blueAddr", bAddrId);
             }
 
-            cJSON_AddItemToArray (chanArr, chanObj);
+            lsdjson_endObject (target);
         }
-        cJSON_AddItemToObject (partObj, "channels", chanArr);
-        cJSON_AddItemToArray (partArr, partObj);
+        lsdjson_endArray (target);
+        lsdjson_endObject (target);
     }
 
-    cJSON_AddItemToObject (target, "partitions", partArr);
+    lsdjson_endArray (target);
 
     return 0;
 }
@@ -4499,7 +6455,7 @@ lsddb_addPatchChannelAddr (int* addrIdBind, cJSON* addrObj, int sixteenBit)
 
 
 int
-lsddb_addPatchChannel (int partId, cJSON* opts)
+lsddb_addPatchChannel (int partId, cJSON* opts, int* facadeOutBind)
 {
     if (!opts)
         return -1;
@@ -4538,18 +6494,32 @@ lsddb_addPatchChannel (int partId, cJSON* opts)
     sqlite3_bind_int (ADD_PATCH_CHANNEL_S, 2, partId);
     sqlite3_bind_int (ADD_PATCH_CHANNEL_S, 3, single->valueint);
 
+    /* Addresses already inserted are undone by the RPC's
+     * savepoint if a later one fails */
     int rAddrId;
-    lsddb_addPatchChannelAddr (&rAddrId, rAddr, sixteenBit->valueint);
+    if (lsddb_addPatchChannelAddr (&rAddrId, rAddr, sixteenBit->valueint) < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Invalid red address in addPatchChannel()."));
+        return -1;
+    }
     sqlite3_bind_int (ADD_PATCH_CHANNEL_S, 4, rAddrId);
 
     if (!single->valueint)
     {
         int gAddrId;
-        lsddb_addPatchChannelAddr (&gAddrId, gAddr, sixteenBit->valueint);
+        if (lsddb_addPatchChannelAddr (&gAddrId, gAddr, sixteenBit->valueint) < 0)
+        {
+            doLog (ERROR, LOG_COMP, _("Invalid green address in addPatchChannel()."));
+            return -1;
+        }
         sqlite3_bind_int (ADD_PATCH_CHANNEL_S, 5, gAddrId);
 
         int bAddrId;
-        lsddb_addPatchChannelAddr (&bAddrId, bAddr, sixteenBit->valueint);
+        if (lsddb_addPatchChannelAddr (&bAddrId, bAddr, sixteenBit->valueint) < 0)
+        {
+            doLog (ERROR, LOG_COMP, _("Invalid blue address in addPatchChannel()."));
+            return -1;
+        }
         sqlite3_bind_int (ADD_PATCH_CHANNEL_S, 6, bAddrId);
     }
 
@@ -4591,6 +6561,13 @@ lsddb_addPatchChannel (int partId, cJSON* opts)
         return -1;
     }
 
+    /* Bring the channel (and any new universe) live in place */
+    if (lsddb_structChannelId (sqlite3_last_insert_rowid (memdb)) < 0)
+        return -1;
+
+    if (facadeOutBind)
+        *facadeOutBind = facadeOut;
+
     return 0;
 }
 
@@ -4668,6 +6645,10 @@ lsddb_updatePatchChannel (int chanId, cJSON* opts)
             return -1;
     }
 
+    /* Take the channel down while its addresses are replaced */
+    if (lsddb_unstructChannel (chanId) < 0)
+        return -1;
+
     /* Delete old addresses */
     sqlite3_reset (CHANNEL_GET_ADDRS_S);
     sqlite3_bind_int (CHANNEL_GET_ADDRS_S, 1, chanId);
@@ -4731,6 +6712,9 @@ lsddb_updatePatchChannel (int chanId, cJSON* opts)
         return -1;
     }
 
+    if (lsddb_structChannelId (chanId) < 0)
+        return -1;
+
     return 0;
 }
 
@@ -4747,6 +6731,9 @@ static sqlite3_stmt* DELETE_PATCH_CHANNEL_FACADE_OUT_S;
 int
 lsddb_deletePatchChannel (int chanId)
 {
+    if (lsddb_unstructChannel (chanId) < 0)
+        return -1;
+
     /* First delete addresses */
     sqlite3_reset (CHANNEL_GET_ADDRS_S);
     sqlite3_bind_int (CHANNEL_GET_ADDRS_S, 1, chanId);
@@ -4767,6 +6754,7 @@ lsddb_deletePatchChannel (int chanId)
 
         /* Delete channel's facadeOut */
         int facadeOutId = sqlite3_column_int (CHANNEL_GET_ADDRS_S, 4);
+        lsddb_forgetOutputAlias (facadeOutId);
         sqlite3_reset (DELETE_PATCH_CHANNEL_FACADE_OUT_S);
         sqlite3_bind_int (DELETE_PATCH_CHANNEL_FACADE_OUT_S, 1, facadeOutId);
         if (sqlite3_step (DELETE_PATCH_CHANNEL_FACADE_OUT_S) != SQLITE_DONE)
@@ -5708,6 +7696,7 @@ lsddb_prepStmts ()
     PREP (RESOLVE_PLUGIN_FROM_NODE, 555);
 
     PREP (TRACE_INPUT, 56);
+    PREP (GET_INST_PLUGS, 1000);
 
     PREP (TRACE_OUTPUT, 57);
 
@@ -5732,7 +7721,6 @@ lsddb_prepStmts ()
     PREP (UNWIRE_FACADE_OUT_ALIAS, 722);
 
     PREP (REWIRE_NODES, 777);
-    PREP (REWIRE_NODES_DEST, 778);
 
     PREP (JSON_CLASS_LIBRARY, 73);
 
@@ -5759,9 +7747,6 @@ lsddb_prepStmts ()
     PREP (JSON_PATCH_SPACE, 84);
 
     PREP (RESOLVE_CLASS_FROM_ID, 85);
-    PREP (RESOLVE_INST_FROM_ID, 885);
-    PREP (RESOLVE_INST_FROM_IN_ID, 886);
-    PREP (RESOLVE_INST_FROM_OUT_ID, 887);
 
     PREP (GET_PATCH_CHANNELS_PARTS, 87);
     PREP (GET_PATCH_CHANNELS_CHANS, 88);
@@ -5784,6 +7769,27 @@ lsddb_prepStmts ()
     PREP (API_CHECK_PLUGIN_TABLE_REC, 100);
     PREP (API_INSERT_PLUGIN_TABLE_REC, 101);
 
+    PREP (SNAP_VERSION, 102);
+    PREP (SNAP_OUT_FUNCS, 103);
+    PREP (SNAP_SET_GEN, 104);
+
+    PREP (PLACE_CHANNEL_ADDR, 105);
+    PREP (STRUCT_CHANNEL_ID, 106);
+    PREP (UNSTRUCT_CHANNEL, 107);
+    PREP (UNSTRUCT_PARTITION, 108);
+    PREP (RETRACE_CHANNELS, 109);
+    PREP (STRUCT_PLUGIN_GET, 110);
+    PREP (STRUCT_PLUGIN_NODES, 111);
+    PREP (UNSTRUCT_PLUGIN_INS, 112);
+    PREP (UNSTRUCT_PLUGIN_OUTS, 113);
+    PREP (UNSTRUCT_PLUGIN_CLASSES, 114);
+    PREP (UNSTRUCT_PLUGIN_RESET_INS, 115);
+    PREP (UNSTRUCT_PLUGIN_RESET_OUTS, 116);
+    PREP (UNSTRUCT_PLUGIN_RESET_NODES, 117);
+    PREP (UNSTRUCT_PLUGIN_RESET_CLASSES, 118);
+    PREP (UNSTRUCT_PLUGIN_RESET_PLUGIN, 119);
+    PREP (RESTRUCT_PLUGIN_FIND, 120);
+
     return 0;
 }
 
@@ -5898,6 +7904,7 @@ lsddb_finishStmts ()
     FINAL (RESOLVE_PLUGIN_FROM_NODE);
 
     FINAL (TRACE_INPUT);
+    FINAL (GET_INST_PLUGS);
 
     FINAL (TRACE_OUTPUT);
 
@@ -5922,7 +7929,6 @@ lsddb_finishStmts ()
     FINAL (UNWIRE_FACADE_OUT_ALIAS);
 
     FINAL (REWIRE_NODES);
-    FINAL (REWIRE_NODES_DEST);
 
     FINAL (JSON_CLASS_LIBRARY);
 
@@ -5949,9 +7955,6 @@ lsddb_finishStmts ()
     FINAL (JSON_PATCH_SPACE);
 
     FINAL (RESOLVE_CLASS_FROM_ID);
-    FINAL (RESOLVE_INST_FROM_ID);
-    FINAL (RESOLVE_INST_FROM_IN_ID);
-    FINAL (RESOLVE_INST_FROM_OUT_ID);
 
     FINAL (GET_PATCH_CHANNELS_PARTS);
     FINAL (GET_PATCH_CHANNELS_CHANS);
@@ -5974,6 +7977,27 @@ lsddb_finishStmts ()
     FINAL (API_CHECK_PLUGIN_TABLE_REC);
     FINAL (API_INSERT_PLUGIN_TABLE_REC);
 
+    FINAL (SNAP_VERSION);
+    FINAL (SNAP_OUT_FUNCS);
+    FINAL (SNAP_SET_GEN);
+
+    FINAL (PLACE_CHANNEL_ADDR);
+    FINAL (STRUCT_CHANNEL_ID);
+    FINAL (UNSTRUCT_CHANNEL);
+    FINAL (UNSTRUCT_PARTITION);
+    FINAL (RETRACE_CHANNELS);
+    FINAL (STRUCT_PLUGIN_GET);
+    FINAL (STRUCT_PLUGIN_NODES);
+    FINAL (UNSTRUCT_PLUGIN_INS);
+    FINAL (UNSTRUCT_PLUGIN_OUTS);
+    FINAL (UNSTRUCT_PLUGIN_CLASSES);
+    FINAL (UNSTRUCT_PLUGIN_RESET_INS);
+    FINAL (UNSTRUCT_PLUGIN_RESET_OUTS);
+    FINAL (UNSTRUCT_PLUGIN_RESET_NODES);
+    FINAL (UNSTRUCT_PLUGIN_RESET_CLASSES);
+    FINAL (UNSTRUCT_PLUGIN_RESET_PLUGIN);
+    FINAL (RESTRUCT_PLUGIN_FIND);
+
     return 0;
 }
 
@@ -34,6 +34,7 @@
 
 #include "Node.h"
 #include "cJSON.h"
+#include "JsonWriter.h"
 #include "PluginAPI.h"
 
 enum RGBOPT
@@ -77,6 +78,12 @@ int
 lsddb_openDB (const char* path);
 
 
+/* Opens the show file in place (WAL mode) rather than
+ * copying it into memory */
+int
+lsddb_openDirectDB (const char* path);
+
+
 int
 lsddb_saveDB (const char* origPath);
 
@@ -85,6 +92,18 @@ int
 lsddb_autoSaveDB (const char* origPath);
 
 
+/* Advances an incremental save of the memory DB to path by at
+ * most `pages` pages. Returns 0 when the file is up to date, 1
+ * while a save is still in progress and -1 on error. */
+int
+lsddb_persistStep (const char* path, int pages);
+
+
+/* Waits out or abandons any save in progress */
+void
+lsddb_persistFinish ();
+
+
 int
 lsddb_emptyDB ();
 
@@ -93,6 +112,31 @@ int
 lsddb_closeDB ();
 
 
+/* Wraps one RPC in a savepoint. lsddb_endRPC() commits it, or
+ * rolls it back if failed; it returns 1 when a rollback undid
+ * changes (in-memory state must then be reloaded) */
+int
+lsddb_beginRPC ();
+
+
+int
+lsddb_endRPC (int failed);
+
+
+int
+lsddb_changeCount ();
+
+
+/* Wraps a batch of RPCs (each still in its own savepoint) in one
+ * outer savepoint */
+int
+lsddb_beginBatch ();
+
+
+int
+lsddb_endBatch ();
+
+
 int
 lsddb_initDB ();
 
@@ -161,6 +205,10 @@ int
 lsddb_updatePartitionName (int partId, const char* name);
 
 
+int
+lsddb_getPartitionPatchSpace (int partId, int* psIdBind);
+
+
 int
 lsddb_addNodeClass (struct LSD_SceneNodeClass** ptrToBind,
                     int pluginId,
@@ -194,7 +242,7 @@ lsddb_deletePartition (int partId);
 
 
 int
-lsddb_addPatchChannel (int partId, cJSON* opts);
+lsddb_addPatchChannel (int partId, cJSON* opts, int* facadeOutBind);
 
 
 int
@@ -255,7 +303,7 @@ lsddb_indexHtmlGen (struct evbuffer* target);
 
 
 int
-lsddb_jsonPlugins (cJSON* target);
+lsddb_jsonPlugins (struct LSD_JsonWriter* target);
 
 
 int
@@ -266,6 +314,21 @@ int
 lsddb_enablePlugin (int pluginId);
 
 
+/* Load or unload a plugin while running, constructing or
+ * tearing down only its own classes, nodes and wires */
+int
+lsddb_structPlugin (int pluginId);
+
+
+int
+lsddb_unstructPlugin (int pluginId);
+
+
+/* Reloads a running plugin's SO in place */
+int
+lsddb_restructPlugin (const char* pluginDomain);
+
+
 /* This function type is defined to enable secure passing */
 /* of a function to retreive the head, rather than the head */
 /* itself. */
@@ -319,8 +382,45 @@ int
 lsddb_unwireNodes (int wireID);
 
 
+/* Resolve a (possibly facade) plug to the node plug it
+ * aliases */
+int
+lsddb_traceInput (struct LSD_SceneNodeInput** ptrToBind,
+                  int inputId,
+                  int* typeIdBind,
+                  int* tracedIn);
+
+
+int
+lsddb_traceOutput (struct LSD_SceneNodeOutput** ptrToBind,
+                   int outputId,
+                   int* typeIdBind,
+                   int* tracedOut);
+
+
+int
+lsddb_rewireNodes ();
+
+
+/* Squeezes holes out of the node inst, input and output
+ * arrays and lays them out in evaluation order */
+int
+lsddb_compactNodeArrays ();
+
+
+/* Captures the constructed node arrays, keyed by the DB's
+ * structure version, so an unchanged reload can skip rebuilding
+ * them from SQL */
+int
+lsddb_takeSnapshot ();
+
+
+void
+lsddb_dropSnapshot ();
+
+
 int
-lsddb_jsonClassLibrary (cJSON* target);
+lsddb_jsonClassLibrary (struct LSD_JsonWriter* target);
 
 
 int
@@ -342,27 +442,27 @@ lsddb_resolveInstFromOutId (struct LSD_SceneNodeInst const** target, int outId);
 
 
 int
-lsddb_jsonNodes (int patchSpaceId, cJSON* target);
+lsddb_jsonNodes (int patchSpaceId, struct LSD_JsonWriter* target);
 
 
 int
-lsddb_jsonFacade (int psId, cJSON* resp);
+lsddb_jsonFacade (int psId, struct LSD_JsonWriter* resp);
 
 
 int
-lsddb_jsonWires (int patchSpaceId, cJSON* target);
+lsddb_jsonWires (int patchSpaceId, struct LSD_JsonWriter* target);
 
 
 int
-lsddb_jsonPatchSpace (int patchSpaceId, cJSON* resp);
+lsddb_jsonPatchSpace (int patchSpaceId, struct LSD_JsonWriter* resp);
 
 
 int
-lsddb_jsonParts (cJSON* target);
+lsddb_jsonParts (struct LSD_JsonWriter* target);
 
 
 int
-lsddb_jsonPlugins (cJSON* target);
+lsddb_jsonPlugins (struct LSD_JsonWriter* target);
 
 
 int
@@ -389,12 +489,18 @@ int
 lsddb_resolveInputFromId (struct LSD_SceneNodeInput** inBind, int inId);
 
 
+/* Binds the lowest ids of a node's inputs and outputs, or
+ * -1 where it has none */
+int
+lsddb_getInstPlugs (int instId, int* inIdBind, int* outIdBind);
+
+
 int
-lsddb_getPatchChannels (cJSON* target);
+lsddb_getPatchChannels (struct LSD_JsonWriter* target);
 
 
 int
-lsddb_addPatchChannel (int partId, cJSON* opts);
+lsddb_addPatchChannel (int partId, cJSON* opts, int* facadeOutBind);
 
 
 /* Plugin API stuff */
@@ -40,6 +40,7 @@
 #include "SceneCore.h"
 #include "Node.h"
 #include "Logging.h"
+#include "Metrics.h"
 
 /* Gettext stuff */
 #ifndef HW_RVL
@@ -75,10 +76,15 @@ closeDMX ()
 int
 bufferUnivs ()
 {
+    return bufferChannelArr (getArr_lsdChannelArr ());
+}
 
-    int rgbType = core_getRGBTypeID ();
 
-    struct LSD_ArrayHead* chanArr = getArr_lsdChannelArr ();
+int
+bufferChannelArr (struct LSD_ArrayHead* chanArr)
+{
+
+    int rgbType = core_getRGBTypeID ();
 
     struct LSD_Channel* chan = NULL;
     struct RGB_TYPE* rgb = NULL;
@@ -93,6 +99,8 @@ bufferUnivs ()
             doLog (ERROR, LOG_COMP, _("Unable to pick channel in bufferUnivs()."));
             return -1;
         }
+        if (!chan->dbId)  /* Channel deleted while running */
+            continue;
         if (chan && chan->output && chan->output->typeId == rgbType)
         {
 
@@ -162,8 +170,13 @@ bufferUnivs ()
 int
 writeUnivs ()
 {
+    return writeUnivArr (getArr_lsdUnivArr ());
+}
+
 
-    struct LSD_ArrayHead* univsArr = getArr_lsdUnivArr ();
+int
+writeUnivArr (struct LSD_ArrayHead* univsArr)
+{
 
     struct LSD_Univ* univ = NULL;
     int i;
@@ -178,8 +191,11 @@ writeUnivs ()
             doLog (ERROR, LOG_COMP, _("Unable to pick Univ in writeUnivs()."));
             return -1;
         }
+        if (!univ->buffer)
+            continue;
 
         olaUpdateDMX (univ->buffer, univ->maxIdx, univ->olaUnivId);
+        lsdmetrics_univSend (univ->olaUnivId, univ->maxIdx + 1);
     }
 #endif
 
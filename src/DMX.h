@@ -30,6 +30,8 @@
 #ifndef DMX_H_
 #define DMX_H_
 
+#include "Array.h"
+
 
 /**
   * Initialise DMX universe, no parameters
@@ -59,4 +61,16 @@ int
 writeUnivs ();
 
 
+/**
+  * As above, for array heads other than the scene's own (e.g. the
+  *frame held during a reload)
+  */
+int
+bufferChannelArr (struct LSD_ArrayHead* chanArr);
+
+
+int
+writeUnivArr (struct LSD_ArrayHead* univsArr);
+
+
 #endif /* DMX_H_ */
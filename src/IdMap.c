@@ -0,0 +1,243 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "IdMap.h"
+#include "Logging.h"
+
+/* Gettext stuff */
+#ifndef HW_RVL
+#include <libintl.h>
+#define _(String) gettext (String)
+#else
+#define _(String) String
+#endif
+
+/* Name of this component for logging */
+static const char LOG_COMP[] = "IdMap.c";
+
+/* Slot states (valid keys are always > 0) */
+#define EMPTY_KEY 0
+#define TOMB_KEY -1
+
+static size_t
+hashId (int key, size_t capacity)
+{
+    uint32_t h = (uint32_t)key * 0x9E3779B1u;
+    h ^= h >> 16;
+    return h & ( capacity - 1 );
+}
+
+
+/* Re-inserts every live slot into a table of newCap slots */
+static int
+rehash (struct LSD_IdMap* map, size_t newCap)
+{
+    struct LSD_IdMapSlot* newSlots = calloc (newCap,
+                                             sizeof( struct LSD_IdMapSlot ));
+    if (!newSlots)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to allocate slots in rehash()."));
+        return -1;
+    }
+
+    size_t i;
+    for (i = 0; i < map->capacity; ++i)
+    {
+        struct LSD_IdMapSlot* old = &map->slots[i];
+        if (old->key <= 0)
+            continue;
+
+        size_t j = hashId (old->key, newCap);
+        while (newSlots[j].key != EMPTY_KEY)
+            j = ( j + 1 ) & ( newCap - 1 );
+        newSlots[j] = *old;
+    }
+
+    free (map->slots);
+    map->slots = newSlots;
+    map->capacity = newCap;
+    map->used = map->count;
+
+    return 0;
+}
+
+
+int
+lsdmap_init (struct LSD_IdMap* map, size_t initCap)
+{
+    if (!map)
+        return -1;
+
+    size_t cap = 16;
+    while (cap < initCap)
+        cap <<= 1;
+
+    map->slots = calloc (cap, sizeof( struct LSD_IdMapSlot ));
+    if (!map->slots)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to allocate slots in lsdmap_init()."));
+        return -1;
+    }
+
+    map->capacity = cap;
+    map->count = 0;
+    map->used = 0;
+
+    return 0;
+}
+
+
+void
+lsdmap_clear (struct LSD_IdMap* map)
+{
+    if (!map)
+        return;
+
+    free (map->slots);
+    map->slots = NULL;
+    map->capacity = 0;
+    map->count = 0;
+    map->used = 0;
+}
+
+
+int
+lsdmap_put (struct LSD_IdMap* map, int key, void* value)
+{
+    if (!map || !map->slots || key <= 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Invalid arguments passed to lsdmap_put()."));
+        return -1;
+    }
+
+    /* Keep load (including tombstones) under 70% */
+    if (( map->used + 1 ) * 10 > map->capacity * 7)
+    {
+        size_t newCap = map->capacity;
+        if (( map->count + 1 ) * 2 > map->capacity)
+            newCap <<= 1;
+        if (rehash (map, newCap) < 0)
+            return -1;
+    }
+
+    size_t mask = map->capacity - 1;
+    size_t i = hashId (key, map->capacity);
+    struct LSD_IdMapSlot* tomb = NULL;
+
+    while (map->slots[i].key != EMPTY_KEY)
+    {
+        if (map->slots[i].key == key)
+        {
+            map->slots[i].value = value;
+            return 0;
+        }
+        if (map->slots[i].key == TOMB_KEY && !tomb)
+            tomb = &map->slots[i];
+        i = ( i + 1 ) & mask;
+    }
+
+    if (tomb)
+    {
+        tomb->key = key;
+        tomb->value = value;
+    }
+    else
+    {
+        map->slots[i].key = key;
+        map->slots[i].value = value;
+        ++map->used;
+    }
+    ++map->count;
+
+    return 0;
+}
+
+
+void*
+lsdmap_get (struct LSD_IdMap const* map, int key)
+{
+    if (!map || !map->slots || key <= 0)
+        return NULL;
+
+    size_t mask = map->capacity - 1;
+    size_t i = hashId (key, map->capacity);
+
+    while (map->slots[i].key != EMPTY_KEY)
+    {
+        if (map->slots[i].key == key)
+            return map->slots[i].value;
+        i = ( i + 1 ) & mask;
+    }
+
+    return NULL;
+}
+
+
+int
+lsdmap_remove (struct LSD_IdMap* map, int key)
+{
+    if (!map || !map->slots || key <= 0)
+        return -1;
+
+    size_t mask = map->capacity - 1;
+    size_t i = hashId (key, map->capacity);
+
+    while (map->slots[i].key != EMPTY_KEY)
+    {
+        if (map->slots[i].key == key)
+        {
+            map->slots[i].key = TOMB_KEY;
+            map->slots[i].value = NULL;
+            --map->count;
+            return 0;
+        }
+        i = ( i + 1 ) & mask;
+    }
+
+    return -1;
+}
+
+
+size_t
+lsdmap_removeValue (struct LSD_IdMap* map, void const* value)
+{
+    if (!map || !map->slots)
+        return 0;
+
+    size_t removed = 0;
+    size_t i;
+    for (i = 0; i < map->capacity; ++i)
+        if (map->slots[i].key > 0 && map->slots[i].value == value)
+        {
+            map->slots[i].key = TOMB_KEY;
+            map->slots[i].value = NULL;
+            --map->count;
+            ++removed;
+        }
+
+    return removed;
+}
+
+
@@ -0,0 +1,76 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+#ifndef IDMAP_H
+#define IDMAP_H
+
+#include <stdlib.h>
+
+/**
+  * Open-addressing (linear probe) map from a positive DB
+  *row id to an element pointer. Used to resolve scene objects
+  *by id without a trip through SQLite.
+  *
+  * Keys must be > 0; capacity is always a power of two.
+  */
+struct LSD_IdMapSlot
+{
+    int key;
+    void* value;
+};
+
+struct LSD_IdMap
+{
+    size_t capacity;
+    size_t count;
+    size_t used; /* count + tombstones */
+    struct LSD_IdMapSlot* slots;
+};
+
+int
+lsdmap_init (struct LSD_IdMap* map, size_t initCap);
+
+
+void
+lsdmap_clear (struct LSD_IdMap* map);
+
+
+/* Inserts or replaces the value bound to key */
+int
+lsdmap_put (struct LSD_IdMap* map, int key, void* value);
+
+
+/* Returns NULL if key is not present */
+void*
+lsdmap_get (struct LSD_IdMap const* map, int key);
+
+
+int
+lsdmap_remove (struct LSD_IdMap* map, int key);
+
+
+/* Removes every key bound to value; returns the number removed */
+size_t
+lsdmap_removeValue (struct LSD_IdMap* map, void const* value);
+
+
+#endif /* IDMAP_H */
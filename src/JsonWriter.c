@@ -0,0 +1,251 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "JsonWriter.h"
+#include "Logging.h"
+
+/* Gettext stuff */
+#ifndef HW_RVL
+#include <libintl.h>
+#define _(String) gettext (String)
+#else
+#define _(String) String
+#endif
+
+/* Name of this component for logging */
+static const char LOG_COMP[] = "JsonWriter.c";
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+
+/* Writes s as a quoted JSON string, passing unescaped runs
+ * through in one piece */
+static void
+writeQuoted (struct evbuffer* buf, const char* s)
+{
+    evbuffer_add (buf, "\"", 1);
+
+    const char* run = s;
+    for (; *s; ++s)
+    {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        if (s > run)
+            evbuffer_add (buf, run, s - run);
+        run = s + 1;
+
+        char esc[6] = {'\\', 0, '0', '0', 0, 0};
+        switch (c)
+        {
+        case '"': esc[1] = '"'; break;
+        case '\\': esc[1] = '\\'; break;
+        case '\b': esc[1] = 'b'; break;
+        case '\f': esc[1] = 'f'; break;
+        case '\n': esc[1] = 'n'; break;
+        case '\r': esc[1] = 'r'; break;
+        case '\t': esc[1] = 't'; break;
+        default:
+            esc[1] = 'u';
+            esc[4] = HEX_DIGITS[c >> 4];
+            esc[5] = HEX_DIGITS[c & 0xf];
+            evbuffer_add (buf, esc, 6);
+            continue;
+        }
+        evbuffer_add (buf, esc, 2);
+    }
+
+    if (s > run)
+        evbuffer_add (buf, run, s - run);
+    evbuffer_add (buf, "\"", 1);
+}
+
+
+/* Comma and key ahead of a new value; -1 if the value falls
+ * in a skipped container and must not be written */
+static int
+beginValue (struct LSD_JsonWriter* w, const char* key)
+{
+    if (w->skipped)
+        return -1;
+
+    if (w->depth == 0)
+        return 0;
+
+    int top = w->depth - 1;
+    if (w->hasMembers[top])
+        evbuffer_add (w->buf, ",", 1);
+    w->hasMembers[top] = 1;
+
+    if (w->isObject[top])
+    {
+        writeQuoted (w->buf, key ? key : "");
+        evbuffer_add (w->buf, ":", 1);
+    }
+
+    return 0;
+}
+
+
+static void
+beginContainer (struct LSD_JsonWriter* w, const char* key, int isObject)
+{
+    if (w->skipped || w->depth >= LSD_JSON_MAX_DEPTH)
+    {
+        if (!w->skipped)
+            doLog (ERROR, LOG_COMP, _("JSON nested too deep in beginContainer()."));
+        ++w->skipped;
+        return;
+    }
+
+    beginValue (w, key);
+    evbuffer_add (w->buf, isObject ? "{" : "[", 1);
+    w->isObject[w->depth] = isObject;
+    w->hasMembers[w->depth] = 0;
+    ++w->depth;
+}
+
+
+static void
+endContainer (struct LSD_JsonWriter* w)
+{
+    /* Matches a container that was never written */
+    if (w->skipped)
+    {
+        --w->skipped;
+        return;
+    }
+
+    if (w->depth == 0)
+        return;
+
+    --w->depth;
+    evbuffer_add (w->buf, w->isObject[w->depth] ? "}" : "]", 1);
+}
+
+
+void
+lsdjson_init (struct LSD_JsonWriter* w, struct evbuffer* buf)
+{
+    w->buf = buf;
+    w->depth = 0;
+    w->skipped = 0;
+}
+
+
+void
+lsdjson_beginObject (struct LSD_JsonWriter* w, const char* key)
+{
+    beginContainer (w, key, 1);
+}
+
+
+void
+lsdjson_endObject (struct LSD_JsonWriter* w)
+{
+    endContainer (w);
+}
+
+
+void
+lsdjson_beginArray (struct LSD_JsonWriter* w, const char* key)
+{
+    beginContainer (w, key, 0);
+}
+
+
+void
+lsdjson_endArray (struct LSD_JsonWriter* w)
+{
+    endContainer (w);
+}
+
+
+void
+lsdjson_closeTo (struct LSD_JsonWriter* w, int depth)
+{
+    while (w->skipped || w->depth > depth)
+        endContainer (w);
+}
+
+
+void
+lsdjson_string (struct LSD_JsonWriter* w, const char* key, const char* val)
+{
+    if (beginValue (w, key) < 0)
+        return;
+    if (val)
+        writeQuoted (w->buf, val);
+    else
+        evbuffer_add (w->buf, "null", 4);
+}
+
+
+void
+lsdjson_int (struct LSD_JsonWriter* w, const char* key, int val)
+{
+    if (beginValue (w, key) < 0)
+        return;
+    evbuffer_add_printf (w->buf, "%d", val);
+}
+
+
+void
+lsdjson_number (struct LSD_JsonWriter* w, const char* key, double val)
+{
+    if (beginValue (w, key) < 0)
+        return;
+    if (isfinite (val))
+        evbuffer_add_printf (w->buf, "%.15g", val);
+    else
+        evbuffer_add (w->buf, "null", 4);
+}
+
+
+void
+lsdjson_bool (struct LSD_JsonWriter* w, const char* key, int val)
+{
+    if (beginValue (w, key) < 0)
+        return;
+    if (val)
+        evbuffer_add (w->buf, "true", 4);
+    else
+        evbuffer_add (w->buf, "false", 5);
+}
+
+
+void
+lsdjson_raw (struct LSD_JsonWriter* w, const char* key,
+             const char* json, size_t len)
+{
+    if (beginValue (w, key) < 0)
+        return;
+    evbuffer_add (w->buf, json, len);
+}
+
+
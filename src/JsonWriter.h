@@ -0,0 +1,102 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include <stdlib.h>
+#include <event.h>
+
+/**
+  * Streaming JSON emitter writing straight into an evbuffer,
+  *so large responses are never built as a cJSON tree and then
+  *printed and copied again. The writer only tracks nesting and
+  *where commas go; members are written in call order.
+  *
+  * Every value call takes a key, used when the innermost open
+  *container is an object and ignored inside arrays (pass NULL).
+  */
+
+#define LSD_JSON_MAX_DEPTH 32
+
+struct LSD_JsonWriter
+{
+    struct evbuffer* buf;
+    int depth;
+    /* Containers opened past LSD_JSON_MAX_DEPTH; they and
+     * everything inside them are left out */
+    int skipped;
+    unsigned char isObject[LSD_JSON_MAX_DEPTH];
+    unsigned char hasMembers[LSD_JSON_MAX_DEPTH];
+};
+
+void
+lsdjson_init (struct LSD_JsonWriter* w, struct evbuffer* buf);
+
+
+void
+lsdjson_beginObject (struct LSD_JsonWriter* w, const char* key);
+
+
+void
+lsdjson_endObject (struct LSD_JsonWriter* w);
+
+
+void
+lsdjson_beginArray (struct LSD_JsonWriter* w, const char* key);
+
+
+void
+lsdjson_endArray (struct LSD_JsonWriter* w);
+
+
+/* Closes open containers until depth is reached */
+void
+lsdjson_closeTo (struct LSD_JsonWriter* w, int depth);
+
+
+/* NULL val is written as null */
+void
+lsdjson_string (struct LSD_JsonWriter* w, const char* key, const char* val);
+
+
+void
+lsdjson_int (struct LSD_JsonWriter* w, const char* key, int val);
+
+
+/* Non-finite values are written as null */
+void
+lsdjson_number (struct LSD_JsonWriter* w, const char* key, double val);
+
+
+void
+lsdjson_bool (struct LSD_JsonWriter* w, const char* key, int val);
+
+
+/* Splices in already-serialized JSON (e.g. a printed cJSON tree) */
+void
+lsdjson_raw (struct LSD_JsonWriter* w, const char* key,
+             const char* json, size_t len);
+
+
+#endif /* JSONWRITER_H */
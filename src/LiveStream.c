@@ -0,0 +1,291 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../config.h"
+
+#include "LiveStream.h"
+#include "CorePlugin.h"
+#include "DBArr.h"
+#include "Node.h"
+#include "Logging.h"
+
+/* Gettext stuff */
+#ifndef HW_RVL
+#include <libintl.h>
+#define _(String) gettext (String)
+#else
+#define _(String) String
+#endif
+
+/* Name of this component for logging */
+static const char LOG_COMP[] = "LiveStream.c";
+
+#define MAX_STREAMS 32
+#define MAX_STREAM_OUTS 256
+
+/* Don't queue more for a client that isn't keeping up */
+#define MAX_BACKLOG 65536
+
+/* Comment line sent when nothing changes, so proxies keep the
+ * connection open (in frames at the default 50 fps) */
+#define KEEPALIVE_FRAMES 750
+
+enum OutState
+{
+    OUT_UNSENT,
+    OUT_NULL,
+    OUT_VALUE
+};
+
+struct StreamOut
+{
+    int outId;
+    enum OutState state;
+    double last[3];
+};
+
+struct LSD_Stream
+{
+    struct evhttp_request* req;
+    int every;
+    int countdown;
+    int idle;
+    size_t outCount;
+    struct StreamOut outs[MAX_STREAM_OUTS];
+};
+
+static struct LSD_Stream* streams[MAX_STREAMS];
+
+
+/* Connection dropped by the client */
+static void
+streamClosed (struct evhttp_connection* conn, void* arg)
+{
+    struct LSD_Stream* stream = arg;
+    int i;
+    for (i = 0; i < MAX_STREAMS; ++i)
+        if (streams[i] == stream)
+            streams[i] = NULL;
+    free (stream);
+}
+
+
+/* Parses "1,2,3" into the stream's output list */
+static int
+parseOuts (struct LSD_Stream* stream, const char* list)
+{
+    while (list && *list && stream->outCount < MAX_STREAM_OUTS)
+    {
+        char* end;
+        long id = strtol (list, &end, 10);
+        if (end == list)
+            return -1;
+        if (id > 0)
+        {
+            struct StreamOut* out = &stream->outs[stream->outCount++];
+            out->outId = (int)id;
+            out->state = OUT_UNSENT;
+        }
+        list = ( *end == ',' ) ? end + 1 : NULL;
+    }
+    return stream->outCount ? 0 : -1;
+}
+
+
+void
+lsdstream_requestCB (struct evhttp_request* req, void* arg)
+{
+    int slot;
+    for (slot = 0; slot < MAX_STREAMS; ++slot)
+        if (!streams[slot])
+            break;
+    if (slot == MAX_STREAMS)
+    {
+        evhttp_send_error (req, 503, "Too many streams");
+        return;
+    }
+
+    struct LSD_Stream* stream = calloc (1, sizeof( struct LSD_Stream ));
+    if (!stream)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to allocate stream."));
+        evhttp_send_error (req, 500, "Internal Error");
+        return;
+    }
+    stream->every = 1;
+
+    struct evkeyvalq query;
+    const char* qs = strchr (evhttp_request_get_uri (req), '?');
+    evhttp_parse_query_str (qs ? qs + 1 : "", &query);
+
+    int bad = parseOuts (stream, evhttp_find_header (&query, "outs")) < 0;
+    const char* every = evhttp_find_header (&query, "every");
+    if (every)
+        stream->every = atoi (every);
+    evhttp_clear_headers (&query);
+
+    if (bad || stream->every < 1)
+    {
+        free (stream);
+        evhttp_send_error (req, 400, "Expected outs=<id>[,<id>...] and every>=1");
+        return;
+    }
+
+    stream->req = req;
+    streams[slot] = stream;
+    evhttp_connection_set_closecb (evhttp_request_get_connection (req),
+                                   streamClosed, stream);
+
+    struct evkeyvalq* headers = evhttp_request_get_output_headers (req);
+    evhttp_add_header (headers, "Content-Type", "text/event-stream");
+    evhttp_add_header (headers, "Cache-Control", "no-cache");
+    evhttp_send_reply_start (req, 200, "OK");
+}
+
+
+/* Appends out's value if it changed; returns 1 if appended */
+static int
+addOut (struct evbuffer* buf, struct StreamOut* out, int first)
+{
+    struct LSD_SceneNodeOutput* output =
+        lsdmap_get (getMap_lsdNodeOutputMap (), out->outId);
+    void* val = output ? node_bufferOutput (output) : NULL;
+
+    double cur[3] = {0, 0, 0};
+    int rgb = 0;
+    if (val)
+    {
+        if (output->typeId == core_getRGBTypeID ())
+        {
+            struct RGB_TYPE* col = val;
+            cur[0] = col->r;
+            cur[1] = col->g;
+            cur[2] = col->b;
+            rgb = 1;
+        }
+        else if (output->typeId == core_getFloatTypeID ())
+            cur[0] = *(double*)val;
+        else if (output->typeId == core_getIntegerTypeID () ||
+                 output->typeId == core_getTriggerTypeID ())
+            cur[0] = *(int*)val;
+        else
+            val = NULL; /* Plugin type; nothing to show */
+    }
+
+    if (!val)
+    {
+        if (out->state == OUT_NULL)
+            return 0;
+        out->state = OUT_NULL;
+        evbuffer_add_printf (buf, "%s\"%d\":null", first ? "" : ",",
+                             out->outId);
+        return 1;
+    }
+
+    if (out->state == OUT_VALUE && memcmp (cur, out->last, sizeof( cur )) == 0)
+        return 0;
+    out->state = OUT_VALUE;
+    memcpy (out->last, cur, sizeof( cur ));
+
+    if (rgb)
+        evbuffer_add_printf (buf, "%s\"%d\":[%.15g,%.15g,%.15g]", first ? "" : ",",
+                             out->outId, cur[0], cur[1], cur[2]);
+    else
+        evbuffer_add_printf (buf, "%s\"%d\":%.15g", first ? "" : ",",
+                             out->outId, cur[0]);
+    return 1;
+}
+
+
+void
+lsdstream_frame ()
+{
+    struct evbuffer* buf = NULL;
+
+    int i;
+    for (i = 0; i < MAX_STREAMS; ++i)
+    {
+        struct LSD_Stream* stream = streams[i];
+        if (!stream || --stream->countdown > 0)
+            continue;
+        stream->countdown = stream->every;
+
+#ifdef HAVE_EVHTTP_CONNECTION_GET_BUFFEREVENT
+        struct bufferevent* bev = evhttp_connection_get_bufferevent (
+            evhttp_request_get_connection (stream->req));
+        if (bev && evbuffer_get_length (bufferevent_get_output (bev)) > MAX_BACKLOG)
+            continue;
+#endif
+
+        if (!buf)
+            buf = evbuffer_new ();
+
+        evbuffer_add_printf (buf, "data: {");
+        int added = 0;
+        size_t j;
+        for (j = 0; j < stream->outCount; ++j)
+            added += addOut (buf, &stream->outs[j], added == 0);
+        evbuffer_add_printf (buf, "}\n\n");
+
+        if (added)
+            stream->idle = 0;
+        else
+        {
+            evbuffer_drain (buf, evbuffer_get_length (buf));
+            stream->idle += stream->every;
+            if (stream->idle < KEEPALIVE_FRAMES)
+                continue;
+            stream->idle = 0;
+            evbuffer_add_printf (buf, ":\n\n");
+        }
+
+        evhttp_send_reply_chunk (stream->req, buf);
+    }
+
+    if (buf)
+        evbuffer_free (buf);
+}
+
+
+void
+lsdstream_closeAll ()
+{
+    int i;
+    for (i = 0; i < MAX_STREAMS; ++i)
+    {
+        struct LSD_Stream* stream = streams[i];
+        if (!stream)
+            continue;
+        streams[i] = NULL;
+        evhttp_connection_set_closecb (evhttp_request_get_connection (stream->req),
+                                       NULL, NULL);
+        evhttp_send_reply_end (stream->req);
+        free (stream);
+    }
+}
+
+
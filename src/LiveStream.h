@@ -0,0 +1,58 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+
+#ifndef LIVESTREAM_H
+#define LIVESTREAM_H
+
+#include <event.h>
+#include <evhttp.h>
+
+/**
+  * Live value streaming. A client GETs the stream path with
+  *outs=<id>,<id>,... (and optionally every=<frames>) and is
+  *sent Server-Sent Events, one per frame it is due, holding
+  *the outputs whose values changed since its last event:
+  *
+  *   data: {"12":0.5,"14":[1,0.25,0]}
+  *
+  * Outputs are resolved by id every frame, so subscriptions
+  *survive reloads; an output that no longer resolves is sent
+  *once as null.
+  */
+
+/* evhttp callback for the stream path */
+void
+lsdstream_requestCB (struct evhttp_request* req, void* arg);
+
+
+/* Sends the due updates; called after each frame is rendered */
+void
+lsdstream_frame ();
+
+
+/* Ends every open stream (before the HTTP server is freed) */
+void
+lsdstream_closeAll ();
+
+
+#endif /* LIVESTREAM_H */
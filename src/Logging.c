@@ -23,12 +23,21 @@
 #include <stdio.h>
 #include <time.h>
 #include <stdarg.h>
+#ifndef HW_RVL
+#include <pthread.h>
+#endif
 
 #include "Logging.h"
 
 /* Log File handle */
 static FILE* logFile;
 
+#ifndef HW_RVL
+/* Render threads and plugins' buffer funcs log too; this keeps
+ * them off logFile while the main thread reopens it */
+static pthread_mutex_t logLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 /* Print logging to stdout/stderr if set */
 static int verbose;
 
@@ -54,7 +63,11 @@ finishLogging ()
 {
 #ifndef HW_RVL
     if (logFile)
-        return fclose (logFile);
+    {
+        int rc = fclose (logFile);
+        logFile = NULL;
+        return rc;
+    }
     return -1;
 #else
     return 0;
@@ -65,8 +78,15 @@ finishLogging ()
 int
 reloadLogging ()
 {
+#ifndef HW_RVL
+    pthread_mutex_lock (&logLock);
+#endif
     finishLogging ();
-    return initLogging (verbose);
+    int rc = initLogging (verbose);
+#ifndef HW_RVL
+    pthread_mutex_unlock (&logLock);
+#endif
+    return rc;
 }
 
 /* Various tags to place on log message */
@@ -80,9 +100,13 @@ doLog (enum LogType type, const char* component, const char* msg, ...)
 {
     // Get Time
     time_t now = time(NULL);
-    struct tm* ts = localtime (&now);
     char tBuf[80];
-    strftime (tBuf, sizeof(tBuf), "%Y-%m-%d %H:%M:%S %Z", ts);
+#ifndef HW_RVL
+    struct tm tm;
+    strftime (tBuf, sizeof(tBuf), "%Y-%m-%d %H:%M:%S %Z", localtime_r (&now, &tm));
+#else
+    strftime (tBuf, sizeof(tBuf), "%Y-%m-%d %H:%M:%S %Z", localtime (&now));
+#endif
     
     // Select correct tag
     const char* tag;
@@ -108,11 +132,13 @@ doLog (enum LogType type, const char* component, const char* msg, ...)
     
 #ifndef HW_RVL
     // Log File Print
+    pthread_mutex_lock (&logLock);
     if (logFile)
     {
         fprintf (logFile, "%s [%s] [%s] %s\n", tBuf, tag, component, vabuf);
         fflush (logFile);
     }
+    pthread_mutex_unlock (&logLock);
 #endif
     
     return 0;
@@ -0,0 +1,376 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Metrics.h"
+#include "DBArr.h"
+#include "Logging.h"
+
+/* Gettext stuff */
+#ifndef HW_RVL
+#include <libintl.h>
+#define _(String) gettext (String)
+#else
+#define _(String) String
+#endif
+
+/* Name of this component for logging */
+static const char LOG_COMP[] = "Metrics.c";
+
+/* Counters may be bumped from any thread and read by the scrape
+ * while they are; relaxed ordering is enough for statistics */
+#define COUNT_ADD(var, n) __atomic_fetch_add (&( var ), ( n ), __ATOMIC_RELAXED)
+#define COUNT_GET(var) __atomic_load_n (&( var ), __ATOMIC_RELAXED)
+
+/* Histogram bucket bounds in microseconds; a final +Inf bucket
+ * follows the listed ones */
+#define MAX_BUCKETS 10
+
+struct LSD_Histogram
+{
+    uint64_t buckets[MAX_BUCKETS + 1];
+    uint64_t sumUsec;
+};
+
+static const long FRAME_BOUNDS[] = {500, 1000, 2500, 5000, 10000, 20000,
+                                    40000, 0};
+static const long RPC_BOUNDS[] = {1000, 5000, 10000, 50000, 100000, 500000,
+                                  1000000, 5000000, 0};
+static const long RELOAD_BOUNDS[] = {50000, 100000, 250000, 500000,
+                                     1000000, 2500000, 5000000, 10000000, 0};
+
+static struct LSD_Histogram frameHist;
+static struct LSD_Histogram reloadHist;
+static uint64_t lateFrames = 0;
+
+/* Universes are claimed into a fixed table on first send; the
+ * key is univId + 1 so 0 can mark a free slot */
+#define MAX_UNIVS 64
+
+struct LSD_UnivMetric
+{
+    int key;
+    uint64_t frames;
+    uint64_t bytes;
+};
+
+static struct LSD_UnivMetric univs[MAX_UNIVS];
+static uint64_t univOverflow = 0;
+
+/* RPC methods are timed on the main thread only. Names are
+ * copied so they outlive plugins that unregister them */
+#define MAX_RPC_METHODS 96
+
+struct LSD_RPCMetric
+{
+    char name[64];
+    struct LSD_Histogram hist;
+};
+
+static struct LSD_RPCMetric rpcs[MAX_RPC_METHODS];
+static int numRpcs = 0;
+
+/* Statements run, split by whether they may write */
+static uint64_t dbReads = 0;
+static uint64_t dbWrites = 0;
+
+
+static void
+observe (struct LSD_Histogram* hist, const long* bounds, long usec)
+{
+    int i;
+    for (i = 0; bounds[i] && usec > bounds[i]; ++i)
+        ;
+    COUNT_ADD (hist->buckets[i], 1);
+    COUNT_ADD (hist->sumUsec, usec < 0 ? 0 : (uint64_t)usec);
+}
+
+
+void
+lsdmetrics_frame (long usec)
+{
+    observe (&frameHist, FRAME_BOUNDS, usec);
+}
+
+
+void
+lsdmetrics_lateFrame ()
+{
+    COUNT_ADD (lateFrames, 1);
+}
+
+
+void
+lsdmetrics_univSend (int univId, size_t len)
+{
+    int key = univId + 1;
+    int i;
+    for (i = 0; i < MAX_UNIVS; ++i)
+    {
+        int cur = COUNT_GET (univs[i].key);
+        if (cur == 0)
+        {
+            /* Claim the slot, unless another thread just did */
+            int expected = 0;
+            if (!__atomic_compare_exchange_n (&univs[i].key, &expected, key,
+                                              0, __ATOMIC_RELAXED,
+                                              __ATOMIC_RELAXED))
+                cur = expected;
+            else
+                cur = key;
+        }
+        if (cur == key)
+        {
+            COUNT_ADD (univs[i].frames, 1);
+            COUNT_ADD (univs[i].bytes, len);
+            return;
+        }
+    }
+    COUNT_ADD (univOverflow, 1);
+}
+
+
+void
+lsdmetrics_rpc (const char* method, long usec)
+{
+    int i;
+    for (i = 0; i < numRpcs; ++i)
+        if (strcmp (rpcs[i].name, method) == 0)
+            break;
+
+    if (i == numRpcs)
+    {
+        if (numRpcs == MAX_RPC_METHODS)
+            return;
+        snprintf (rpcs[i].name, sizeof( rpcs[i].name ), "%s", method);
+        ++numRpcs;
+    }
+
+    observe (&rpcs[i].hist, RPC_BOUNDS, usec);
+}
+
+
+void
+lsdmetrics_reload (long usec)
+{
+    observe (&reloadHist, RELOAD_BOUNDS, usec);
+}
+
+
+#if SQLITE_VERSION_NUMBER >= 3014000
+static int
+countStmt (unsigned type, void* ctx, void* p, void* x)
+{
+    /* Trigger programs are reported as "-- TRIGGER name" */
+    const char* sql = x;
+    if (sql && sql[0] == '-' && sql[1] == '-')
+        return 0;
+
+    if (sqlite3_stmt_readonly ((sqlite3_stmt*)p))
+        COUNT_ADD (dbReads, 1);
+    else
+        COUNT_ADD (dbWrites, 1);
+    return 0;
+}
+#endif
+
+
+void
+lsdmetrics_watchDB (sqlite3* db)
+{
+#if SQLITE_VERSION_NUMBER >= 3014000
+    if (sqlite3_trace_v2 (db, SQLITE_TRACE_STMT, countStmt, NULL) !=
+        SQLITE_OK)
+        doLog (WARNING, LOG_COMP, _("Unable to count DB statements."));
+#endif
+}
+
+
+/* Writes hist as a Prometheus histogram; labels (may be empty)
+ * are prepended to each sample's label set */
+static void
+writeHistogram (struct evbuffer* buf, const char* name, const char* labels,
+                struct LSD_Histogram const* hist, const long* bounds)
+{
+    const char* sep = labels[0] ? "," : "";
+    uint64_t cum = 0;
+    int i;
+    for (i = 0; bounds[i]; ++i)
+    {
+        cum += COUNT_GET (hist->buckets[i]);
+        evbuffer_add_printf (buf, "%s_bucket{%s%sle=\"%g\"} %llu\n", name,
+                             labels, sep, bounds[i] / 1e6,
+                             (unsigned long long)cum);
+    }
+    cum += COUNT_GET (hist->buckets[i]);
+    evbuffer_add_printf (buf, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name,
+                         labels, sep, (unsigned long long)cum);
+
+    const char* open = labels[0] ? "{" : "";
+    const char* close = labels[0] ? "}" : "";
+    evbuffer_add_printf (buf, "%s_sum%s%s%s %.6f\n", name, open, labels, close,
+                         COUNT_GET (hist->sumUsec) / 1e6);
+    evbuffer_add_printf (buf, "%s_count%s%s%s %llu\n", name, open, labels,
+                         close, (unsigned long long)cum);
+}
+
+
+/* Writes key="value" to out, escaping the value as the text
+ * format requires. out must hold strlen (key) + 4 + twice the
+ * value's length */
+static void
+formatLabel (char* out, const char* key, const char* value)
+{
+    out += sprintf (out, "%s=\"", key);
+    for (; *value; ++value)
+    {
+        if (*value == '\\' || *value == '"')
+            *out++ = '\\';
+        else if (*value == '\n')
+        {
+            *out++ = '\\';
+            *out++ = 'n';
+            continue;
+        }
+        *out++ = *value;
+    }
+    *out++ = '"';
+    *out = '\0';
+}
+
+
+static void
+writeArray (struct evbuffer* buf, const char* metric, const char* name,
+            size_t value)
+{
+    evbuffer_add_printf (buf, "%s{array=\"%s\"} %lu\n", metric, name,
+                         (unsigned long)value);
+}
+
+
+void
+lsdmetrics_requestCB (struct evhttp_request* req, void* arg)
+{
+    struct evbuffer* buf = evbuffer_new ();
+    if (!buf)
+    {
+        evhttp_send_error (req, 500, "Internal Error");
+        return;
+    }
+
+    evbuffer_add_printf (buf, "# HELP lsd_frame_seconds Time taken to evaluate and send a frame.\n"
+                              "# TYPE lsd_frame_seconds histogram\n");
+    writeHistogram (buf, "lsd_frame_seconds", "", &frameHist, FRAME_BOUNDS);
+
+    evbuffer_add_printf (buf, "# HELP lsd_late_frames_total Frames started a whole interval late.\n"
+                              "# TYPE lsd_late_frames_total counter\n"
+                              "lsd_late_frames_total %llu\n",
+                         (unsigned long long)COUNT_GET (lateFrames));
+
+    evbuffer_add_printf (buf, "# HELP lsd_univ_frames_total DMX buffers sent per universe.\n"
+                              "# TYPE lsd_univ_frames_total counter\n");
+    int i;
+    for (i = 0; i < MAX_UNIVS; ++i)
+    {
+        int key = COUNT_GET (univs[i].key);
+        if (key)
+            evbuffer_add_printf (buf, "lsd_univ_frames_total{univ=\"%d\"} %llu\n",
+                                 key - 1,
+                                 (unsigned long long)COUNT_GET (univs[i].frames));
+    }
+    evbuffer_add_printf (buf, "# HELP lsd_univ_bytes_total DMX bytes sent per universe.\n"
+                              "# TYPE lsd_univ_bytes_total counter\n");
+    for (i = 0; i < MAX_UNIVS; ++i)
+    {
+        int key = COUNT_GET (univs[i].key);
+        if (key)
+            evbuffer_add_printf (buf, "lsd_univ_bytes_total{univ=\"%d\"} %llu\n",
+                                 key - 1,
+                                 (unsigned long long)COUNT_GET (univs[i].bytes));
+    }
+    evbuffer_add_printf (buf, "# HELP lsd_univ_untracked_frames_total DMX buffers sent to universes past the tracked limit.\n"
+                              "# TYPE lsd_univ_untracked_frames_total counter\n"
+                              "lsd_univ_untracked_frames_total %llu\n",
+                         (unsigned long long)COUNT_GET (univOverflow));
+
+    evbuffer_add_printf (buf, "# HELP lsd_rpc_seconds Time taken by RPC methods, commit included.\n"
+                              "# TYPE lsd_rpc_seconds histogram\n");
+    for (i = 0; i < numRpcs; ++i)
+    {
+        char labels[sizeof( "method=\"\"" ) + 2 * sizeof( rpcs[i].name )];
+        formatLabel (labels, "method", rpcs[i].name);
+        writeHistogram (buf, "lsd_rpc_seconds", labels, &rpcs[i].hist,
+                        RPC_BOUNDS);
+    }
+
+    evbuffer_add_printf (buf, "# HELP lsd_db_statements_total SQL statements run.\n"
+                              "# TYPE lsd_db_statements_total counter\n"
+                              "lsd_db_statements_total{kind=\"read\"} %llu\n"
+                              "lsd_db_statements_total{kind=\"write\"} %llu\n",
+                         (unsigned long long)COUNT_GET (dbReads),
+                         (unsigned long long)COUNT_GET (dbWrites));
+
+    evbuffer_add_printf (buf, "# HELP lsd_reload_seconds Time taken by scene reloads.\n"
+                              "# TYPE lsd_reload_seconds histogram\n");
+    writeHistogram (buf, "lsd_reload_seconds", "", &reloadHist, RELOAD_BOUNDS);
+
+    /* Array heads only change on this thread */
+    struct
+    {
+        const char* name;
+        struct LSD_ArrayHead* arr;
+    } arrays[] = {
+        {"dbStmt", getArr_lsdDBStmtArr ()},
+        {"nodeInst", getArr_lsdNodeInstArr ()},
+        {"nodeClass", getArr_lsdNodeClassArr ()},
+        {"nodeInput", getArr_lsdNodeInputArr ()},
+        {"nodeOutput", getArr_lsdNodeOutputArr ()},
+        {"plugin", getArr_lsdPluginArr ()},
+        {"partition", getArr_lsdPartitionArr ()},
+        {"univ", getArr_lsdUnivArr ()},
+        {"channel", getArr_lsdChannelArr ()}
+    };
+    int numArrays = sizeof( arrays ) / sizeof( arrays[0] );
+
+    evbuffer_add_printf (buf, "# HELP lsd_array_elements Live elements in each scene array.\n"
+                              "# TYPE lsd_array_elements gauge\n");
+    for (i = 0; i < numArrays; ++i)
+        writeArray (buf, "lsd_array_elements", arrays[i].name,
+                    arrays[i].arr->numElems);
+    evbuffer_add_printf (buf, "# HELP lsd_array_capacity Allocated element slots in each scene array.\n"
+                              "# TYPE lsd_array_capacity gauge\n");
+    for (i = 0; i < numArrays; ++i)
+        writeArray (buf, "lsd_array_capacity", arrays[i].name,
+                    arrays[i].arr->capacity);
+
+    struct evkeyvalq* headers = evhttp_request_get_output_headers (req);
+    evhttp_add_header (headers, "Content-Type",
+                       "text/plain; version=0.0.4; charset=utf-8");
+    evhttp_add_header (headers, "Cache-Control", "no-cache");
+    evhttp_send_reply (req, 200, "OK", buf);
+    evbuffer_free (buf);
+}
+
@@ -0,0 +1,77 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <event.h>
+#include <evhttp.h>
+#include <sqlite3.h>
+
+/**
+  * Counters for the Prometheus text exposition served on
+  *"/metrics". Recording is a few relaxed atomic adds, safe from
+  *the render thread; the scrape reads the same counters
+  *without taking the scene lock, so it never waits on a frame.
+  *
+  * Array occupancy is read straight from the array heads, which
+  *only the main thread (where scrapes run) ever changes.
+  */
+
+/* Time taken to evaluate and send one frame */
+void
+lsdmetrics_frame (long usec);
+
+
+/* A frame started a whole interval late */
+void
+lsdmetrics_lateFrame ();
+
+
+/* One DMX buffer of len bytes sent to universe univId */
+void
+lsdmetrics_univSend (int univId, size_t len);
+
+
+/* Time taken by one RPC method call, commit included (main
+ * thread only) */
+void
+lsdmetrics_rpc (const char* method, long usec);
+
+
+/* Duration of a completed reload */
+void
+lsdmetrics_reload (long usec);
+
+
+/* Counts statements run on db; hooked up when the DB is opened */
+void
+lsdmetrics_watchDB (sqlite3* db);
+
+
+/* evhttp callback for the metrics path */
+void
+lsdmetrics_requestCB (struct evhttp_request* req, void* arg);
+
+
+#endif /* METRICS_H */
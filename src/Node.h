@@ -85,6 +85,12 @@ struct LSD_SceneNodeClass
     size_t instDataSize;
     bfFunc* bfFuncTbl;
     bpFunc* bpFuncTbl;
+    /* Control port hooks; NULL unless registered with
+     * plugininit_registerNodeControl () */
+    int ( *nodeControlFunc )(struct LSD_SceneNodeInst const*, void* instData,
+                             int sub, const double* vals, int count);
+    int ( *nodePersistFunc )(struct LSD_SceneNodeInst const*, void* instData,
+                             int sub);
 };
 
 struct LSD_SceneNodeInst
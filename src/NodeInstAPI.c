@@ -166,3 +166,33 @@ plugininst_getInputStruct (struct LSD_SceneNodeInst const* inst,
 }
 
 
+int
+plugininst_bindInput (struct LSD_SceneNodeInst const* inst,
+                      struct LSD_InputBinding* binding, int inId)
+{
+    if (!binding)
+        return -1;
+
+    binding->input = NULL;
+
+    if (plugininst_getInputStruct (inst, &binding->input, inId) < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to bind input %d."), inId);
+        binding->input = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+
+void*
+plugininst_bufferBoundInput (struct LSD_InputBinding const* binding)
+{
+    if (!binding->input || !binding->input->connection)
+        return NULL;
+
+    return node_bufferOutput (binding->input->connection);
+}
+
+
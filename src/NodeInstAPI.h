@@ -55,4 +55,28 @@ plugininst_getInputStruct (struct LSD_SceneNodeInst const* inst,
                            struct LSD_SceneNodeInput const** inBind, int inId);
 
 
+/**
+  * Bound input handle. Resolve once from a node's make or
+  *restore function and keep it in the inst data; buffering
+  *through it needs no lookups. Wiring and unwiring only
+  *change the input's connection, so a binding stays valid
+  *until the input itself is removed. The core re-runs
+  *clean/restore on nodes whose inputs it relocates.
+  */
+struct LSD_InputBinding
+{
+    struct LSD_SceneNodeInput const* input;
+};
+
+int
+plugininst_bindInput (struct LSD_SceneNodeInst const* inst,
+                      struct LSD_InputBinding* binding, int inId);
+
+
+/* Buffers whatever is wired to the bound input (NULL when
+ * unbound or unconnected) */
+void*
+plugininst_bufferBoundInput (struct LSD_InputBinding const* binding);
+
+
 #endif /* NODEINSTAPI_H */
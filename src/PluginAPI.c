@@ -28,6 +28,7 @@
 #include "PluginAPI.h"
 #include "DBOps.h"
 #include "NodeInstAPI.h"
+#include "RPCMethods.h"
 #include "Logging.h"
 
 /* Gettext stuff */
@@ -51,6 +52,7 @@ destruct_ScenePlugin (void* plugin)
     if (plugin)
     {
         struct LSD_ScenePlugin* castPlugin = plugin;
+        lsdrpc_unregisterPlugin (castPlugin);
         if (castPlugin->cleanupFunc)
             castPlugin->cleanupFunc (castPlugin);
         if (castPlugin->dlObj)
@@ -119,6 +121,8 @@ plugininit_registerNodeClass (struct LSD_ScenePlugin const* key,
     tempClass->instDataSize = nodeDataSize;
     tempClass->bfFuncTbl = bfFuncTbl;
     tempClass->bpFuncTbl = bpFuncTbl;
+    tempClass->nodeControlFunc = NULL;
+    tempClass->nodePersistFunc = NULL;
 
     if (ptrToBind)
         *ptrToBind = tempClass;
@@ -127,6 +131,29 @@ plugininit_registerNodeClass (struct LSD_ScenePlugin const* key,
 }
 
 
+int
+plugininit_registerNodeControl (struct LSD_ScenePlugin const* key,
+                                struct LSD_SceneNodeClass* nodeClass,
+                                nodeControlFunc controlFunc,
+                                nodePersistFunc persistFunc)
+{
+    if (apistate != STATE_PINIT)
+        return -10;
+
+    if (!key || !nodeClass || nodeClass->plugin != key || !controlFunc ||
+        !persistFunc)
+    {
+        doLog (ERROR, LOG_COMP, _("Improper use of registerNodeControl()."));
+        return -1;
+    }
+
+    nodeClass->nodeControlFunc = controlFunc;
+    nodeClass->nodePersistFunc = persistFunc;
+
+    return 0;
+}
+
+
 int
 plugininit_registerDataType (struct LSD_ScenePlugin const* key,
                              int* ptrToBind,
@@ -157,6 +184,31 @@ plugininit_registerDataType (struct LSD_ScenePlugin const* key,
 }
 
 
+int
+plugininit_registerRPCMethod (struct LSD_ScenePlugin const* key,
+                              const char* name,
+                              rpcMethodFunc func,
+                              int flags)
+{
+    if (apistate != STATE_PINIT)
+        return -10;
+
+    if (!key || !name || !func)
+    {
+        doLog (ERROR, LOG_COMP, _("Improper use of registerRPCMethod()."));
+        return -1;
+    }
+
+    if (lsdrpc_registerMethod (name, func, key, flags) < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to register RPC method %s."), name);
+        return -1;
+    }
+
+    return 0;
+}
+
+
 struct LSD_SceneNodeInst const*
 plugin_getInstById (struct LSD_ScenePlugin const* key,
                     int nodeId,
@@ -67,6 +67,15 @@ destruct_ScenePlugin (void* plugin);
   *order to free up memory and clean up or commit temporary
   *database entries. And is called on partition deallocation
   *(From a restart or shutdown)
+  *
+  * Generations never overlap: on a reload every node of the
+  *old generation is cleaned and the cleanup function has
+  *returned before initialisation runs for the new one, and
+  *no buffer func of the old generation runs after it. A
+  *shared object may stay mapped across a reload (its statics
+  *keep their values), so plugins may keep per-generation
+  *state in statics, but must set it up again in init. Only
+  *the last frame's universe buffers stay on air meanwhile.
   */
 struct LSD_ScenePluginHEAD
 {
@@ -75,6 +84,24 @@ struct LSD_ScenePluginHEAD
     void ( *rpcFunc )(cJSON* in, cJSON* out);
 };
 
+/**
+  * RPC methods
+  *
+  * Plugins may expose methods of their own to the JSON RPC,
+  *called by name alongside the core's. Flags describe how the
+  *core runs them: by default a method runs inside one DB
+  *savepoint that is rolled back if it reports an "error".
+  */
+typedef void ( *rpcMethodFunc )(cJSON* req, cJSON* resp);
+
+/* Rebuild the scene after the method succeeds */
+#define LSD_RPC_RELOAD 0x1
+/* Method only reads the DB; skip the savepoint */
+#define LSD_RPC_READONLY 0x2
+/* Response depends only on the request and the DB; it may be
+ * served from cache while neither changes (implies READONLY) */
+#define LSD_RPC_CACHED 0x6
+
 /* Object construction functions */
 
 int plugininit_registerNodeClass (struct LSD_ScenePlugin const* key,
@@ -102,6 +129,34 @@ plugininit_registerDataType (struct LSD_ScenePlugin const* key,
                              const char* name, const char* desc);
 
 
+int
+plugininit_registerRPCMethod (struct LSD_ScenePlugin const* key,
+                              const char* name,
+                              rpcMethodFunc func,
+                              int flags);
+
+
+/**
+  * Node classes may take values from the binary control port
+  *(ControlPort.h). The control func stores count values into
+  *instance data straight away; sub selects which of the node's
+  *values (0 if it has only one). The persist func later writes
+  *the current value of sub to the DB; the core coalesces these
+  *into one transaction shortly after.
+  */
+typedef int ( *nodeControlFunc )(struct LSD_SceneNodeInst const* inst,
+                                 void* instData, int sub,
+                                 const double* vals, int count);
+typedef int ( *nodePersistFunc )(struct LSD_SceneNodeInst const* inst,
+                                 void* instData, int sub);
+
+int
+plugininit_registerNodeControl (struct LSD_ScenePlugin const* key,
+                                struct LSD_SceneNodeClass* nodeClass,
+                                nodeControlFunc controlFunc,
+                                nodePersistFunc persistFunc);
+
+
 struct LSD_SceneNodeInst const*
 plugin_getInstById (struct LSD_ScenePlugin const* key,
                     int nodeId,
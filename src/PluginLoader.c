@@ -25,12 +25,31 @@
 #include <string.h>
 #include <stdlib.h>
 #include <ltdl.h>
+#include <event.h>
 #include <evhttp.h>
 #include "cJSON.h"
 
+#include "../config.h"
+
+#if !defined(HW_RVL) && defined(HAVE_SYS_INOTIFY_H)
+#include <sys/inotify.h>
+#define PLUGIN_WATCH
+#endif
+
+#ifndef HW_RVL
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #include "PluginLoader.h"
 #include "DBOps.h"
+#include "SceneCore.h"
 #include "Logging.h"
+#include "SHA1.h"
+#include "ReloadStats.h"
+#include "ControlPort.h"
 
 /* Gettext stuff */
 #ifndef HW_RVL
@@ -53,23 +72,111 @@ static const char WEB_PLUGIN_PATH[] = WEB_PLUGIN_DIR;
 
 
 #ifndef HW_RVL
-/* compute a hash for the plugin and pass to database system for insertion */
+/* Digests of plugin files already hashed, keyed by file identity
+ * so unchanged plugins skip hashing on reload */
+#define HASH_CACHE_LEN 32
+struct PluginHashEntry
+{
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+    long mtimeNsec; /* 0 where stat has no st_mtim */
+    char digest[41];
+};
+static struct PluginHashEntry hashCache[HASH_CACHE_LEN];
+static size_t hashCacheLen = 0;
+static size_t hashCacheNext = 0;
+
+
+/* SHA1 of the file at path (40 hex chars + NUL) via mmap,
+ * served from hashCache if the file is unchanged */
+static int
+hashPluginFile (const char* path, char* digest)
+{
+    int fd = open (path, O_RDONLY);
+    if (fd < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to open %s for hashing."), path);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat (fd, &st) < 0)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to stat %s for hashing."), path);
+        close (fd);
+        return -1;
+    }
+
+    /* A plugin rewritten in place at the same size within one
+     * second is only told apart by the sub-second mtime */
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+    long mtimeNsec = st.st_mtim.tv_nsec;
+#else
+    long mtimeNsec = 0;
+#endif
+
+    size_t i;
+    for (i = 0; i < hashCacheLen; ++i)
+    {
+        struct PluginHashEntry* ent = &hashCache[i];
+        if (ent->dev == st.st_dev && ent->ino == st.st_ino &&
+            ent->size == st.st_size && ent->mtime == st.st_mtime &&
+            ent->mtimeNsec == mtimeNsec)
+        {
+            close (fd);
+            memcpy (digest, ent->digest, 41);
+            return 0;
+        }
+    }
+
+    if (st.st_size > 0)
+    {
+        void* map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            doLog (ERROR, LOG_COMP, _("Unable to map %s for hashing."), path);
+            close (fd);
+            return -1;
+        }
+        lsdsha1_hex (map, st.st_size, digest);
+        munmap (map, st.st_size);
+    }
+    else
+        lsdsha1_hex (NULL, 0, digest);
+    close (fd);
+
+    /* Remember it; overwrite the oldest entry once full */
+    struct PluginHashEntry* ent = &hashCache[hashCacheNext];
+    ent->dev = st.st_dev;
+    ent->ino = st.st_ino;
+    ent->size = st.st_size;
+    ent->mtime = st.st_mtime;
+    ent->mtimeNsec = mtimeNsec;
+    memcpy (ent->digest, digest, 41);
+    hashCacheNext = ( hashCacheNext + 1 ) % HASH_CACHE_LEN;
+    if (hashCacheLen < HASH_CACHE_LEN)
+        ++hashCacheLen;
+
+    return 0;
+}
+
+
+/* compute a hash for the plugin and pass to database system for insertion;
+ * enable loads it regardless of its recorded state and SHA */
 int
 checkAddPlugin (const char* pluginFile, const char* pluginName, 
-                lt_dlhandle pluginHandle)
+                lt_dlhandle pluginHandle, int enable)
 {
 
     /* First get the file's digest */
-    char shaCommand[264];
-    snprintf (shaCommand, 264, "sha1sum %s", pluginFile);
-    FILE* shaStream = popen (shaCommand, "r");
-
-    char digest[42];
-    if(!fread (digest, 40, 1, shaStream))
+    char digest[41];
+    if (hashPluginFile (pluginFile, digest) < 0)
+    {
+        lt_dlclose (pluginHandle);
         return -1;
-    digest[41] = '\0';
-
-    pclose (shaStream);
+    }
 
     doLog (NOTICE, LOG_COMP, _("%s digest: %.40s."), pluginName, digest);
 
@@ -77,7 +184,7 @@ checkAddPlugin (const char* pluginFile, const char* pluginName,
     ghType getHead = lt_dlsym (pluginHandle, "getPluginHead");
     if (getHead)
     {
-        if ( lsddb_pluginHeadLoader (getHead, 0, pluginName, digest,
+        if ( lsddb_pluginHeadLoader (getHead, enable, pluginName, digest,
                                      pluginHandle) < 0 )
         {
             doLog (ERROR, LOG_COMP, _("Unable to validate plugin HEAD of %s."), pluginName);
@@ -101,12 +208,12 @@ checkAddPlugin (const char* pluginFile, const char* pluginName,
 /* Static plugin counterpart of checkAddPlugin 
  * searches for pluginHead accessor within linked plugin */
 int
-checkAddPlugin_static (const char* pluginName, void* ghPtr)
+checkAddPlugin_static (const char* pluginName, void* ghPtr, int enable)
 {
     ghType getHead = (ghType)ghPtr;
     if (getHead)
     {
-        if ( lsddb_pluginHeadLoader (getHead, 0, pluginName, "STATIC",
+        if ( lsddb_pluginHeadLoader (getHead, enable, pluginName, "STATIC",
                                      NULL) < 0 )
         {
             doLog (ERROR, LOG_COMP, _("Unable to validate plugin HEAD of %s statically."), pluginName);
@@ -127,6 +234,9 @@ checkAddPlugin_static (const char* pluginName, void* ghPtr)
 int
 scrapePlugin (const char *filename, void * data)
 {
+    struct timeval start;
+    gettimeofday (&start, NULL);
+
     lt_dlhandle pluginHandle = lt_dlopenext (filename);
     if (!pluginHandle)
     {
@@ -145,7 +255,11 @@ scrapePlugin (const char *filename, void * data)
     
     /* Continue Loading Plugin */
     doLog (NOTICE, LOG_COMP, _("Found %s."), pluginInfo->name);
-    checkAddPlugin (pluginInfo->filename, pluginInfo->name, pluginHandle);
+    /* The handle (and its info) is gone if the plugin is rejected */
+    char pluginName[64];
+    snprintf (pluginName, 64, "%s", pluginInfo->name);
+    checkAddPlugin (pluginInfo->filename, pluginInfo->name, pluginHandle, 0);
+    lsdstats_plugin (pluginName, lsdstats_since (&start));
     
     return 0;
 }
@@ -167,10 +281,11 @@ loadPluginsDirectory ()
 }
 #endif
 
-/* Uses dlpreloading to discover plugins that
- * were statically linked at compile time */
-int
-loadPlugins_static ()
+/* Walks the dlpreloaded symbols, handing every plugin (or
+ * only the one named onlyName) to checkAddPlugin_static.
+ * Returns 1 if onlyName was found */
+static int
+scrapePlugins_static (const char* onlyName)
 {
     if(LTDL_SET_PRELOADED_SYMBOLS() != 0)
         return -1;
@@ -197,7 +312,20 @@ loadPlugins_static ()
         else if (sym.name && sym.address)
         {
             if (strncmp (nameComp, sym.name, 128) == 0)
-                checkAddPlugin_static (pluginName, sym.address);
+            {
+                if (!onlyName)
+                {
+                    struct timeval start;
+                    gettimeofday (&start, NULL);
+                    checkAddPlugin_static (pluginName, sym.address, 0);
+                    lsdstats_plugin (pluginName, lsdstats_since (&start));
+                }
+                else if (strcmp (onlyName, pluginName) == 0)
+                {
+                    checkAddPlugin_static (pluginName, sym.address, 1);
+                    return 1;
+                }
+            }
         }
         else
             break;
@@ -208,6 +336,201 @@ loadPlugins_static ()
 }
 
 
+/* Uses dlpreloading to discover plugins that
+ * were statically linked at compile time */
+int
+loadPlugins_static ()
+{
+    return ( scrapePlugins_static (NULL) < 0 ) ? -1 : 0;
+}
+
+
+/* Loads the single plugin named pluginName (as recorded in
+ * ScenePlugin.pluginDomain) while the scene is running.
+ * Static plugins are checked first, then PLUGIN_DIR */
+int
+loadPlugin (const char* pluginName)
+{
+    if (!pluginName)
+        return -1;
+
+    int found = scrapePlugins_static (pluginName);
+    if (found != 0)
+        return ( found < 0 ) ? -1 : 0;
+
+#ifndef HW_RVL
+#ifndef PLUGIN_DIR
+    doLog (ERROR, LOG_COMP, _("PLUGIN_DIR not provided at compile time."));
+    return -1;
+#else
+    char pluginPath[256];
+    snprintf (pluginPath, 256, "%s/%s", PLUGIN_PATH, pluginName);
+
+    lt_dlhandle pluginHandle = lt_dlopenext (pluginPath);
+    if (!pluginHandle)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to link %s\nDetails: %s."), pluginPath, lt_dlerror());
+        return -1;
+    }
+
+    lt_dlinfo const * pluginInfo = lt_dlgetinfo (pluginHandle);
+    if (!pluginInfo)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to get plugin SO info for %s\nDetails: %s."), 
+               pluginPath, lt_dlerror());
+        lt_dlclose (pluginHandle);
+        return -1;
+    }
+
+    return checkAddPlugin (pluginInfo->filename, pluginInfo->name, pluginHandle, 1);
+#endif
+#else
+    doLog (ERROR, LOG_COMP, _("Plugin %s is not linked statically."), pluginName);
+    return -1;
+#endif
+}
+
+
+#ifdef PLUGIN_WATCH
+/* Plugin directory watch. A plugin SO written into PLUGIN_DIR
+ * while its plugin is running is swapped in without a reload:
+ * only that plugin's nodes are cleaned, the library reopened
+ * and its nodes restored. Events are collected until the
+ * directory has been quiet for WATCH_SETTLE, since installing
+ * a build usually touches several files. */
+static int watchFd = -1;
+static struct event* watchEv = NULL;
+static struct event* settleEv = NULL;
+
+static const struct timeval WATCH_SETTLE = {0, 500000};
+
+#define WATCH_MAX_PENDING 16
+static char watchPending[WATCH_MAX_PENDING][64];
+static int watchNumPending = 0;
+
+static void
+settlePluginWatch (evutil_socket_t fd, short what, void* arg)
+{
+    /* Restructuring rebuilds instance data from the DB */
+    lsdctl_flush ();
+
+    int i;
+    for (i = 0; i < watchNumPending; ++i)
+    {
+        /* Same transaction handling as an RPC; a failure is
+         * rolled back and the scene reloaded */
+        int inTxn = ( lsddb_beginRPC () == 0 );
+        lockScene ();
+        int failed = ( lsddb_restructPlugin (watchPending[i]) < 0 );
+        unlockScene ();
+        if (failed)
+            doLog (ERROR, LOG_COMP, _("Unable to reload changed plugin %s."),
+                   watchPending[i]);
+        if (inTxn && lsddb_endRPC (failed) > 0)
+            handleReload (0, 0, NULL);
+    }
+    watchNumPending = 0;
+}
+
+
+static void
+readPluginWatch (evutil_socket_t fd, short what, void* arg)
+{
+    union
+    {
+        struct inotify_event ev;
+        char buf[4096];
+    } evBuf;
+
+    ssize_t len;
+    while (( len = read (fd, evBuf.buf, sizeof( evBuf.buf ))) > 0)
+    {
+        char* ptr = evBuf.buf;
+        while (ptr < evBuf.buf + len)
+        {
+            struct inotify_event const* ev = (struct inotify_event const*)ptr;
+            ptr += sizeof( struct inotify_event ) + ev->len;
+
+            /* Plugin name is the file name up to its first dot
+             * (TimePlugin.so, TimePlugin.la); hidden and
+             * extensionless files are build debris */
+            if (!ev->len || ev->name[0] == '.')
+                continue;
+            char const* dot = strchr (ev->name, '.');
+            if (!dot || dot - ev->name >= 64)
+                continue;
+
+            char name[64];
+            memcpy (name, ev->name, dot - ev->name);
+            name[dot - ev->name] = '\0';
+
+            int i;
+            for (i = 0; i < watchNumPending; ++i)
+                if (strcmp (watchPending[i], name) == 0)
+                    break;
+            if (i == watchNumPending && watchNumPending < WATCH_MAX_PENDING)
+                strcpy (watchPending[watchNumPending++], name);
+        }
+    }
+
+    /* (Re)start the settle period */
+    if (watchNumPending)
+        evtimer_add (settleEv, &WATCH_SETTLE);
+}
+#endif
+
+
+/* Begins watching PLUGIN_DIR for rebuilt plugins */
+int
+openPluginWatch (struct event_base* eb)
+{
+#if defined(PLUGIN_WATCH) && defined(PLUGIN_DIR)
+    watchFd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+    if (watchFd < 0)
+    {
+        doLog (WARNING, LOG_COMP, _("Unable to initialise inotify; plugins won't be hot-reloaded."));
+        return -1;
+    }
+
+    if (inotify_add_watch (watchFd, PLUGIN_PATH, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        doLog (WARNING, LOG_COMP, _("Unable to watch %s; plugins won't be hot-reloaded."),
+               PLUGIN_PATH);
+        close (watchFd);
+        watchFd = -1;
+        return -1;
+    }
+
+    watchEv = event_new (eb, watchFd, EV_READ | EV_PERSIST, readPluginWatch, NULL);
+    settleEv = evtimer_new (eb, settlePluginWatch, NULL);
+    event_add (watchEv, NULL);
+
+    return 0;
+#else
+    doLog (NOTICE, LOG_COMP, _("Plugin hot-reloading not available on this platform."));
+    return -1;
+#endif
+}
+
+
+void
+closePluginWatch ()
+{
+#ifdef PLUGIN_WATCH
+    if (watchFd < 0)
+        return;
+
+    event_del (watchEv);
+    event_free (watchEv);
+    evtimer_del (settleEv);
+    event_free (settleEv);
+    close (watchFd);
+    watchFd = -1;
+    watchNumPending = 0;
+#endif
+}
+
+
 /*
   * This function provides a way of opening and parsing out
   *an include file named "Client.json" in each plugin
@@ -28,6 +28,15 @@ loadPluginsDirectory ();
 int
 loadPlugins_static ();
 
+int
+loadPlugin (const char* pluginName);
+
+int
+openPluginWatch (struct event_base* eb);
+
+void
+closePluginWatch ();
+
 
 int
 getPluginWebIncludes (struct evbuffer* target,
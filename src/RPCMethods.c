@@ -0,0 +1,287 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "RPCMethods.h"
+#include "Logging.h"
+
+/* Gettext stuff */
+#ifndef HW_RVL
+#include <libintl.h>
+#define _(String) gettext (String)
+#else
+#define _(String) String
+#endif
+
+/* Name of this component for logging */
+static const char LOG_COMP[] = "RPCMethods.c";
+
+/* Removed slots keep probing chains intact */
+static char TOMB_NAME[] = "";
+
+static struct LSD_RPCMethod* slots = NULL;
+static size_t capacity = 0;
+static size_t count = 0;
+static size_t used = 0; /* count + tombstones */
+
+
+/* FNV-1a over the lowercased name */
+static size_t
+hashName (const char* name, size_t cap)
+{
+    uint32_t h = 2166136261u;
+    for (; *name; ++name)
+    {
+        h ^= (uint32_t)tolower ((unsigned char)*name);
+        h *= 16777619u;
+    }
+    return h & ( cap - 1 );
+}
+
+
+static int
+isLive (struct LSD_RPCMethod const* slot)
+{
+    return slot->name && slot->name != TOMB_NAME;
+}
+
+
+static void
+dropSlot (struct LSD_RPCMethod* slot)
+{
+    free (slot->name);
+    slot->name = TOMB_NAME;
+    slot->func = NULL;
+    slot->streamFunc = NULL;
+    slot->plugin = NULL;
+    slot->flags = 0;
+    --count;
+}
+
+
+static int
+rehash (size_t newCap)
+{
+    struct LSD_RPCMethod* newSlots = calloc (newCap,
+                                             sizeof( struct LSD_RPCMethod ));
+    if (!newSlots)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to allocate slots in rehash()."));
+        return -1;
+    }
+
+    size_t i;
+    for (i = 0; i < capacity; ++i)
+    {
+        if (!isLive (&slots[i]))
+            continue;
+
+        size_t j = hashName (slots[i].name, newCap);
+        while (newSlots[j].name)
+            j = ( j + 1 ) & ( newCap - 1 );
+        newSlots[j] = slots[i];
+    }
+
+    free (slots);
+    slots = newSlots;
+    capacity = newCap;
+    used = count;
+
+    return 0;
+}
+
+
+int
+lsdrpc_initMethods (size_t initCap)
+{
+    lsdrpc_finishMethods ();
+
+    size_t cap = 16;
+    while (cap < initCap * 2)
+        cap <<= 1;
+
+    slots = calloc (cap, sizeof( struct LSD_RPCMethod ));
+    if (!slots)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to allocate slots in lsdrpc_initMethods()."));
+        return -1;
+    }
+    capacity = cap;
+    count = 0;
+    used = 0;
+
+    return 0;
+}
+
+
+void
+lsdrpc_finishMethods ()
+{
+    size_t i;
+    for (i = 0; i < capacity; ++i)
+        if (isLive (&slots[i]))
+            free (slots[i].name);
+
+    free (slots);
+    slots = NULL;
+    capacity = 0;
+    count = 0;
+    used = 0;
+}
+
+
+static int
+insertMethod (const char* name, rpcMethodFunc func, rpcStreamFunc streamFunc,
+              struct LSD_ScenePlugin const* plugin, int flags)
+{
+    if (!slots || !name || !*name || ( !func && !streamFunc ))
+    {
+        doLog (ERROR, LOG_COMP, _("Invalid arguments passed to insertMethod()."));
+        return -1;
+    }
+
+    if (lsdrpc_lookupMethod (name))
+    {
+        doLog (ERROR, LOG_COMP, _("RPC method %s is already registered."), name);
+        return -1;
+    }
+
+    /* Keep load (including tombstones) under 50% */
+    if (( used + 1 ) * 2 > capacity)
+    {
+        size_t newCap = capacity;
+        if (( count + 1 ) * 4 > capacity)
+            newCap <<= 1;
+        if (rehash (newCap) < 0)
+            return -1;
+    }
+
+    char* nameCopy = malloc (strlen (name) + 1);
+    if (!nameCopy)
+    {
+        doLog (ERROR, LOG_COMP, _("Unable to allocate name in insertMethod()."));
+        return -1;
+    }
+    strcpy (nameCopy, name);
+
+    size_t i = hashName (name, capacity);
+    while (isLive (&slots[i]))
+        i = ( i + 1 ) & ( capacity - 1 );
+
+    if (!slots[i].name)
+        ++used;
+    slots[i].name = nameCopy;
+    slots[i].func = func;
+    slots[i].streamFunc = streamFunc;
+    slots[i].plugin = plugin;
+    slots[i].flags = flags;
+    ++count;
+
+    return 0;
+}
+
+
+int
+lsdrpc_registerMethod (const char* name, rpcMethodFunc func,
+                       struct LSD_ScenePlugin const* plugin, int flags)
+{
+    if (!func)
+    {
+        doLog (ERROR, LOG_COMP, _("Invalid arguments passed to lsdrpc_registerMethod()."));
+        return -1;
+    }
+
+    return insertMethod (name, func, NULL, plugin, flags);
+}
+
+
+int
+lsdrpc_registerStreamMethod (const char* name, rpcStreamFunc streamFunc,
+                             int flags)
+{
+    if (!streamFunc)
+    {
+        doLog (ERROR, LOG_COMP, _("Invalid arguments passed to lsdrpc_registerStreamMethod()."));
+        return -1;
+    }
+
+    return insertMethod (name, NULL, streamFunc, NULL, flags);
+}
+
+
+struct LSD_RPCMethod const*
+lsdrpc_lookupMethod (const char* name)
+{
+    if (!slots || !name)
+        return NULL;
+
+    size_t i = hashName (name, capacity);
+    while (slots[i].name)
+    {
+        if (slots[i].name != TOMB_NAME && strcasecmp (slots[i].name, name) == 0)
+            return &slots[i];
+        i = ( i + 1 ) & ( capacity - 1 );
+    }
+
+    return NULL;
+}
+
+
+size_t
+lsdrpc_unregisterPlugin (struct LSD_ScenePlugin const* plugin)
+{
+    if (!plugin)
+        return 0;
+
+    size_t dropped = 0;
+    size_t i;
+    for (i = 0; i < capacity; ++i)
+        if (isLive (&slots[i]) && slots[i].plugin == plugin)
+        {
+            dropSlot (&slots[i]);
+            ++dropped;
+        }
+
+    return dropped;
+}
+
+
+size_t
+lsdrpc_clearPluginMethods ()
+{
+    size_t dropped = 0;
+    size_t i;
+    for (i = 0; i < capacity; ++i)
+        if (isLive (&slots[i]) && slots[i].plugin)
+        {
+            dropSlot (&slots[i]);
+            ++dropped;
+        }
+
+    return dropped;
+}
+
+
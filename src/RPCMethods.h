@@ -0,0 +1,90 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+
+#ifndef RPCMETHODS_H
+#define RPCMETHODS_H
+
+#include <stdlib.h>
+#include "cJSON.h"
+#include "PluginAPI.h"
+#include "JsonWriter.h"
+
+/**
+  * Method table for the JSON RPC. Core methods are registered
+  *when the RPC opens; plugins register theirs from their init
+  *funcs and lose them when unloaded. Names are matched without
+  *regard to case, through an open-addressing hash table.
+  *
+  * Core methods with large responses may instead be stream
+  *methods, writing their members straight into the reply
+  *object; they return -1 after writing an "error" member.
+  */
+typedef int (*rpcStreamFunc)(cJSON* req, struct LSD_JsonWriter* resp);
+
+struct LSD_RPCMethod
+{
+    char* name;
+    rpcMethodFunc func; /* NULL for stream methods */
+    rpcStreamFunc streamFunc;
+    struct LSD_ScenePlugin const* plugin; /* NULL for core */
+    int flags; /* LSD_RPC_* */
+};
+
+int
+lsdrpc_initMethods (size_t initCap);
+
+
+void
+lsdrpc_finishMethods ();
+
+
+/* Fails if name is already taken */
+int
+lsdrpc_registerMethod (const char* name, rpcMethodFunc func,
+                       struct LSD_ScenePlugin const* plugin, int flags);
+
+
+/* Registers a core stream method; fails if name is taken */
+int
+lsdrpc_registerStreamMethod (const char* name, rpcStreamFunc streamFunc,
+                             int flags);
+
+
+/* Returns NULL if no such method */
+struct LSD_RPCMethod const*
+lsdrpc_lookupMethod (const char* name);
+
+
+/* Drops every method registered by plugin; returns the number
+ * dropped */
+size_t
+lsdrpc_unregisterPlugin (struct LSD_ScenePlugin const* plugin);
+
+
+/* Drops every plugin method, ahead of a reload re-registering
+ * them */
+size_t
+lsdrpc_clearPluginMethods ();
+
+
+#endif /* RPCMETHODS_H */
@@ -0,0 +1,267 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ReloadStats.h"
+#include "Logging.h"
+#include "Metrics.h"
+
+/* Gettext stuff */
+#ifndef HW_RVL
+#include <libintl.h>
+#define _(String) gettext (String)
+#else
+#define _(String) String
+#endif
+
+/* Name of this component for logging */
+static const char LOG_COMP[] = "ReloadStats.c";
+
+#define MAX_PHASES 16
+#define MAX_PLUGINS 32
+#define MAX_CLASSES 64
+
+struct LSD_ReloadPhase
+{
+    const char* name;
+    long usec;
+};
+
+struct LSD_ReloadPlugin
+{
+    char name[64];
+    long usec;
+};
+
+struct LSD_ReloadClass
+{
+    int classId;
+    int count;
+    long usec;
+};
+
+struct LSD_ReloadRecord
+{
+    int seq;
+    time_t started;
+    long totalUsec;
+    size_t phaseCount;
+    size_t pluginCount;
+    size_t classCount;
+    struct LSD_ReloadPhase phases[MAX_PHASES];
+    struct LSD_ReloadPlugin plugins[MAX_PLUGINS];
+    struct LSD_ReloadClass classes[MAX_CLASSES];
+};
+
+static struct LSD_ReloadRecord history[RELOAD_HISTORY];
+static size_t historyLen = 0;
+static size_t historyNext = 0;
+
+/* Record being filled; only valid while active */
+static struct LSD_ReloadRecord cur;
+static int active = 0;
+static int seq = 0;
+static struct timeval startTime;
+static struct timeval markTime;
+
+
+long
+lsdstats_since (struct timeval const* start)
+{
+    struct timeval now;
+    gettimeofday (&now, NULL);
+    return ( now.tv_sec - start->tv_sec ) * 1000000 +
+           ( now.tv_usec - start->tv_usec );
+}
+
+
+void
+lsdstats_beginReload ()
+{
+    memset (&cur, 0, sizeof( struct LSD_ReloadRecord ));
+    cur.seq = ++seq;
+    gettimeofday (&startTime, NULL);
+    markTime = startTime;
+    cur.started = startTime.tv_sec;
+    active = 1;
+}
+
+
+void
+lsdstats_phase (const char* name)
+{
+    if (!active)
+        return;
+
+    long usec = lsdstats_since (&markTime);
+    gettimeofday (&markTime, NULL);
+
+    if (cur.phaseCount < MAX_PHASES)
+    {
+        cur.phases[cur.phaseCount].name = name;
+        cur.phases[cur.phaseCount].usec = usec;
+        ++cur.phaseCount;
+    }
+}
+
+
+void
+lsdstats_plugin (const char* name, long usec)
+{
+    if (!active || !name || cur.pluginCount >= MAX_PLUGINS)
+        return;
+
+    struct LSD_ReloadPlugin* plug = &cur.plugins[cur.pluginCount++];
+    snprintf (plug->name, sizeof( plug->name ), "%s", name);
+    plug->usec = usec;
+}
+
+
+void
+lsdstats_restore (int classId, long usec)
+{
+    if (!active)
+        return;
+
+    size_t i;
+    for (i = 0; i < cur.classCount; ++i)
+        if (cur.classes[i].classId == classId)
+            break;
+
+    if (i == cur.classCount)
+    {
+        if (cur.classCount >= MAX_CLASSES)
+            return;
+        cur.classes[i].classId = classId;
+        ++cur.classCount;
+    }
+
+    ++cur.classes[i].count;
+    cur.classes[i].usec += usec;
+}
+
+
+void
+lsdstats_endReload ()
+{
+    if (!active)
+        return;
+    active = 0;
+    cur.totalUsec = lsdstats_since (&startTime);
+    lsdmetrics_reload (cur.totalUsec);
+
+    /* One line for the phases, then plugins and classes */
+    char line[512];
+    size_t len = 0;
+    size_t i;
+    for (i = 0; i < cur.phaseCount && len < sizeof( line ); ++i)
+        len += snprintf (line + len, sizeof( line ) - len, "%s%s %.1f",
+                         i ? ", " : "", cur.phases[i].name,
+                         cur.phases[i].usec / 1000.0);
+    if (len == 0)
+        line[0] = '\0';
+
+    doLog (NOTICE, LOG_COMP, _("Reload %d took %.1f ms (%s)."),
+           cur.seq, cur.totalUsec / 1000.0, line);
+
+    for (i = 0; i < cur.pluginCount; ++i)
+        doLog (NOTICE, LOG_COMP, _("Reload %d: plugin %s loaded in %.1f ms."),
+               cur.seq, cur.plugins[i].name, cur.plugins[i].usec / 1000.0);
+
+    for (i = 0; i < cur.classCount; ++i)
+        doLog (NOTICE, LOG_COMP, _("Reload %d: class %d restored %d insts in %.1f ms."),
+               cur.seq, cur.classes[i].classId, cur.classes[i].count,
+               cur.classes[i].usec / 1000.0);
+
+    history[historyNext] = cur;
+    historyNext = ( historyNext + 1 ) % RELOAD_HISTORY;
+    if (historyLen < RELOAD_HISTORY)
+        ++historyLen;
+}
+
+
+int
+lsdstats_json (cJSON* target, int count)
+{
+    if (!target)
+        return -1;
+
+    if (count <= 0 || count > (int)historyLen)
+        count = historyLen;
+
+    cJSON* reloadArr = cJSON_CreateArray ();
+
+    int n;
+    for (n = 0; n < count; ++n)
+    {
+        struct LSD_ReloadRecord* rec =
+            &history[( historyNext + RELOAD_HISTORY - 1 - n ) % RELOAD_HISTORY];
+
+        cJSON* recObj = cJSON_CreateObject ();
+        cJSON_AddNumberToObject (recObj, "seq", rec->seq);
+        cJSON_AddNumberToObject (recObj, "started", (double)rec->started);
+        cJSON_AddNumberToObject (recObj, "totalUsec", rec->totalUsec);
+
+        size_t i;
+        cJSON* phaseArr = cJSON_CreateArray ();
+        for (i = 0; i < rec->phaseCount; ++i)
+        {
+            cJSON* phaseObj = cJSON_CreateObject ();
+            cJSON_AddStringToObject (phaseObj, "phase", rec->phases[i].name);
+            cJSON_AddNumberToObject (phaseObj, "usec", rec->phases[i].usec);
+            cJSON_AddItemToArray (phaseArr, phaseObj);
+        }
+        cJSON_AddItemToObject (recObj, "phases", phaseArr);
+
+        cJSON* pluginArr = cJSON_CreateArray ();
+        for (i = 0; i < rec->pluginCount; ++i)
+        {
+            cJSON* pluginObj = cJSON_CreateObject ();
+            cJSON_AddStringToObject (pluginObj, "plugin", rec->plugins[i].name);
+            cJSON_AddNumberToObject (pluginObj, "usec", rec->plugins[i].usec);
+            cJSON_AddItemToArray (pluginArr, pluginObj);
+        }
+        cJSON_AddItemToObject (recObj, "plugins", pluginArr);
+
+        cJSON* classArr = cJSON_CreateArray ();
+        for (i = 0; i < rec->classCount; ++i)
+        {
+            cJSON* classObj = cJSON_CreateObject ();
+            cJSON_AddNumberToObject (classObj, "classId", rec->classes[i].classId);
+            cJSON_AddNumberToObject (classObj, "insts", rec->classes[i].count);
+            cJSON_AddNumberToObject (classObj, "usec", rec->classes[i].usec);
+            cJSON_AddItemToArray (classArr, classObj);
+        }
+        cJSON_AddItemToObject (recObj, "restores", classArr);
+
+        cJSON_AddItemToArray (reloadArr, recObj);
+    }
+
+    cJSON_AddItemToObject (target, "reloads", reloadArr);
+
+    return 0;
+}
+
+
@@ -0,0 +1,75 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+
+#ifndef RELOADSTATS_H
+#define RELOADSTATS_H
+
+#include <sys/time.h>
+#include "cJSON.h"
+
+/**
+  * Per-phase timing of the scene reload loop. SceneCore marks
+  *the end of each phase; the plugin loader and node restore
+  *paths report their own times while a reload is running. The
+  *last RELOAD_HISTORY reloads are kept for the RPC.
+  */
+#define RELOAD_HISTORY 8
+
+/* Starts timing a reload; the first phase begins now */
+void
+lsdstats_beginReload ();
+
+
+/* Ends the current phase under name and begins the next */
+void
+lsdstats_phase (const char* name);
+
+
+/* Adds time spent loading a plugin (ignored outside a reload) */
+void
+lsdstats_plugin (const char* name, long usec);
+
+
+/* Adds time spent in one restore func of a class (ignored
+ * outside a reload) */
+void
+lsdstats_restore (int classId, long usec);
+
+
+/* Closes the reload, logs its summary and files it in history */
+void
+lsdstats_endReload ();
+
+
+/* Microseconds elapsed since start */
+long
+lsdstats_since (struct timeval const* start);
+
+
+/* Adds the most recent reloads (newest first, at most count)
+ * to target as "reloads" */
+int
+lsdstats_json (cJSON* target, int count);
+
+
+#endif /* RELOADSTATS_H */
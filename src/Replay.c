@@ -0,0 +1,450 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+
+/* Replays RPC traffic recorded with `lsd -r file` against a
+ * running daemon and reports how it coped. Built with
+ * `make replay`.
+ *
+ *   lsdreplay [-H host] [-p port] [-P prefix] [-s speedup]
+ *             [-c connections] recordfile
+ *
+ * Requests keep their recorded spacing divided by speedup (0
+ * sends them as fast as the connections allow), with at most
+ * one request in flight per connection. The daemon's /metrics
+ * are read before and after, and one JSON object is printed:
+ * client-side latency percentiles of the successful requests
+ * alongside the frame timing the daemon saw during the run.
+ *
+ * Mutating requests change the daemon's scene; replay against
+ * a copy of the show that was recorded. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <event.h>
+#include <evhttp.h>
+
+#define MAX_CONNS 64
+#define MAX_FRAME_BUCKETS 16
+
+struct ReplayRecord
+{
+    long usec;
+    char* body;
+};
+
+struct ReplayConn
+{
+    struct evhttp_connection* conn;
+    int busy;
+    double sentNs;
+};
+
+/* Frame timing counters scraped from /metrics */
+struct FrameStats
+{
+    int numBuckets;
+    double bounds[MAX_FRAME_BUCKETS];
+    double buckets[MAX_FRAME_BUCKETS];
+    double sum;
+    double count;
+    double late;
+};
+
+static struct event_base* eb;
+static struct event* pumpEv;
+static const char* host = "127.0.0.1";
+static int port = 9196;
+static char rpcPath[256];
+static double speedup = 1.0;
+static int numConns = 4;
+
+static struct ReplayRecord* records = NULL;
+static long numRecords = 0;
+static long nextRecord = 0;
+static int inFlight = 0;
+
+static struct ReplayConn conns[MAX_CONNS];
+static double startNs;
+/* Latencies of successful requests only, so failures that
+ * return early can't drag the percentiles down */
+static double* latencies;
+static long numOk = 0;
+static long errors = 0;
+static double maxBehindNs = 0;
+
+
+static double
+nowNs ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+
+static int
+loadRecords (const char* path)
+{
+    FILE* file = fopen (path, "r");
+    if (!file)
+    {
+        fprintf (stderr, "Unable to open record file %s\n", path);
+        return -1;
+    }
+
+    long cap = 0;
+    char* line = NULL;
+    size_t lineCap = 0;
+    ssize_t len;
+    while (( len = getline (&line, &lineCap, file) ) > 0)
+    {
+        char* tab = strchr (line, '\t');
+        if (!tab)
+            continue;
+        if (line[len - 1] == '\n')
+            line[len - 1] = '\0';
+
+        if (numRecords == cap)
+        {
+            cap = cap ? cap * 2 : 256;
+            struct ReplayRecord* grown = realloc (records,
+                                                  cap * sizeof( struct ReplayRecord ));
+            if (!grown)
+                break;
+            records = grown;
+        }
+        records[numRecords].usec = atol (line);
+        records[numRecords].body = strdup (tab + 1);
+        ++numRecords;
+    }
+
+    free (line);
+    fclose (file);
+
+    if (!numRecords)
+    {
+        fprintf (stderr, "No requests in record file %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+
+static void
+fetchDone (struct evhttp_request* req, void* arg)
+{
+    char** out = arg;
+    if (req && evhttp_request_get_response_code (req) == 200)
+    {
+        struct evbuffer* buf = evhttp_request_get_input_buffer (req);
+        size_t len = evbuffer_get_length (buf);
+        *out = malloc (len + 1);
+        if (*out)
+        {
+            evbuffer_remove (buf, *out, len);
+            (*out)[len] = '\0';
+        }
+    }
+    event_base_loopexit (eb, NULL);
+}
+
+
+/* Blocking GET of path; returns a malloced body or NULL */
+static char*
+fetch (const char* path)
+{
+    char* body = NULL;
+    struct evhttp_connection* conn =
+        evhttp_connection_base_new (eb, NULL, host, port);
+    struct evhttp_request* req = evhttp_request_new (fetchDone, &body);
+    evhttp_add_header (evhttp_request_get_output_headers (req), "Host", host);
+    if (evhttp_make_request (conn, req, EVHTTP_REQ_GET, path) == 0)
+        event_base_dispatch (eb);
+    evhttp_connection_free (conn);
+    return body;
+}
+
+
+static int
+readFrameStats (struct FrameStats* stats)
+{
+    memset (stats, 0, sizeof( struct FrameStats ));
+    char* text = fetch ("/metrics");
+    if (!text)
+    {
+        fprintf (stderr, "Unable to read /metrics from %s:%d\n", host, port);
+        return -1;
+    }
+
+    char* line = text;
+    while (line && *line)
+    {
+        char* next = strchr (line, '\n');
+        if (next)
+            *next++ = '\0';
+
+        char le[32];
+        double val;
+        if (sscanf (line, "lsd_frame_seconds_bucket{le=\"%31[^\"]\"} %lf", le,
+                    &val) == 2)
+        {
+            if (stats->numBuckets < MAX_FRAME_BUCKETS)
+            {
+                stats->bounds[stats->numBuckets] =
+                    strcmp (le, "+Inf") == 0 ? -1 : atof (le);
+                stats->buckets[stats->numBuckets++] = val;
+            }
+        }
+        else if (sscanf (line, "lsd_frame_seconds_sum %lf", &val) == 1)
+            stats->sum = val;
+        else if (sscanf (line, "lsd_frame_seconds_count %lf", &val) == 1)
+            stats->count = val;
+        else if (sscanf (line, "lsd_late_frames_total %lf", &val) == 1)
+            stats->late = val;
+
+        line = next;
+    }
+
+    free (text);
+    return 0;
+}
+
+
+static void pump (evutil_socket_t fd, short what, void* arg);
+
+static void
+rpcDone (struct evhttp_request* req, void* arg)
+{
+    struct ReplayConn* conn = arg;
+    if (!req || evhttp_request_get_response_code (req) != 200)
+        ++errors;
+    else
+        latencies[numOk++] = nowNs () - conn->sentNs;
+
+    conn->busy = 0;
+    --inFlight;
+    pump (-1, 0, NULL);
+}
+
+
+/* Sends every request that is due on free connections, then
+ * waits for the next one to fall due or a connection to free */
+static void
+pump (evutil_socket_t fd, short what, void* arg)
+{
+    int c;
+    for (c = 0; c < numConns && nextRecord < numRecords; ++c)
+    {
+        if (conns[c].busy)
+            continue;
+
+        double now = nowNs ();
+        double due = startNs;
+        if (speedup > 0)
+            due += ( records[nextRecord].usec - records[0].usec ) * 1e3 /
+                   speedup;
+        if (due > now)
+        {
+            struct timeval wait;
+            long waitUs = (long)( ( due - now ) / 1e3 ) + 1;
+            wait.tv_sec = waitUs / 1000000;
+            wait.tv_usec = waitUs % 1000000;
+            evtimer_add (pumpEv, &wait);
+            return;
+        }
+        if (now - due > maxBehindNs)
+            maxBehindNs = now - due;
+
+        struct evhttp_request* req = evhttp_request_new (rpcDone, &conns[c]);
+        struct evkeyvalq* headers = evhttp_request_get_output_headers (req);
+        evhttp_add_header (headers, "Host", host);
+        evhttp_add_header (headers, "Content-Type", "application/json");
+        const char* body = records[nextRecord].body;
+        evbuffer_add (evhttp_request_get_output_buffer (req), body,
+                      strlen (body));
+
+        conns[c].busy = 1;
+        ++nextRecord;
+        conns[c].sentNs = now;
+        ++inFlight;
+        if (evhttp_make_request (conns[c].conn, req, EVHTTP_REQ_POST,
+                                 rpcPath) < 0)
+        {
+            ++errors;
+            conns[c].busy = 0;
+            --inFlight;
+        }
+    }
+
+    if (nextRecord == numRecords && !inFlight)
+        event_base_loopexit (eb, NULL);
+}
+
+
+static int
+compareDouble (const void* a, const void* b)
+{
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return ( da > db ) - ( da < db );
+}
+
+
+/* Nearest-rank percentile of sorted vals */
+static double
+percentile (const double* vals, long n, double p)
+{
+    long rank = (long)( p * n + 0.999999 );
+    if (rank < 1)
+        rank = 1;
+    return vals[rank - 1];
+}
+
+
+/* Upper bound of the bucket holding the p-th frame in the run
+ * (-1 if it falls past the last finite bound or there were no
+ * frames) */
+static double
+frameBound (struct FrameStats const* before, struct FrameStats const* after,
+            double p)
+{
+    double frames = after->count - before->count;
+    if (frames <= 0)
+        return -1;
+
+    int i;
+    for (i = 0; i < after->numBuckets; ++i)
+        if (after->buckets[i] - before->buckets[i] >= p * frames)
+            return after->bounds[i];
+    return -1;
+}
+
+
+static void
+printBound (const char* key, double bound)
+{
+    if (bound < 0)
+        printf ("\"%s\":null", key);
+    else
+        printf ("\"%s\":%.3f", key, bound * 1e3);
+}
+
+
+int
+main (int argc, const char** argv)
+{
+    const char* prefix = "/lightshoppe";
+    const char* path = NULL;
+
+    int i;
+    for (i = 1; i < argc; ++i)
+    {
+        const char* val = ( i + 1 < argc ) ? argv[i + 1] : NULL;
+        if (strcmp (argv[i], "-H") == 0 && val)
+            host = argv[++i];
+        else if (strcmp (argv[i], "-p") == 0 && val)
+            port = atoi (argv[++i]);
+        else if (strcmp (argv[i], "-P") == 0 && val)
+            prefix = argv[++i];
+        else if (strcmp (argv[i], "-s") == 0 && val)
+            speedup = atof (argv[++i]);
+        else if (strcmp (argv[i], "-c") == 0 && val)
+            numConns = atoi (argv[++i]);
+        else if (argv[i][0] != '-' && !path)
+            path = argv[i];
+        else
+        {
+            path = NULL;
+            break;
+        }
+    }
+    if (!path || port <= 0 || speedup < 0 || numConns < 1 ||
+        numConns > MAX_CONNS)
+    {
+        fprintf (stderr, "Usage: lsdreplay [-H host] [-p port] [-P prefix] [-s speedup] [-c connections(1-%d)] recordfile\n",
+                 MAX_CONNS);
+        return 1;
+    }
+    snprintf (rpcPath, sizeof( rpcPath ), "%s/main/rpc", prefix);
+
+    if (loadRecords (path) < 0)
+        return 1;
+    latencies = calloc (numRecords, sizeof( double ));
+
+    eb = event_base_new ();
+    pumpEv = evtimer_new (eb, pump, NULL);
+
+    struct FrameStats before;
+    struct FrameStats after;
+    if (readFrameStats (&before) < 0)
+        return 1;
+
+    for (i = 0; i < numConns; ++i)
+        conns[i].conn = evhttp_connection_base_new (eb, NULL, host, port);
+
+    startNs = nowNs ();
+    pump (-1, 0, NULL);
+    event_base_dispatch (eb);
+    double elapsed = ( nowNs () - startNs ) / 1e9;
+
+    if (readFrameStats (&after) < 0)
+        return 1;
+
+    qsort (latencies, numOk, sizeof( double ), compareDouble);
+    double frames = after.count - before.count;
+
+    printf ("{\"requests\":%ld,\"ok\":%ld,\"errors\":%ld,\"seconds\":%.3f,\"rps\":%.1f,",
+            numRecords, numOk, errors, elapsed,
+            elapsed > 0 ? numRecords / elapsed : 0.0);
+    printf ("\"maxBehindMs\":%.3f,", maxBehindNs / 1e6);
+    if (numOk)
+        printf ("\"latencyMs\":{\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f},",
+                percentile (latencies, numOk, 0.5) / 1e6,
+                percentile (latencies, numOk, 0.9) / 1e6,
+                percentile (latencies, numOk, 0.99) / 1e6,
+                latencies[numOk - 1] / 1e6);
+    else
+        printf ("\"latencyMs\":null,");
+    printf ("\"frames\":{\"count\":%.0f,\"late\":%.0f,\"meanMs\":%.3f,",
+            frames, after.late - before.late,
+            frames > 0 ? ( after.sum - before.sum ) / frames * 1e3 : 0.0);
+    printBound ("p50UnderMs", frameBound (&before, &after, 0.5));
+    printf (",");
+    printBound ("p99UnderMs", frameBound (&before, &after, 0.99));
+    printf ("}}\n");
+
+    for (i = 0; i < numConns; ++i)
+        evhttp_connection_free (conns[i].conn);
+    event_free (pumpEv);
+    event_base_free (eb);
+    for (i = 0; i < numRecords; ++i)
+        free (records[i].body);
+    free (records);
+    free (latencies);
+
+    return errors ? 2 : 0;
+}
+
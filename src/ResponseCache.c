@@ -0,0 +1,143 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+
+#include <string.h>
+
+#include "ResponseCache.h"
+#include "Logging.h"
+
+/* Gettext stuff */
+#ifndef HW_RVL
+#include <libintl.h>
+#define _(String) gettext (String)
+#else
+#define _(String) String
+#endif
+
+/* Name of this component for logging */
+static const char LOG_COMP[] = "ResponseCache.c";
+
+#define CACHE_LEN 16
+
+struct CacheEntry
+{
+    char* key;
+    char* body;
+    size_t len;
+    unsigned long long ver;
+    unsigned long lastUse;
+};
+
+static struct CacheEntry entries[CACHE_LEN];
+static unsigned long useTick = 0;
+
+
+static struct CacheEntry*
+findEntry (const char* key)
+{
+    int i;
+    for (i = 0; i < CACHE_LEN; ++i)
+        if (entries[i].key && strcmp (entries[i].key, key) == 0)
+            return &entries[i];
+    return NULL;
+}
+
+
+static void
+freeEntry (struct CacheEntry* ent)
+{
+    free (ent->key);
+    free (ent->body);
+    memset (ent, 0, sizeof( struct CacheEntry ));
+}
+
+
+const char*
+lsdcache_get (const char* key, unsigned long long ver, size_t* len)
+{
+    if (!key)
+        return NULL;
+
+    struct CacheEntry* ent = findEntry (key);
+    if (!ent || ent->ver != ver)
+        return NULL;
+
+    ent->lastUse = ++useTick;
+    if (len)
+        *len = ent->len;
+    return ent->body;
+}
+
+
+void
+lsdcache_put (const char* key, unsigned long long ver,
+              const char* body, size_t len)
+{
+    if (!key || !body)
+        return;
+
+    /* Reuse the key's slot, else an empty one, else the least
+     * recently used */
+    struct CacheEntry* ent = findEntry (key);
+    if (!ent)
+    {
+        int i;
+        ent = &entries[0];
+        for (i = 0; i < CACHE_LEN; ++i)
+        {
+            if (!entries[i].key)
+            {
+                ent = &entries[i];
+                break;
+            }
+            if (entries[i].lastUse < ent->lastUse)
+                ent = &entries[i];
+        }
+    }
+    freeEntry (ent);
+
+    ent->key = malloc (strlen (key) + 1);
+    ent->body = malloc (len);
+    if (!ent->key || !ent->body)
+    {
+        doLog (WARNING, LOG_COMP, _("Unable to allocate response cache entry."));
+        freeEntry (ent);
+        return;
+    }
+    strcpy (ent->key, key);
+    memcpy (ent->body, body, len);
+    ent->len = len;
+    ent->ver = ver;
+    ent->lastUse = ++useTick;
+}
+
+
+void
+lsdcache_clear ()
+{
+    int i;
+    for (i = 0; i < CACHE_LEN; ++i)
+        freeEntry (&entries[i]);
+}
+
+
@@ -0,0 +1,51 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+
+#ifndef RESPONSECACHE_H
+#define RESPONSECACHE_H
+
+#include <stdlib.h>
+
+/**
+  * Serialized RPC responses, keyed by the request text and
+  *tagged with the state version they were built at. An entry
+  *is only returned while that version is current, so nothing
+  *needs invalidating; stale entries are simply replaced.
+  */
+
+/* Returns the body cached for key at ver (length in len), or
+ * NULL; the body stays valid until the next lsdcache_put () */
+const char*
+lsdcache_get (const char* key, unsigned long long ver, size_t* len);
+
+
+void
+lsdcache_put (const char* key, unsigned long long ver,
+              const char* body, size_t len);
+
+
+void
+lsdcache_clear ();
+
+
+#endif /* RESPONSECACHE_H */
@@ -0,0 +1,172 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+#include <string.h>
+
+#include "SHA1.h"
+
+#define ROL(v,n) ( ( (v) << (n) ) | ( (v) >> ( 32 - (n) ) ) )
+
+static void
+sha1Block (uint32_t* state, const uint8_t* block)
+{
+    uint32_t w[80];
+    int i;
+    for (i = 0; i < 16; ++i)
+        w[i] = ( (uint32_t)block[i * 4] << 24 ) |
+               ( (uint32_t)block[i * 4 + 1] << 16 ) |
+               ( (uint32_t)block[i * 4 + 2] << 8 ) |
+               (uint32_t)block[i * 4 + 3];
+    for (; i < 80; ++i)
+        w[i] = ROL (w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+             e = state[4];
+    for (i = 0; i < 80; ++i)
+    {
+        uint32_t f, k;
+        if (i < 20)
+        {
+            f = ( b & c ) | ( ~b & d );
+            k = 0x5A827999;
+        }
+        else if (i < 40)
+        {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        }
+        else if (i < 60)
+        {
+            f = ( b & c ) | ( b & d ) | ( c & d );
+            k = 0x8F1BBCDC;
+        }
+        else
+        {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+
+        uint32_t t = ROL (a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = ROL (b, 30);
+        b = a;
+        a = t;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+
+void
+lsdsha1_init (struct LSD_SHA1* ctx)
+{
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xEFCDAB89;
+    ctx->state[2] = 0x98BADCFE;
+    ctx->state[3] = 0x10325476;
+    ctx->state[4] = 0xC3D2E1F0;
+    ctx->length = 0;
+    ctx->bufLen = 0;
+}
+
+
+void
+lsdsha1_update (struct LSD_SHA1* ctx, const void* data, size_t len)
+{
+    const uint8_t* in = data;
+    ctx->length += len;
+
+    /* Top up a partial block first */
+    if (ctx->bufLen)
+    {
+        size_t take = 64 - ctx->bufLen;
+        if (take > len)
+            take = len;
+        memcpy (ctx->buf + ctx->bufLen, in, take);
+        ctx->bufLen += take;
+        in += take;
+        len -= take;
+        if (ctx->bufLen < 64)
+            return;
+        sha1Block (ctx->state, ctx->buf);
+        ctx->bufLen = 0;
+    }
+
+    /* Whole blocks straight from the input */
+    for (; len >= 64; in += 64, len -= 64)
+        sha1Block (ctx->state, in);
+
+    memcpy (ctx->buf, in, len);
+    ctx->bufLen = len;
+}
+
+
+void
+lsdsha1_final (struct LSD_SHA1* ctx, uint8_t* out)
+{
+    uint64_t bits = ctx->length * 8;
+
+    ctx->buf[ctx->bufLen++] = 0x80;
+    if (ctx->bufLen > 56)
+    {
+        memset (ctx->buf + ctx->bufLen, 0, 64 - ctx->bufLen);
+        sha1Block (ctx->state, ctx->buf);
+        ctx->bufLen = 0;
+    }
+    memset (ctx->buf + ctx->bufLen, 0, 56 - ctx->bufLen);
+
+    int i;
+    for (i = 0; i < 8; ++i)
+        ctx->buf[56 + i] = (uint8_t)( bits >> ( 56 - i * 8 ) );
+    sha1Block (ctx->state, ctx->buf);
+
+    for (i = 0; i < 20; ++i)
+        out[i] = (uint8_t)( ctx->state[i / 4] >> ( 24 - ( i % 4 ) * 8 ) );
+}
+
+
+void
+lsdsha1_hex (const void* data, size_t len, char* hexOut)
+{
+    static const char HEX[] = "0123456789abcdef";
+    struct LSD_SHA1 ctx;
+    uint8_t digest[20];
+
+    lsdsha1_init (&ctx);
+    lsdsha1_update (&ctx, data, len);
+    lsdsha1_final (&ctx, digest);
+
+    int i;
+    for (i = 0; i < 20; ++i)
+    {
+        hexOut[i * 2] = HEX[digest[i] >> 4];
+        hexOut[i * 2 + 1] = HEX[digest[i] & 0xf];
+    }
+    hexOut[40] = '\0';
+}
+
+
@@ -0,0 +1,59 @@
+/*
+ **    This file is part of LightShoppe. Copyright 2011 Jack Andersen
+ **
+ **    LightShoppe is free software: you can redistribute it
+ **    and/or modify it under the terms of the GNU General
+ **    Public License as published by the Free Software
+ **    Foundation, either version 3 of the License, or (at your
+ **    option) any later version.
+ **
+ **    LightShoppe is distributed in the hope that it will
+ **    be useful, but WITHOUT ANY WARRANTY; without even the
+ **    implied warranty of MERCHANTABILITY or FITNESS FOR A
+ **    PARTICULAR PURPOSE.  See the GNU General Public License
+ **    for more details.
+ **
+ **    You should have received a copy of the GNU General
+ **    Public License along with LightShoppe.  If not, see
+ **    <http://www.gnu.org/licenses/>.
+ **
+ **    @author Jack Andersen <jackoalan@gmail.com>
+ */
+
+#ifndef SHA1_H
+#define SHA1_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/**
+  * Minimal FIPS 180-1 SHA-1, used to fingerprint plugin
+  *shared objects without shelling out to sha1sum.
+  */
+struct LSD_SHA1
+{
+    uint32_t state[5];
+    uint64_t length; /* bytes hashed so far */
+    size_t bufLen;
+    uint8_t buf[64];
+};
+
+void
+lsdsha1_init (struct LSD_SHA1* ctx);
+
+
+void
+lsdsha1_update (struct LSD_SHA1* ctx, const void* data, size_t len);
+
+
+/* Writes the 20-byte digest to out */
+void
+lsdsha1_final (struct LSD_SHA1* ctx, uint8_t* out);
+
+
+/* One-shot digest of data as 40 lowercase hex chars plus NUL */
+void
+lsdsha1_hex (const void* data, size_t len, char* hexOut);
+
+
+#endif /* SHA1_H */
@@ -32,6 +32,11 @@
 #include "Node.h"
 #include "Logging.h"
 #include "DBOps.h"
+#include "ReloadStats.h"
+#include "RPCMethods.h"
+#include "LiveStream.h"
+#include "ControlPort.h"
+#include "Metrics.h"
 #include "cJSON.h"
 
 #include <stdio.h>
@@ -43,6 +48,7 @@
 #include <sys/types.h>
 #ifndef HW_RVL
 #include <pwd.h>
+#include <pthread.h>
 #else
 #include <gctypes.h>
 #include <wiiuse/wpad.h>
@@ -95,6 +101,40 @@ static struct event* updEv;
 /* Absolute timeval indicating when last update began */
 static struct timeval lastUpdLi;
 
+/* Event which incrementally writes the memory DB back to
+ * its file between frames */
+static struct event* persistEv;
+
+/* Seconds between persistence checks (0 disables) */
+static int persistInt;
+
+/* File the memory DB persists to */
+static const char* persistPath;
+
+/* Pages copied per persistence step and delay between steps
+ * (microseconds) while a save is in progress */
+static const int PERSIST_PAGES = 64;
+static const int PERSIST_STEP_INT = 2000;
+
+/* Set while the live generation renders on its own thread */
+static int renderActive = 0;
+
+#ifndef HW_RVL
+/* The render thread holds sceneLock for the span of a frame.
+ * The main thread owns the DB and event base and takes it only
+ * around in-memory edits of the scene, so they land between
+ * frames while the DB work around them does not stall one. It
+ * is recursive: an edit may run inside another that holds it */
+static pthread_t renderThread;
+static pthread_mutex_t sceneLock;
+static pthread_once_t sceneLockOnce = PTHREAD_ONCE_INIT;
+static int renderStop;
+
+/* Frames started a whole interval late since last logged; the
+ * main thread sums them into one line per update */
+static int lateFrames = 0;
+#endif
+
 /* Generates the default path to save the database */
 char const * 
 getHomeDBPath ()
@@ -138,7 +178,8 @@ rescheduleUpdate (struct event* ev, struct timeval* lastUpd, void ( *handler )(
 
     if (remTime.tv_usec < 0)  /* If we're behind schedule */
     {
-        doLog (WARNING, LOG_COMP, _("Lighting update behind schedule."));
+        if (!renderActive)
+            doLog (WARNING, LOG_COMP, _("Lighting update behind schedule."));
         handler (0, 0, NULL);
     }
     else
@@ -153,8 +194,57 @@ handleInterrupt (evutil_socket_t one, short int two, void* three)
 }
 
 
+#ifndef HW_RVL
+static void
+initSceneLock ()
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init (&attr);
+    pthread_mutexattr_settype (&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init (&sceneLock, &attr);
+    pthread_mutexattr_destroy (&attr);
+}
+#endif
+
+
+void
+lockScene ()
+{
+#ifndef HW_RVL
+    pthread_once (&sceneLockOnce, initSceneLock);
+    pthread_mutex_lock (&sceneLock);
+#endif
+}
+
+
+void
+unlockScene ()
+{
+#ifndef HW_RVL
+    pthread_mutex_unlock (&sceneLock);
+#endif
+}
+
+
+/* Evaluates and sends one frame of the live generation */
+static void
+renderFrame ()
+{
+    struct timeval start;
+    gettimeofday (&start, NULL);
+
+    node_incFrameCount ();
+    bufferUnivs ();
+    writeUnivs ();
+
+    lsdmetrics_frame (lsdstats_since (&start));
+}
+
+
 /* Function which ensures each partition's output buffer is
- * available */
+ * available. Frames are rendered on their own thread where
+ * there is one; this then only feeds live streams from the
+ * latest frame */
 void
 updateBuffers (evutil_socket_t one, short int two, void* three)
 {
@@ -171,9 +261,21 @@ updateBuffers (evutil_socket_t one, short int two, void* three)
     gettimeofday (&lastUpdLi, NULL);
 
     /* Do per-frame shite here */
-    node_incFrameCount ();
-    bufferUnivs ();
-    writeUnivs ();
+    lockScene ();
+    if (!renderActive)
+        renderFrame ();
+    lsdstream_frame ();
+#ifndef HW_RVL
+    int late = lateFrames;
+    lateFrames = 0;
+#endif
+    unlockScene ();
+
+#ifndef HW_RVL
+    if (late)
+        doLog (WARNING, LOG_COMP, _("Lighting update behind schedule (%d frames)."),
+               late);
+#endif
 
     /* Update timer for next interval occurance relative to
      * buffer start time */
@@ -182,6 +284,203 @@ updateBuffers (evutil_socket_t one, short int two, void* three)
 
 
 
+/* Advances the incremental DB save. When frames render on the
+ * main thread, a step is only taken in the first half of a
+ * frame interval so it never delays the next lighting update;
+ * otherwise it is retried shortly. */
+void
+persistDB (evutil_socket_t one, short int two, void* three)
+{
+    struct timeval curTime;
+    struct timeval next;
+    int rc = 1;
+
+    gettimeofday (&curTime, NULL);
+    long sinceUpd = ( curTime.tv_sec - lastUpdLi.tv_sec ) * 1000000 +
+                    ( curTime.tv_usec - lastUpdLi.tv_usec );
+
+    if (renderActive || sinceUpd < UPDATE_INT / 2)
+        rc = lsddb_persistStep (persistPath, PERSIST_PAGES);
+
+    if (rc > 0)
+    {
+        next.tv_sec = 0;
+        next.tv_usec = PERSIST_STEP_INT;
+    }
+    else
+    {
+        next.tv_sec = persistInt;
+        next.tv_usec = 0;
+    }
+    evtimer_add (persistEv, &next);
+}
+
+
+#ifndef HW_RVL
+/* Universe buffers of the last frame before a reload. They are
+ * sent again every frame from their own thread while the next
+ * generation is constructed on the main thread, so output holds
+ * steady rather than blacking out. The held frame is static:
+ * nothing else outlives the generation, as its nodes and
+ * plugins are cleaned up before the next ones load (see
+ * PluginAPI.h), so output stops animating until the new
+ * generation goes on air. */
+static struct LSD_ArrayHead heldUnivs;
+static pthread_t holdThread;
+static pthread_mutex_t holdLock = PTHREAD_MUTEX_INITIALIZER;
+static int holdActive = 0;
+static int holdStop;
+
+/* Sleeps until the frame interval after next, advancing it;
+ * returns 1 if that was already a whole interval ago */
+static int
+waitFrame (struct timeval* next)
+{
+    struct timeval curTime;
+
+    next->tv_usec += UPDATE_INT;
+    next->tv_sec += next->tv_usec / 1000000;
+    next->tv_usec %= 1000000;
+
+    gettimeofday (&curTime, NULL);
+    long remTime = ( next->tv_sec - curTime.tv_sec ) * 1000000 +
+                   ( next->tv_usec - curTime.tv_usec );
+    if (remTime > 0)
+        usleep (remTime);
+    else if (remTime < -UPDATE_INT)  /* Don't try to catch up */
+    {
+        *next = curTime;
+        return 1;
+    }
+
+    return 0;
+}
+
+
+static void*
+sendHeldFrame (void* arg)
+{
+    struct timeval next = lastUpdLi;
+
+    for (;;)
+    {
+        waitFrame (&next);
+
+        pthread_mutex_lock (&holdLock);
+        int stop = holdStop;
+        pthread_mutex_unlock (&holdLock);
+        if (stop)
+            break;
+
+        writeUnivArr (&heldUnivs);
+    }
+
+    return NULL;
+}
+
+
+/* Takes the universe buffers from the running generation and
+ * keeps sending them until releaseFrame () */
+static int
+holdFrame ()
+{
+    if (moveArray (&heldUnivs, getArr_lsdUnivArr ()) < 0)
+        return -1;
+
+    holdStop = 0;
+    if (pthread_create (&holdThread, NULL, sendHeldFrame, NULL) != 0)
+    {
+        doLog (WARNING, LOG_COMP, _("Unable to start thread holding the last frame."));
+        clearArray (&heldUnivs);
+        return -1;
+    }
+    holdActive = 1;
+
+    return 0;
+}
+
+
+/* Renders the live generation at UPDATE_INT, starting now */
+static void*
+renderLive (void* arg)
+{
+    struct timeval next;
+    gettimeofday (&next, NULL);
+
+    for (;;)
+    {
+        lockScene ();
+        int stop = renderStop;
+        if (!stop)
+            renderFrame ();
+        unlockScene ();
+        if (stop)
+            break;
+
+        if (waitFrame (&next))
+        {
+            lockScene ();
+            ++lateFrames;
+            unlockScene ();
+            lsdmetrics_lateFrame ();
+        }
+    }
+
+    return NULL;
+}
+
+
+/* Moves rendering of the live generation to its own thread;
+ * if that fails, updateBuffers () keeps rendering instead */
+static void
+startRender ()
+{
+    renderStop = 0;
+    if (pthread_create (&renderThread, NULL, renderLive, NULL) != 0)
+    {
+        doLog (WARNING, LOG_COMP, _("Unable to start render thread; rendering on the main thread."));
+        return;
+    }
+    renderActive = 1;
+}
+
+
+/* Stops the render thread at its next frame boundary */
+static void
+stopRender ()
+{
+    if (!renderActive)
+        return;
+
+    lockScene ();
+    renderStop = 1;
+    unlockScene ();
+    pthread_join (renderThread, NULL);
+    renderActive = 0;
+}
+
+
+/* Stops sending the held frame at its next frame boundary and
+ * frees it; the caller renders that frame from the new
+ * generation */
+static void
+releaseFrame ()
+{
+    if (!holdActive)
+        return;
+
+    pthread_mutex_lock (&holdLock);
+    holdStop = 1;
+    pthread_mutex_unlock (&holdLock);
+    pthread_join (holdThread, NULL);
+    holdActive = 0;
+
+    if (clearArray (&heldUnivs) < 0)
+        doLog (WARNING, LOG_COMP, _("There was a problem freeing the held frame."));
+}
+#endif
+
+
 void
 handleReload (evutil_socket_t ont, short int two, void* three)
 {
@@ -197,11 +496,22 @@ handleLogReopen (evutil_socket_t ont, short int two, void* three)
 
 
 int
-lsdSceneEntry (const char* dbpath, int rpcPort, const char* pathPrefix)
+lsdSceneEntry (const char* dbpath, int rpcPort, const char* pathPrefix,
+               int persistSecs, int directDB, int ctlPort,
+               const char* ctlAddr)
 {
     char const * HOME_DB = getHomeDBPath ();
     
-    if (!dbpath)
+    if (directDB)
+    {
+        doLog (NOTICE, LOG_COMP, _("Opening DB file directly."));
+        if (lsddb_openDirectDB (dbpath ? dbpath : HOME_DB) < 0)
+        {
+            doLog (ERROR, LOG_COMP, _("Unable to open DB file directly."));
+            return -1;
+        }
+    }
+    else if (!dbpath)
     {
         doLog (NOTICE, LOG_COMP, _("Checking for DB in home."));
         if (lsddb_openDB (HOME_DB) < 0){
@@ -251,6 +561,22 @@ lsdSceneEntry (const char* dbpath, int rpcPort, const char* pathPrefix)
         return -1;
     }
 
+#ifndef HW_RVL
+    /** WATCH FOR REBUILT PLUGINS **/
+    doLog (NOTICE, LOG_COMP, _("Watching plugin directory."));
+    openPluginWatch (ebMain);
+
+    /** OPEN UDP CONTROL PORT **/
+    if (ctlPort)
+    {
+        doLog (NOTICE, LOG_COMP, _("Opening control port."));
+        if (lsdctl_open (ebMain, ctlPort, ctlAddr) < 0)
+            doLog (WARNING, LOG_COMP,
+                   _("Unable to open control port %d. Continuing without it."),
+                   ctlPort);
+    }
+#endif
+
     /** OPEN OLA **/
     doLog (NOTICE, LOG_COMP, _("Starting OLA connection."));
     if (initDMX () < 0)
@@ -263,19 +589,34 @@ lsdSceneEntry (const char* dbpath, int rpcPort, const char* pathPrefix)
     doLog (NOTICE, LOG_COMP, _("Registering periodic lighting update."));
     updEv = evtimer_new (ebMain, updateBuffers, NULL);
 
+    /** REGISTER INCREMENTAL DB PERSISTENCE **/
+    persistInt = persistSecs;
+    persistPath = dbpath ? dbpath : HOME_DB;
+    persistEv = NULL;
+    if (persistInt > 0 && persistPath && !directDB)
+    {
+        doLog (NOTICE, LOG_COMP, _("Persisting DB every %d seconds."), persistInt);
+        persistEv = evtimer_new (ebMain, persistDB, NULL);
+        struct timeval first = {persistInt, 0};
+        evtimer_add (persistEv, &first);
+    }
+
     /** Reloader Loop **/
 
     reload = 1;
     while (reload)
     {
+        lsdstats_beginReload ();
 
         /** INIT GARBAGE COLLECTOR **/
         doLog (NOTICE, LOG_COMP, _("Initialising Garbage Collector."));
         lsdgc_prepGCOps ();
+        lsdstats_phase ("gcPrep");
 
         /** RESET DATABASE FOR FRESH STATE **/
         doLog (NOTICE, LOG_COMP, _("Resetting DB."));
         lsddb_resetDB ();
+        lsdstats_phase ("resetDB");
 
         /** INIT TIME **/
         lsdapi_setState (STATE_PINIT);
@@ -288,9 +629,14 @@ lsdSceneEntry (const char* dbpath, int rpcPort, const char* pathPrefix)
             doLog (ERROR, LOG_COMP, _("Error while establishing ArrayHeads."));
             return -1;
         }
+        lsdstats_phase ("initArrays");
 
         /** LOAD PLUGINS HERE **/
 
+        /* Methods of the previous generation's plugins; the
+         * plugins register them again as they load */
+        lsdrpc_clearPluginMethods ();
+
         /* Core Plugin */
         doLog (NOTICE, LOG_COMP, _("Loading core plugin head."));
         if (lsddb_pluginHeadLoader (getCoreHead, 1, "CORE", "0", NULL) < 0)
@@ -298,11 +644,13 @@ lsdSceneEntry (const char* dbpath, int rpcPort, const char* pathPrefix)
             doLog (ERROR, LOG_COMP, _("Unable to properly load core plugin."));
             return -1;
         }
+        lsdstats_phase ("corePlugin");
         
         /* Statically linked plugins */
         doLog (NOTICE, LOG_COMP, _("Loading static plugins."));
         if (loadPlugins_static () < 0)
             doLog (ERROR, LOG_COMP, _("Unable to get preloaded (static) plugins."));
+        lsdstats_phase ("staticPlugins");
 
 #ifndef HW_RVL
         /* Dynamically shared plugins */
@@ -311,6 +659,7 @@ lsdSceneEntry (const char* dbpath, int rpcPort, const char* pathPrefix)
             doLog (ERROR, LOG_COMP, _("Unable to initialise ltdl: %s."), lt_dlerror());
         else
             loadPluginsDirectory ();
+        lsdstats_phase ("sharedPlugins");
 #endif
 
 
@@ -319,6 +668,7 @@ lsdSceneEntry (const char* dbpath, int rpcPort, const char* pathPrefix)
         doLog (NOTICE, LOG_COMP, _("Structing partition array."));
         if (lsddb_structPartitionArr () < 0)
             doLog (ERROR, LOG_COMP, _("Unable to structPartitionArr()."));
+        lsdstats_phase ("partitions");
 
         /** STRUCT UNIV ARRAY **/
         doLog (NOTICE, LOG_COMP, _("Structing Universe array."));
@@ -327,6 +677,7 @@ lsdSceneEntry (const char* dbpath, int rpcPort, const char* pathPrefix)
             doLog (ERROR, LOG_COMP, _("Problem structing universe array."));
             return -1;
         }
+        lsdstats_phase ("universes");
 
         /** STRUCT CHANNEL ARRAY **/
         doLog (NOTICE, LOG_COMP, _("Structing Channel array."));
@@ -335,16 +686,50 @@ lsdSceneEntry (const char* dbpath, int rpcPort, const char* pathPrefix)
             doLog (ERROR, LOG_COMP, _("Problem structing channel array."));
             return -1;
         }
+        lsdstats_phase ("channels");
+
+        /** LAY OUT NODE ARRAYS IN EVALUATION ORDER **/
+        doLog (NOTICE, LOG_COMP, _("Compacting node arrays."));
+        if (lsddb_compactNodeArrays () < 0)
+            doLog (WARNING, LOG_COMP, _("Unable to compact node arrays."));
+        lsdstats_phase ("compact");
+
+        /** KEEP A SNAPSHOT FOR THE NEXT RELOAD **/
+        lsddb_takeSnapshot ();
+        lsdstats_phase ("snapshot");
+
+#ifndef HW_RVL
+        /** TAKE OVER FROM THE HELD FRAME **/
+        releaseFrame ();
+#endif
 
         /** Curtain Up **/
         lsdapi_setState (STATE_PRUN);
 
         /** BEGIN PARTITION BUFFER LOOP **/
         node_resetFrameCount ();
+#ifndef HW_RVL
+        startRender ();
+#endif
         updateBuffers (0, 0, NULL);
+
+        lsdstats_phase ("handover");
+        lsdstats_endReload ();
+
         doLog (NOTICE, LOG_COMP, _("Dispatching(Ctrl-c to quit)..."));
         event_base_dispatch (ebMain);
 
+#ifndef HW_RVL
+        stopRender ();
+
+        /** KEEP THE LAST FRAME ON AIR WHILE RELOADING **/
+        if (reload && holdFrame () == 0)
+            doLog (NOTICE, LOG_COMP, _("Holding last frame during reload."));
+
+        /** WRITE BACK CONTROL PORT VALUES BEFORE THE SCENE IS TORN DOWN **/
+        lsdctl_flush ();
+#endif
+
         /** CLEAN UP SHITE **/
         lsdapi_setState (STATE_PCLEAN);
 
@@ -352,7 +737,6 @@ lsdSceneEntry (const char* dbpath, int rpcPort, const char* pathPrefix)
         if (clearLsdArrays () < 0)
             doLog (WARNING, LOG_COMP, 
                    _("There was a problem cleaning up arrays. Continuing anyway."));
-        
 #ifndef HW_RVL
         /** DONE WITH LTDL **/
         lt_dlexit ();
@@ -372,11 +756,27 @@ lsdSceneEntry (const char* dbpath, int rpcPort, const char* pathPrefix)
     doLog (NOTICE, LOG_COMP, _("Closing HTTP RPC."));
     closeRPC ();
 
+#ifndef HW_RVL
+    /** Stop watching plugins **/
+    closePluginWatch ();
+
+    /** Close control port **/
+    lsdctl_close ();
+#endif
+
     /* Update Cleanup */
     doLog (NOTICE, LOG_COMP, _("Cleaning Lighting Update."));
     evtimer_del (updEv);
     event_free (updEv);
 
+    /* Persistence Cleanup */
+    if (persistEv)
+    {
+        evtimer_del (persistEv);
+        event_free (persistEv);
+    }
+    lsddb_persistFinish ();
+
     /* Signal cleanup */
 #ifndef HW_RVL
     doLog (NOTICE, LOG_COMP, _("Cleaning signal handlers."));
@@ -409,7 +809,8 @@ lsdSceneEntry (const char* dbpath, int rpcPort, const char* pathPrefix)
     return 0;
 }
 
-#ifndef HW_RVL
+/* The benchmark harness (Bench.c) provides its own main */
+#if !defined(HW_RVL) && !defined(LSD_BENCH)
 int
 main (int argc, const char** argv)
 {
@@ -422,18 +823,25 @@ main (int argc, const char** argv)
     int i;
     int verbose = 0;
     int rpcPort = 9196;
+    int persistSecs = 5;
+    int directDB = 0;
+    int ctlPort = 0;
+    const char* ctlAddr = NULL;
     const char* dbpath = NULL;
+    const char* recordPath = NULL;
     const char* pathPrefix = "/lightshoppe";
     if (argc > 0)
         for (i = 0; i < argc; ++i)
         {
             if (strncmp (argv[i], "-h", 2) == 0)
             {
-                printf (_("Usage: lsd [-hv] [-p port] [-P \"Path Prefix\"] [-d dbfile]\n"));
+                printf (_("Usage: lsd [-hv] [-p port] [-P \"Path Prefix\"] [-d dbfile] [-a seconds] [-u port [-U address]] [-r recordfile] [-w]\n"));
                 return 0;
             }
             else if (strncmp (argv[i], "-v", 2) == 0)
                 verbose = 1;
+            else if (strncmp (argv[i], "-w", 2) == 0)
+                directDB = 1;
             else if (strncmp (argv[i], "-d", 2) == 0)
             {
                 if (strlen(argv[i]) > 2)
@@ -486,14 +894,86 @@ main (int argc, const char** argv)
                     return -1;
                 }
             }
+            else if (strncmp (argv[i], "-a", 2) == 0)
+            {
+                const char* secStr;
+                if (strlen(argv[i]) > 2)
+                    secStr = argv[i]+2;
+                else if (i+1 < argc)
+                    secStr = argv[i+1];
+                else
+                {
+                    printf (_("Missing seconds value for -a.\n"));
+                    return -1;
+                }
+                
+                persistSecs = atoi (secStr);
+                if (persistSecs < 0)
+                {
+                    printf (_("Autosave interval must not be negative.\n"));
+                    return -1;
+                }
+            }
+            else if (strncmp (argv[i], "-r", 2) == 0)
+            {
+                if (strlen(argv[i]) > 2)
+                    recordPath = argv[i]+2;
+                else if (i+1 < argc)
+                    recordPath = argv[i+1];
+                else
+                {
+                    printf (_("Missing path value for -r.\n"));
+                    return -1;
+                }
+            }
+            else if (strncmp (argv[i], "-u", 2) == 0)
+            {
+                const char* portStr;
+                if (strlen(argv[i]) > 2)
+                    portStr = argv[i]+2;
+                else if (i+1 < argc)
+                    portStr = argv[i+1];
+                else
+                {
+                    printf (_("Missing port value for -u.\n"));
+                    return -1;
+                }
+
+                /* The control port stays closed unless asked for */
+                ctlPort = atoi (portStr);
+                if (ctlPort < 0 || ctlPort > 65535)
+                {
+                    printf (_("Unable to parse control port value.\n"));
+                    return -1;
+                }
+            }
+            else if (strncmp (argv[i], "-U", 2) == 0)
+            {
+                if (strlen(argv[i]) > 2)
+                    ctlAddr = argv[i]+2;
+                else if (i+1 < argc)
+                    ctlAddr = argv[i+1];
+                else
+                {
+                    printf (_("Missing address value for -U.\n"));
+                    return -1;
+                }
+            }
 
         }
 
     /* Begin Logging */
     initLogging (verbose);
+
+    /* Record RPC traffic for lsdreplay */
+    if (recordPath && openRPCRecord (recordPath) < 0)
+        return -1;
     
     /* Start LSD! */
-    int exitCode = lsdSceneEntry (dbpath, rpcPort, pathPrefix);
+    int exitCode = lsdSceneEntry (dbpath, rpcPort, pathPrefix, persistSecs, directDB,
+                                  ctlPort, ctlAddr);
+
+    closeRPCRecord ();
     
     /* End Logging */
     finishLogging ();
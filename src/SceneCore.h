@@ -95,7 +95,9 @@ struct LSD_Partition
 /* Establishes managerial support for database operations */
 /* and the like EDIT: Turns out the entire program runs through here */
 int
-lsdSceneEntry (const char* dbpath, int rpcPort, const char* pathPrefix);
+lsdSceneEntry (const char* dbpath, int rpcPort, const char* pathPrefix,
+               int persistSecs, int directDB, int ctlPort,
+               const char* ctlAddr);
 
 
 int
@@ -107,6 +109,20 @@ void
 handleReload (evutil_socket_t ont, short int two, void* three);
 
 
+/* Frames render on their own thread, which holds this lock for
+ * the span of each one. Main thread code touching the running
+ * scene (arrays, node state) outside of a reload takes it
+ * around just that edit, so its changes land between frames;
+ * DB queries belong outside it. The thread holding the lock may
+ * take it again */
+void
+lockScene ();
+
+
+void
+unlockScene ();
+
+
 struct event_base*
 getMainEB ();
 
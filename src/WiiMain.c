@@ -201,7 +201,7 @@ main (int argc, const char** argv)
     initLogging (0);
     
     /* Start LSD! */
-    int exitCode = lsdSceneEntry (dbpath, rpcPort, pathPrefix);
+    int exitCode = lsdSceneEntry (dbpath, rpcPort, pathPrefix, 5, 0, 0, NULL);
     //int exitCode = 0;
     
     /* End Logging */
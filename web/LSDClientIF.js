@@ -181,5 +181,16 @@ LSDServer.prototype = {
         thedata.method = "lsdCustomRPC";
         thedata.nodeId = nodeId;
         $.post(this.url,JSON.stringify(thedata),resultCB,"json");
+    },
+
+    // For plugin calls that only read
+    customQuery:function(nodeId,data,resultCB){
+        if(!nodeId)
+            return;
+        
+        var thedata = data;
+        thedata.method = "lsdCustomQuery";
+        thedata.nodeId = nodeId;
+        $.post(this.url,JSON.stringify(thedata),resultCB,"json");
     }
 };